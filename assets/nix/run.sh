@@ -13,23 +13,51 @@
 executable_name=""
 
 # All of the below can be overriden with command line args
+# Options left empty keep their value from doorstop_config.ini in the working directory,
+# or their default if the file doesn't set them
 
 # General Config Options
 
 # Enable Doorstop?
-# 0 is false, 1 is true
-enabled="1"
+# 0 is false, 1 is true (default)
+enabled=""
 
 # Path to the assembly to load and execute
 # NOTE: The entrypoint must be of format `static void Doorstop.Entrypoint.Start()`
-target_assembly="Doorstop.dll"
+# Defaults to Doorstop.dll in the working directory
+target_assembly=""
 
 # Overrides the default boot.config file path
-boot_config_override=
+boot_config_override=""
 
 # If enabled, DOORSTOP_DISABLE env var value is ignored
 # USE THIS ONLY WHEN ASKED TO OR YOU KNOW WHAT THIS MEANS
-ignore_disable_switch="0"
+ignore_disable_switch=""
+
+# Path to the boot readahead list
+# If the file does not exist, the files opened by the game during the first boot_readahead_seconds
+# seconds are recorded into it. On later launches, those files are read ahead into the page cache
+# in the background, which speeds up cold starts. Delete the file to record it again.
+boot_readahead_list=""
+
+# How long to record opened files for, in seconds (30 by default)
+boot_readahead_seconds=""
+
+# If 1, Mono and CoreCLR write a map of JIT-compiled managed code to /tmp/perf-<pid>.map
+# so that perf and other Linux profilers can symbolize managed frames
+perf_map=""
+
+# If set, calls from the engine into managed code (mono/il2cpp runtime_invoke) are profiled
+# and a report sorted by total time is written to this path on exit
+runtime_invoke_profile=""
+
+# If set, the time spent in each startup phase is written to this path as Chrome trace-event JSON
+# Open it in chrome://tracing or https://ui.perfetto.dev
+boot_trace=""
+
+# Log levels of verbose builds: a level (off, error, warn, info, debug, trace) for all categories,
+# followed by category=level entries, e.g. "warn,mapper=debug"
+log_level=""
 
 # Mono Options
 
@@ -42,13 +70,35 @@ ignore_disable_switch="0"
 dll_search_path_override=""
 
 # If 1, Mono debugger server will be enabled
-debug_enable="0"
+debug_enable=""
 
-# When debug_enabled is 1, specifies the address to use for the debugger server
-debug_address="127.0.0.1:10000"
+# When debug_enabled is 1, specifies the address to use for the debugger server (127.0.0.1:10000 by default)
+debug_address=""
 
 # If 1 and debug_enabled is 1, Mono debugger server will suspend the game execution until a debugger is attached
-debug_suspend="0"
+debug_suspend=""
+
+# Extra options to pass to the Mono JIT, separated by spaces
+# They are added to the options Unity already passes, e.g. "--optimize=inline,simd --llvm"
+mono_jit_options=""
+
+# SGen GC tuning, passed to Mono through MONO_GC_PARAMS only while it initializes
+# Unlike setting MONO_GC_PARAMS directly, these don't leak into child processes
+# Nursery size, e.g. "64m"
+mono_gc_nursery_size=""
+# Major collector: "marksweep", "marksweep-conc" or "marksweep-conc-par"
+mono_gc_major=""
+# Soft heap limit, e.g. "1g"
+mono_gc_soft_heap_limit=""
+# Any other MONO_GC_PARAMS options, separated by commas
+mono_gc_params=""
+# Value of MONO_GC_DEBUG
+mono_gc_debug=""
+
+# If 1, assemblies read from the DLL search path are published to a shared memory
+# segment so that other instances of the game on this machine can map them
+# instead of reading them again (useful when running many dedicated servers)
+mono_shared_cache=""
 
 # CoreCLR options (IL2CPP)
 
@@ -58,6 +108,27 @@ coreclr_path=""
 # Path to the directory containing the managed core libraries for CoreCLR (mscorlib, System, etc.)
 corlib_dir=""
 
+# If 1, CoreCLR is loaded and initialized on a background thread while il2cpp initializes
+# Doorstop.Entrypoint.Start is still invoked on the main thread once il2cpp is initialized
+clr_concurrent_init=""
+
+# If 1, il2cpp's native allocations are served from Doorstop's pool allocator
+# Small allocations come from per-thread caches, which reduces allocator contention
+# Allocation counters are written to the Doorstop log on shutdown (verbose builds only)
+il2cpp_pool_allocator=""
+
+# GC mode to switch il2cpp to after it is initialized: "enabled", "disabled" or "manual"
+# Leave empty to keep the mode chosen by the game
+il2cpp_gc_mode=""
+
+# Maximum time the incremental GC may spend per slice, in nanoseconds (e.g. "2000000" for 2 ms)
+# Only has an effect if the game uses the incremental GC; 0 keeps the game's setting
+il2cpp_gc_max_time_slice_ns=""
+
+# Additional properties to initialize CoreCLR with, as key=value pairs separated by semicolons (;)
+# Useful for tuning the GC and JIT, e.g. "System.GC.Server=true;System.GC.HeapCount=4;System.Runtime.TieredPGO=false"
+clr_runtime_properties=""
+
 ################################################################################
 # Everything past this point is the actual script
 
@@ -247,6 +318,36 @@ while [ $i -lt $max ]; do
             shift
             i=$((i+1))
         ;;
+        --doorstop-boot-readahead-list)
+            boot_readahead_list="$2"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-boot-readahead-seconds)
+            boot_readahead_seconds="$2"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-perf-map)
+            perf_map="$(doorstop_bool "$2")"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-runtime-invoke-profile)
+            runtime_invoke_profile="$2"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-boot-trace)
+            boot_trace="$2"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-log-level)
+            log_level="$2"
+            shift
+            i=$((i+1))
+        ;;
         --doorstop-mono-dll-search-path-override)
             dll_search_path_override="$2"
             shift
@@ -267,6 +368,41 @@ while [ $i -lt $max ]; do
             shift
             i=$((i+1))
         ;;
+        --doorstop-mono-jit-options)
+            mono_jit_options="$2"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-mono-gc-nursery-size)
+            mono_gc_nursery_size="$2"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-mono-gc-major)
+            mono_gc_major="$2"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-mono-gc-soft-heap-limit)
+            mono_gc_soft_heap_limit="$2"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-mono-gc-params)
+            mono_gc_params="$2"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-mono-gc-debug)
+            mono_gc_debug="$2"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-mono-shared-cache)
+            mono_shared_cache="$(doorstop_bool "$2")"
+            shift
+            i=$((i+1))
+        ;;
         --doorstop-clr-runtime-coreclr-path)
             coreclr_path="$2"
             shift
@@ -277,6 +413,31 @@ while [ $i -lt $max ]; do
             shift
             i=$((i+1))
         ;;
+        --doorstop-clr-concurrent-init)
+            clr_concurrent_init="$(doorstop_bool "$2")"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-il2cpp-pool-allocator)
+            il2cpp_pool_allocator="$(doorstop_bool "$2")"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-il2cpp-gc-mode)
+            il2cpp_gc_mode="$2"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-il2cpp-gc-max-time-slice-ns)
+            il2cpp_gc_max_time_slice_ns="$2"
+            shift
+            i=$((i+1))
+        ;;
+        --doorstop-clr-runtime-property)
+            clr_runtime_properties="${clr_runtime_properties:+$clr_runtime_properties;}$2"
+            shift
+            i=$((i+1))
+        ;;
         *)
             set -- "$@" "$1"
         ;;
@@ -285,19 +446,59 @@ while [ $i -lt $max ]; do
     i=$((i+1))
 done
 
-target_assembly="$(abs_path "$target_assembly")"
+if [ -n "$target_assembly" ]; then
+    target_assembly="$(abs_path "$target_assembly")"
+fi
+if [ -n "$boot_readahead_list" ]; then
+    boot_readahead_list="$(abs_path "$boot_readahead_list")"
+fi
+if [ -n "$runtime_invoke_profile" ]; then
+    runtime_invoke_profile="$(abs_path "$runtime_invoke_profile")"
+fi
+if [ -n "$boot_trace" ]; then
+    boot_trace="$(abs_path "$boot_trace")"
+fi
+if [ -n "$coreclr_path" ]; then
+    coreclr_path="$coreclr_path.$lib_extension"
+fi
 
 # Move variables to environment
-export DOORSTOP_ENABLED="$enabled"
-export DOORSTOP_TARGET_ASSEMBLY="$target_assembly"
-export DOORSTOP_BOOT_CONFIG_OVERRIDE="$boot_config_override"
-export DOORSTOP_IGNORE_DISABLED_ENV="$ignore_disable_switch"
-export DOORSTOP_MONO_DLL_SEARCH_PATH_OVERRIDE="$dll_search_path_override"
-export DOORSTOP_MONO_DEBUG_ENABLED="$debug_enable"
-export DOORSTOP_MONO_DEBUG_ADDRESS="$debug_address"
-export DOORSTOP_MONO_DEBUG_SUSPEND="$debug_suspend"
-export DOORSTOP_CLR_RUNTIME_CORECLR_PATH="$coreclr_path.$lib_extension"
-export DOORSTOP_CLR_CORLIB_DIR="$corlib_dir"
+# Only the options that were set are exported, so that the others keep their value from
+# doorstop_config.ini
+export_option() {
+    if [ -n "$2" ]; then
+        export "$1=$2"
+    fi
+}
+
+export_option DOORSTOP_ENABLED "$enabled"
+export_option DOORSTOP_TARGET_ASSEMBLY "$target_assembly"
+export_option DOORSTOP_BOOT_CONFIG_OVERRIDE "$boot_config_override"
+export_option DOORSTOP_IGNORE_DISABLED_ENV "$ignore_disable_switch"
+export_option DOORSTOP_BOOT_READAHEAD_LIST "$boot_readahead_list"
+export_option DOORSTOP_BOOT_READAHEAD_SECONDS "$boot_readahead_seconds"
+export_option DOORSTOP_PERF_MAP "$perf_map"
+export_option DOORSTOP_RUNTIME_INVOKE_PROFILE "$runtime_invoke_profile"
+export_option DOORSTOP_BOOT_TRACE "$boot_trace"
+export_option DOORSTOP_LOG_LEVEL "$log_level"
+export_option DOORSTOP_MONO_DLL_SEARCH_PATH_OVERRIDE "$dll_search_path_override"
+export_option DOORSTOP_MONO_DEBUG_ENABLED "$debug_enable"
+export_option DOORSTOP_MONO_DEBUG_ADDRESS "$debug_address"
+export_option DOORSTOP_MONO_DEBUG_SUSPEND "$debug_suspend"
+export_option DOORSTOP_MONO_JIT_OPTIONS "$mono_jit_options"
+export_option DOORSTOP_MONO_GC_NURSERY_SIZE "$mono_gc_nursery_size"
+export_option DOORSTOP_MONO_GC_MAJOR "$mono_gc_major"
+export_option DOORSTOP_MONO_GC_SOFT_HEAP_LIMIT "$mono_gc_soft_heap_limit"
+export_option DOORSTOP_MONO_GC_PARAMS "$mono_gc_params"
+export_option DOORSTOP_MONO_GC_DEBUG "$mono_gc_debug"
+export_option DOORSTOP_MONO_SHARED_CACHE "$mono_shared_cache"
+export_option DOORSTOP_CLR_RUNTIME_CORECLR_PATH "$coreclr_path"
+export_option DOORSTOP_CLR_CORLIB_DIR "$corlib_dir"
+export_option DOORSTOP_CLR_CONCURRENT_INIT "$clr_concurrent_init"
+export_option DOORSTOP_CLR_RUNTIME_PROPERTIES "$clr_runtime_properties"
+export_option DOORSTOP_IL2CPP_POOL_ALLOCATOR "$il2cpp_pool_allocator"
+export_option DOORSTOP_IL2CPP_GC_MODE "$il2cpp_gc_mode"
+export_option DOORSTOP_IL2CPP_GC_MAX_TIME_SLICE_NS "$il2cpp_gc_max_time_slice_ns"
 
 # Final setup
 doorstop_directory="${BASEDIR}/"
@@ -0,0 +1,152 @@
+/*
+ * Compares reading every key of an INI file with the single-pass parser used
+ * by load_config against a per-key lookup that opens and scans the file for
+ * each key, the way GetPrivateProfileString does on Windows.
+ *
+ * Usage: bench_config_ini [iterations]
+ *
+ * Files of 16 to 4096 keys in sections of 16 keys are generated in a temporary
+ * directory. Both readers must return the same value for every key.
+ */
+#include "config/ini.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#define KEYS_PER_SECTION 16
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void write_config(const char *path, int keys) {
+    FILE *file = fopen(path, "w");
+    for (int i = 0; i < keys; i++) {
+        if (i % KEYS_PER_SECTION == 0)
+            fprintf(file, "\n# Section %d\n[Section%d]\n",
+                    i / KEYS_PER_SECTION, i / KEYS_PER_SECTION);
+        fprintf(file, "key_%d = value of key %d\n", i, i);
+    }
+    fclose(file);
+}
+
+static char *trim(char *start) {
+    while (*start == ' ' || *start == '\t')
+        start++;
+    char *end = start + strlen(start);
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t' ||
+                           end[-1] == '\r' || end[-1] == '\n'))
+        end--;
+    *end = '\0';
+    return start;
+}
+
+// Opens and scans the file for a single key, like GetPrivateProfileString
+static int profile_get(const char *path, const char *section, const char *key,
+                       char *value, size_t size) {
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return 0;
+
+    char line[512];
+    int in_section = 0;
+    int found = 0;
+    while (!found && fgets(line, sizeof(line), file)) {
+        char *start = trim(line);
+        if (*start == '[') {
+            char *close = strchr(start, ']');
+            if (close) {
+                *close = '\0';
+                in_section = strcasecmp(trim(start + 1), section) == 0;
+            }
+            continue;
+        }
+        char *equals = strchr(start, '=');
+        if (!in_section || !equals)
+            continue;
+        *equals = '\0';
+        if (strcasecmp(trim(start), key) == 0) {
+            snprintf(value, size, "%s", trim(equals + 1));
+            found = 1;
+        }
+    }
+    fclose(file);
+    return found;
+}
+
+static void names(int i, char *section, char *key) {
+    sprintf(section, "Section%d", i / KEYS_PER_SECTION);
+    sprintf(key, "key_%d", i);
+}
+
+int main(int argc, char **argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 20;
+
+    char dir[] = "/tmp/doorstop_ini_XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "%s/doorstop_config.ini", dir);
+
+    printf("%-6s %14s %14s %9s\n", "keys", "per-key (ms)", "ini (ms)",
+           "speedup");
+    int ok = 1;
+    for (int keys = 16; keys <= 4096; keys *= 4) {
+        write_config(path, keys);
+        char section[32];
+        char key[32];
+        char expected[64];
+        char value[64];
+
+        double start = now_ms();
+        for (int n = 0; n < iterations; n++) {
+            for (int i = 0; i < keys; i++) {
+                names(i, section, key);
+                profile_get(path, section, key, value, sizeof(value));
+            }
+        }
+        double per_key_ms = (now_ms() - start) / iterations;
+
+        start = now_ms();
+        for (int n = 0; n < iterations; n++) {
+            IniFile ini;
+            ini_load(&ini, path);
+            for (int i = 0; i < keys; i++) {
+                names(i, section, key);
+                ini_get(&ini, section, key);
+            }
+            ini_free(&ini);
+        }
+        double ini_ms = (now_ms() - start) / iterations;
+
+        IniFile ini;
+        ok &= ini_load(&ini, path);
+        for (int i = 0; ok && i < keys; i++) {
+            names(i, section, key);
+            snprintf(expected, sizeof(expected), "value of key %d", i);
+            const char *parsed = ini_get(&ini, section, key);
+            ok = profile_get(path, section, key, value, sizeof(value)) &&
+                 parsed && strcmp(parsed, expected) == 0 &&
+                 strcmp(value, expected) == 0;
+        }
+        ini_free(&ini);
+
+        printf("%-6d %14.3f %14.3f %8.1fx\n", keys, per_key_ms, ini_ms,
+               per_key_ms / ini_ms);
+    }
+
+    unlink(path);
+    rmdir(dir);
+    if (!ok) {
+        printf("The readers returned different values\n");
+        return 1;
+    }
+    return 0;
+}
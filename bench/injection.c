@@ -0,0 +1,420 @@
+/*
+ * Measures the overhead Doorstop adds to a Unity player, using stub runtimes
+ * and this executable as the player.
+ *
+ * Usage: bench_injection [mono|il2cpp] [runs] [libdoorstop.so]
+ *
+ * The stub runtimes (libmono-stub.so, GameAssembly.so and libcoreclr.so) and
+ * libdoorstop.so default to the ones next to this executable. Each run starts
+ * this executable twice, once on its own and once with Doorstop in
+ * LD_PRELOAD, and each child does what UnityPlayer does on startup: redirect
+ * stdout, open boot.config, dlopen the runtime, resolve its API with dlsym and
+ * initialize it. The medians of both are compared:
+ *
+ *   exec to main       startup until main, which includes Doorstop's
+ *                      constructor
+ *   dlsym              time per dlsym call after the first lookups
+ *   runtime init       time until mono_jit_init_version or il2cpp_init
+ *                      returns, which includes Doorstop's bootstrap
+ *   Start invoked      time from initializing the runtime until the stub mono
+ *                      or CoreCLR is asked to invoke Doorstop.Entrypoint.Start
+ *
+ * For il2cpp, the cost of looking up symbols in the Windows player name
+ * mapper is also measured as the number of mapped entries grows.
+ */
+#define _GNU_SOURCE
+#include "mapper/mapper.h"
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DLSYM_ROUNDS 1000
+#define MAPPER_LOOKUPS 1000000
+#define RESULT_FD_ENV "BENCH_INJECTION_RESULT_FD"
+#define EXEC_NS_ENV "BENCH_INJECTION_EXEC_NS"
+
+static const char *mono_symbols[] = {
+#define DEF_CALL(ret_type, name, ...) "mono_" #name,
+#define DEFINE_CALLS
+#include "runtimes/mono.h"
+#undef DEFINE_CALLS
+#undef DEF_CALL
+};
+
+static const char *il2cpp_symbols[] = {
+#define DEF_CALL(ret_type, name, ...) "il2cpp_" #name,
+#define DEFINE_CALLS
+#include "runtimes/il2cpp.h"
+#undef DEFINE_CALLS
+#undef DEF_CALL
+};
+
+#define COUNT_OF(array) (sizeof(array) / sizeof(array[0]))
+
+typedef struct {
+    const char *name;
+    const char *library;
+    const char **symbols;
+    size_t symbol_count;
+    const char *init_symbol;
+    // Library and variable holding the time Start was invoked at
+    const char *start_library;
+    const char *start_symbol;
+} Runtime;
+
+static const Runtime runtimes[] = {
+    {"mono", "libmono-stub.so", mono_symbols, COUNT_OF(mono_symbols),
+     "mono_jit_init_version", "libmono-stub.so", "stub_mono_invoke_ns"},
+    {"il2cpp", "GameAssembly.so", il2cpp_symbols, COUNT_OF(il2cpp_symbols),
+     "il2cpp_init", "libcoreclr.so", "stub_coreclr_start_ns"},
+};
+
+typedef struct {
+    double exec_to_main_us;
+    double dlsym_ns;
+    double init_us;
+    double start_invoked_us;
+} Result;
+
+typedef void *(*jit_init_version_t)(const char *root_domain_name,
+                                    const char *runtime_version);
+typedef int (*il2cpp_init_t)(const char *domain_name);
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static const Runtime *find_runtime(const char *name) {
+    for (size_t i = 0; i < COUNT_OF(runtimes); i++) {
+        if (strcmp(runtimes[i].name, name) == 0)
+            return &runtimes[i];
+    }
+    return NULL;
+}
+
+static int run_child(int result_fd, const Runtime *runtime,
+                     const char *stub_dir) {
+    uint64_t main_ns = now_ns();
+    uint64_t exec_ns = strtoull(getenv(EXEC_NS_ENV), NULL, 10);
+
+    // Unity redirects its output to the player log
+    int null_fd = open("/dev/null", O_WRONLY);
+    dup2(null_fd, fileno(stdout));
+    FILE *boot_config = fopen("bench_injection_Data/boot.config", "r");
+    if (boot_config)
+        fclose(boot_config);
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", stub_dir, runtime->library);
+    void *library = dlopen(path, RTLD_LAZY);
+    if (!library)
+        return 1;
+
+    // The first lookups are where Doorstop initializes itself
+    void *init = NULL;
+    for (size_t i = 0; i < runtime->symbol_count; i++) {
+        void *symbol = dlsym(library, runtime->symbols[i]);
+        if (strcmp(runtime->symbols[i], runtime->init_symbol) == 0)
+            init = symbol;
+    }
+    if (!init)
+        return 1;
+
+    uint64_t dlsym_start = now_ns();
+    for (int round = 0; round < DLSYM_ROUNDS; round++) {
+        for (size_t i = 0; i < runtime->symbol_count; i++)
+            dlsym(library, runtime->symbols[i]);
+    }
+    uint64_t dlsym_end = now_ns();
+
+    uint64_t init_start = now_ns();
+    if (strcmp(runtime->name, "mono") == 0)
+        ((jit_init_version_t)init)("Unity Root Domain", "v4.0.30319");
+    else
+        ((il2cpp_init_t)init)("IL2CPP Root Domain");
+    uint64_t init_end = now_ns();
+
+    // The entrypoint runtime is only loaded if Doorstop bootstrapped it
+    snprintf(path, sizeof(path), "%s/%s", stub_dir, runtime->start_library);
+    void *start_library = dlopen(path, RTLD_LAZY | RTLD_NOLOAD);
+    uint64_t *start_ns =
+        start_library ? dlsym(start_library, runtime->start_symbol) : NULL;
+    double start_invoked_us =
+        start_ns && *start_ns ? (*start_ns - init_start) / 1e3 : -1;
+
+    dprintf(result_fd, "%f %f %f %f\n", (main_ns - exec_ns) / 1e3,
+            (double)(dlsym_end - dlsym_start) /
+                (DLSYM_ROUNDS * runtime->symbol_count),
+            (init_end - init_start) / 1e3, start_invoked_us);
+    return 0;
+}
+
+typedef struct {
+    const char *self;
+    const char *stub_dir;
+    const char *doorstop_path;
+    const char *target_path;
+    const char *coreclr_path;
+    const char *corlib_dir;
+} Setup;
+
+static int run_once(const Setup *setup, const Runtime *runtime,
+                    int with_doorstop, Result *result) {
+    int fds[2];
+    if (pipe(fds) != 0)
+        return 0;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        char value[32];
+        snprintf(value, sizeof(value), "%d", fds[1]);
+        setenv(RESULT_FD_ENV, value, 1);
+        // Doorstop marks the environment so that child processes skip it
+        unsetenv("DOORSTOP_DISABLE");
+        unsetenv("DOORSTOP_INITIALIZED");
+        if (with_doorstop) {
+            setenv("LD_PRELOAD", setup->doorstop_path, 1);
+            setenv("DOORSTOP_ENABLED", "1", 1);
+            setenv("DOORSTOP_TARGET_ASSEMBLY", setup->target_path, 1);
+            setenv("DOORSTOP_CLR_RUNTIME_CORECLR_PATH", setup->coreclr_path,
+                   1);
+            setenv("DOORSTOP_CLR_CORLIB_DIR", setup->corlib_dir, 1);
+        } else {
+            unsetenv("LD_PRELOAD");
+        }
+        snprintf(value, sizeof(value), "%llu", (unsigned long long)now_ns());
+        setenv(EXEC_NS_ENV, value, 1);
+        execl(setup->self, setup->self, "--child", runtime->name,
+              setup->stub_dir, (char *)NULL);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    FILE *output = fdopen(fds[0], "r");
+    int matched = fscanf(output, "%lf %lf %lf %lf", &result->exec_to_main_us,
+                         &result->dlsym_ns, &result->init_us,
+                         &result->start_invoked_us);
+    fclose(output);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return matched == 4 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(Result *results, int count, size_t offset) {
+    double *values = malloc(count * sizeof(double));
+    for (int i = 0; i < count; i++)
+        values[i] = *(double *)((char *)&results[i] + offset);
+    qsort(values, count, sizeof(double), compare_double);
+    double result = values[count / 2];
+    free(values);
+    return result;
+}
+
+static void print_row(const char *name, Result *baseline, Result *injected,
+                      int runs, size_t offset) {
+    double base = median(baseline, runs, offset);
+    double doorstop = median(injected, runs, offset);
+    if (base < 0)
+        printf("%-24s %12s %12.1f %12s\n", name, "-", doorstop, "-");
+    else
+        printf("%-24s %12.1f %12.1f %+12.1f\n", name, base, doorstop,
+               doorstop - base);
+}
+
+static const char *linear_find(const Mapper *mapper, const char *name) {
+    for (size_t i = 0; i < mapper->count; i++) {
+        if (strcasecmp(mapper->entries[i].original_name, name) == 0)
+            return mapper->entries[i].mapped_name;
+    }
+    return NULL;
+}
+
+/*
+ * Builds a mapper like the one read from mapper.txt: the il2cpp API first,
+ * then generated symbols, each mapped to a random obfuscated name such as
+ * _RQluJpGVqK.
+ */
+static void build_mapper(Mapper *mapper, size_t count) {
+    mapper->entries = calloc(count, sizeof(MapperEntry));
+    mapper->count = count;
+    mapper->capacity = count;
+    for (size_t i = 0; i < count; i++) {
+        char name[64];
+        if (i < COUNT_OF(il2cpp_symbols))
+            snprintf(name, sizeof(name), "%s", il2cpp_symbols[i]);
+        else
+            snprintf(name, sizeof(name), "il2cpp_generated_%zu", i);
+        mapper->entries[i].original_name = strdup(name);
+
+        char mapped[12] = "_";
+        for (int c = 1; c < 11; c++)
+            mapped[c] = (rand() & 1 ? 'a' : 'A') + rand() % 26;
+        mapper->entries[i].mapped_name = strdup(mapped);
+    }
+}
+
+static void free_mapper(Mapper *mapper) {
+    for (size_t i = 0; i < mapper->count; i++) {
+        free(mapper->entries[i].original_name);
+        free(mapper->entries[i].mapped_name);
+    }
+    free(mapper->entries);
+}
+
+static double lookup_ns(const Mapper *mapper,
+                        const char *(*find)(const Mapper *, const char *),
+                        int lookups) {
+    size_t found = 0;
+    uint64_t start = now_ns();
+    for (int i = 0; i < lookups; i++) {
+        // Every GetProcAddress call is looked up, including symbols of other
+        // libraries that aren't mapped
+        const char *name = i % 4 ? il2cpp_symbols[i % COUNT_OF(il2cpp_symbols)]
+                                 : mono_symbols[i % COUNT_OF(mono_symbols)];
+        found += find(mapper, name) != NULL;
+    }
+    uint64_t end = now_ns();
+    if (!found)
+        printf("(nothing found)\n");
+    return (double)(end - start) / lookups;
+}
+
+static void bench_mapper() {
+    printf("\n%-24s %12s %12s %12s\n", "mapper entries", "index (us)",
+           "lookup (ns)", "linear (ns)");
+    for (size_t count = 10; count <= 100000; count *= 10) {
+        Mapper mapper;
+        build_mapper(&mapper, count);
+
+        uint64_t index_start = now_ns();
+        mapper_index(&mapper);
+        uint64_t index_end = now_ns();
+
+        // Fewer lookups for the linear scan, which is slow for large mappers
+        int linear_lookups = (int)(MAPPER_LOOKUPS / count);
+        printf("%-24zu %12.1f %12.1f %12.1f\n", count,
+               (index_end - index_start) / 1e3,
+               lookup_ns(&mapper, mapper_find, MAPPER_LOOKUPS),
+               lookup_ns(&mapper, linear_find,
+                         linear_lookups > 100 ? linear_lookups : 100));
+        free_mapper(&mapper);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *result_fd = getenv(RESULT_FD_ENV);
+    if (argc == 4 && strcmp(argv[1], "--child") == 0 && result_fd) {
+        const Runtime *runtime = find_runtime(argv[2]);
+        return runtime ? run_child(atoi(result_fd), runtime, argv[3]) : 1;
+    }
+
+    const Runtime *runtime = find_runtime(argc > 1 ? argv[1] : "mono");
+    if (!runtime) {
+        fprintf(stderr,
+                "Usage: %s [mono|il2cpp] [runs] [libdoorstop.so]\n",
+                argv[0]);
+        return 1;
+    }
+    int runs = argc > 2 ? atoi(argv[2]) : 20;
+    if (runs < 1)
+        runs = 1;
+
+    char self[PATH_MAX];
+    ssize_t self_len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (self_len < 0) {
+        perror("readlink");
+        return 1;
+    }
+    self[self_len] = '\0';
+
+    char stub_dir[PATH_MAX];
+    strcpy(stub_dir, self);
+    dirname(stub_dir);
+
+    char doorstop_path[PATH_MAX];
+    snprintf(doorstop_path, sizeof(doorstop_path), "%s/libdoorstop.so",
+             stub_dir);
+    if (argc > 3 && !realpath(argv[3], doorstop_path)) {
+        perror(argv[3]);
+        return 1;
+    }
+    char coreclr_path[PATH_MAX];
+    snprintf(coreclr_path, sizeof(coreclr_path), "%s/libcoreclr.so",
+             stub_dir);
+
+    // Doorstop only bootstraps if the target assembly exists; the folder
+    // doubles as the CoreCLR corlib folder
+    char corlib_dir[] = "/tmp/bench_injection_XXXXXX";
+    if (!mkdtemp(corlib_dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    char target_path[PATH_MAX];
+    snprintf(target_path, sizeof(target_path), "%s/Doorstop.dll", corlib_dir);
+    static char assembly[4096];
+    FILE *target = fopen(target_path, "wb");
+    size_t written = target ? fwrite(assembly, 1, sizeof(assembly), target) : 0;
+    if (target)
+        fclose(target);
+
+    Setup setup = {self,        stub_dir,     doorstop_path,
+                   target_path, coreclr_path, corlib_dir};
+    Result *baseline = calloc(runs, sizeof(Result));
+    Result *injected = calloc(runs, sizeof(Result));
+    int ok = written == sizeof(assembly);
+    for (int i = 0; ok && i < runs; i++) {
+        ok = run_once(&setup, runtime, 0, &baseline[i]) &&
+             run_once(&setup, runtime, 1, &injected[i]);
+    }
+
+    char cache_path[PATH_MAX + 16];
+    snprintf(cache_path, sizeof(cache_path), "%s.token_cache", target_path);
+    unlink(cache_path);
+    unlink(target_path);
+    rmdir(corlib_dir);
+
+    if (!ok) {
+        fprintf(stderr, "A run failed; check %s and the stubs in %s\n",
+                doorstop_path, stub_dir);
+        return 1;
+    }
+
+    printf("%s: %d runs, %zu symbols x %d dlsym rounds\n\n", runtime->name,
+           runs, runtime->symbol_count, DLSYM_ROUNDS);
+    printf("%-24s %12s %12s %12s\n", "median", "baseline", "doorstop",
+           "overhead");
+    print_row("exec to main (us)", baseline, injected, runs,
+              offsetof(Result, exec_to_main_us));
+    print_row("dlsym (ns)", baseline, injected, runs,
+              offsetof(Result, dlsym_ns));
+    print_row("runtime init (us)", baseline, injected, runs,
+              offsetof(Result, init_us));
+    print_row("Start invoked (us)", baseline, injected, runs,
+              offsetof(Result, start_invoked_us));
+
+    if (strcmp(runtime->name, "il2cpp") == 0)
+        bench_mapper();
+
+    free(baseline);
+    free(injected);
+    return 0;
+}
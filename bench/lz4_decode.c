@@ -0,0 +1,116 @@
+/*
+ * Measures the cost of loading an LZ4-compressed assembly compared to reading
+ * the uncompressed one.
+ *
+ * Usage: bench_lz4 <assembly.dll> <assembly.dll.lz4> [iterations]
+ *
+ * Cold-cache numbers evict both files from the page cache with
+ * posix_fadvise(POSIX_FADV_DONTNEED) before every read, which approximates
+ * booting from cold shared storage without needing root to drop all caches.
+ */
+#define _GNU_SOURCE
+#include "util/lz4.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static double cpu_ms() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3 +
+           usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3;
+}
+
+static void evict(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static void *read_all(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        exit(1);
+    }
+    struct stat sb;
+    fstat(fd, &sb);
+    void *data = malloc(sb.st_size);
+    size_t done = 0;
+    while (done < (size_t)sb.st_size) {
+        ssize_t r = read(fd, (char *)data + done, sb.st_size - done);
+        if (r <= 0)
+            break;
+        done += r;
+    }
+    close(fd);
+    *size = done;
+    return data;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <assembly.dll> <assembly.dll.lz4> "
+                        "[iterations]\n",
+                argv[0]);
+        return 1;
+    }
+    int iterations = argc > 3 ? atoi(argv[3]) : 20;
+
+    size_t raw_size = 0, lz4_size = 0;
+    double raw_cold = 0, lz4_cold = 0;
+    for (int i = 0; i < iterations; i++) {
+        evict(argv[1]);
+        double start = now_ms();
+        free(read_all(argv[1], &raw_size));
+        raw_cold += now_ms() - start;
+
+        evict(argv[2]);
+        start = now_ms();
+        void *src = read_all(argv[2], &lz4_size);
+        size_t bound = lz4_frame_decoded_bound(src, lz4_size, NULL);
+        void *dst = malloc(bound);
+        if (!lz4_decompress_frame(src, lz4_size, dst, bound)) {
+            fprintf(stderr, "%s is not a valid LZ4 frame\n", argv[2]);
+            return 1;
+        }
+        lz4_cold += now_ms() - start;
+        free(src);
+        free(dst);
+    }
+
+    void *src = read_all(argv[2], &lz4_size);
+    size_t bound = lz4_frame_decoded_bound(src, lz4_size, NULL);
+    void *dst = malloc(bound);
+    size_t decoded = 0;
+    double cpu_start = cpu_ms();
+    double wall_start = now_ms();
+    for (int i = 0; i < iterations; i++)
+        decoded = lz4_decompress_frame(src, lz4_size, dst, bound);
+    double wall = now_ms() - wall_start;
+    double cpu = cpu_ms() - cpu_start;
+
+    printf("uncompressed: %zu bytes, compressed: %zu bytes (%.2fx)\n",
+           raw_size, lz4_size, (double)raw_size / lz4_size);
+    printf("cold read (uncompressed):        %8.3f ms\n",
+           raw_cold / iterations);
+    printf("cold read + decode (LZ4):        %8.3f ms\n",
+           lz4_cold / iterations);
+    printf("warm decode wall time:           %8.3f ms\n", wall / iterations);
+    printf("warm decode CPU time:            %8.3f ms (%.1f MB/s)\n",
+           cpu / iterations, decoded / 1e3 / (wall / iterations));
+    return 0;
+}
@@ -0,0 +1,275 @@
+/*
+ * Checks the exact argv that reaches mono_jit_parse_options when extra JIT
+ * options are configured, and measures the cost Doorstop adds to the call.
+ *
+ * Usage: bench_mono_jit_options [iterations] [libdoorstop.so]
+ *
+ * The stub mono (libmono-stub.so) and libdoorstop.so default to the ones next
+ * to this executable. Each case starts this executable with Doorstop in
+ * LD_PRELOAD and the case's options in the environment. The child looks up
+ * mono_jit_parse_options with dlsym like UnityPlayer does, which hands it
+ * Doorstop's hook, and calls it with Unity's arguments. The stub records the
+ * arguments the hook passes on: Unity's arguments first, then the configured
+ * options, then the debugger agent.
+ */
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <libgen.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_ARGS 32
+#define RESULT_FD_ENV "BENCH_JIT_OPTIONS_RESULT_FD"
+#define DEBUGGER_ADDRESS "127.0.0.1:10000"
+
+typedef void (*jit_parse_options_t)(int argc, char **argv);
+
+typedef struct {
+    const char *name;
+    const char **unity_argv;
+    const char *options;
+    int debugger;
+    const char **expected;
+} Case;
+
+typedef struct {
+    int argc;
+    char *argv[MAX_ARGS];
+    double call_ns;
+} Result;
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int run_child(int result_fd, const char *stub_dir, int iterations,
+                     int argc, char **argv) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/libmono-stub.so", stub_dir);
+    void *library = dlopen(path, RTLD_LAZY);
+    if (!library)
+        return 1;
+
+    // Looked up through the executable's dlsym, which Doorstop hooks
+    jit_parse_options_t parse_options =
+        (jit_parse_options_t)dlsym(library, "mono_jit_parse_options");
+    int *recorded_argc = dlsym(library, "stub_mono_jit_argc");
+    char **recorded_argv = dlsym(library, "stub_mono_jit_argv");
+    if (!parse_options || !recorded_argc || !recorded_argv)
+        return 1;
+
+    // Unity passes a NULL-terminated copy of its options
+    char **unity_argv = calloc(argc + 1, sizeof(char *));
+    memcpy(unity_argv, argv, argc * sizeof(char *));
+
+    parse_options(argc, unity_argv);
+    dprintf(result_fd, "%d\n", *recorded_argc);
+    for (int i = 0; i < *recorded_argc && i < MAX_ARGS; i++)
+        dprintf(result_fd, "%s\n", recorded_argv[i]);
+
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++)
+        parse_options(argc, unity_argv);
+    uint64_t end = now_ns();
+    dprintf(result_fd, "%f\n", iterations ? (double)(end - start) / iterations
+                                          : 0.0);
+    free(unity_argv);
+    return 0;
+}
+
+static int run_case(const char *self, const char *stub_dir,
+                    const char *doorstop_path, const char *target_path,
+                    const Case *test, int iterations, Result *result) {
+    int fds[2];
+    if (pipe(fds) != 0)
+        return 0;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        char value[32];
+        snprintf(value, sizeof(value), "%d", fds[1]);
+        setenv(RESULT_FD_ENV, value, 1);
+        unsetenv("DOORSTOP_DISABLE");
+        unsetenv("DOORSTOP_INITIALIZED");
+        unsetenv("DNSPY_UNITY_DBG2");
+        if (doorstop_path) {
+            setenv("LD_PRELOAD", doorstop_path, 1);
+            setenv("DOORSTOP_ENABLED", "1", 1);
+            setenv("DOORSTOP_TARGET_ASSEMBLY", target_path, 1);
+        } else {
+            unsetenv("LD_PRELOAD");
+        }
+        if (test->options)
+            setenv("DOORSTOP_MONO_JIT_OPTIONS", test->options, 1);
+        else
+            unsetenv("DOORSTOP_MONO_JIT_OPTIONS");
+        setenv("DOORSTOP_MONO_DEBUG_ENABLED", test->debugger ? "1" : "0", 1);
+        setenv("DOORSTOP_MONO_DEBUG_ADDRESS", DEBUGGER_ADDRESS, 1);
+        // Suspending adds no suffix that depends on the mono version
+        setenv("DOORSTOP_MONO_DEBUG_SUSPEND", "1", 1);
+
+        char *args[MAX_ARGS + 6];
+        int n = 0;
+        snprintf(value, sizeof(value), "%d", iterations);
+        args[n++] = (char *)self;
+        args[n++] = "--child";
+        args[n++] = (char *)stub_dir;
+        args[n++] = value;
+        for (int i = 0; test->unity_argv[i] && n < MAX_ARGS + 5; i++)
+            args[n++] = (char *)test->unity_argv[i];
+        args[n] = NULL;
+        execv(self, args);
+        _exit(127);
+    }
+    close(fds[1]);
+
+    FILE *output = fdopen(fds[0], "r");
+    int ok = fscanf(output, "%d\n", &result->argc) == 1;
+    for (int i = 0; ok && i < result->argc && i < MAX_ARGS; i++) {
+        char line[4096];
+        ok = fgets(line, sizeof(line), output) != NULL;
+        if (ok) {
+            line[strcspn(line, "\n")] = '\0';
+            result->argv[i] = strdup(line);
+        }
+    }
+    ok = ok && fscanf(output, "%lf", &result->call_ns) == 1;
+    fclose(output);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void free_result(Result *result) {
+    for (int i = 0; i < result->argc && i < MAX_ARGS; i++)
+        free(result->argv[i]);
+}
+
+static int check(const Case *test, const Result *result) {
+    int expected_argc = 0;
+    while (test->expected[expected_argc])
+        expected_argc++;
+
+    // argc is -1 if argv was not NULL-terminated
+    int ok = result->argc == expected_argc;
+    for (int i = 0; ok && i < expected_argc; i++)
+        ok = strcmp(result->argv[i], test->expected[i]) == 0;
+
+    printf("%-32s %s\n", test->name, ok ? "ok" : "FAILED");
+    if (!ok) {
+        for (int i = 0; i < result->argc && i < MAX_ARGS; i++)
+            printf("    argv[%d] = %s\n", i, result->argv[i]);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const char *result_fd = getenv(RESULT_FD_ENV);
+    if (argc >= 4 && strcmp(argv[1], "--child") == 0 && result_fd)
+        return run_child(atoi(result_fd), argv[2], atoi(argv[3]), argc - 4,
+                         argv + 4);
+
+    int iterations = argc > 1 ? atoi(argv[1]) : 100000;
+    if (iterations < 0)
+        iterations = 0;
+
+    char self[PATH_MAX];
+    ssize_t self_len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (self_len < 0) {
+        perror("readlink");
+        return 1;
+    }
+    self[self_len] = '\0';
+
+    char stub_dir[PATH_MAX];
+    strcpy(stub_dir, self);
+    dirname(stub_dir);
+
+    char doorstop_path[PATH_MAX];
+    snprintf(doorstop_path, sizeof(doorstop_path), "%s/libdoorstop.so",
+             stub_dir);
+    if (argc > 2 && !realpath(argv[2], doorstop_path)) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    // Doorstop only initializes if the target assembly exists
+    char target_path[] = "/tmp/bench_mono_jit_options_XXXXXX";
+    int target_fd = mkstemp(target_path);
+    if (target_fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(target_fd);
+
+    const char *debugger = "--debugger-agent=transport=dt_socket,server=y,"
+                           "address=" DEBUGGER_ADDRESS;
+    const char *unity[] = {"--soft-breakpoints", "--llvm", NULL};
+    const char *none[] = {NULL};
+
+    const char *no_options[] = {"--soft-breakpoints", "--llvm", NULL};
+    const char *appended[] = {"--soft-breakpoints", "--llvm",
+                              "--optimize=inline,simd", "--aot", NULL};
+    const char *deduplicated[] = {"--soft-breakpoints", "--llvm",
+                                  "--optimize=-inline", NULL};
+    const char *with_debugger[] = {"--optimize=simd", debugger, NULL};
+    const Case cases[] = {
+        {"no options", unity, NULL, 0, no_options},
+        {"blank options", unity, " \t ", 0, no_options},
+        {"appended after unity", unity, "  --optimize=inline,simd\t--aot ", 0,
+         appended},
+        {"unity options not repeated", unity,
+         "--llvm --optimize=-inline --optimize=-inline", 0, deduplicated},
+        {"debugger agent last", none, "--optimize=simd", 1, with_debugger},
+    };
+
+    int ok = 1;
+    for (size_t i = 0; ok && i < sizeof(cases) / sizeof(cases[0]); i++) {
+        Result result;
+        memset(&result, 0, sizeof(result));
+        if (!run_case(self, stub_dir, doorstop_path, target_path, &cases[i], 0,
+                      &result)) {
+            fprintf(stderr, "Case \"%s\" failed to run; check %s\n",
+                    cases[i].name, doorstop_path);
+            ok = 0;
+            break;
+        }
+        ok = check(&cases[i], &result);
+        free_result(&result);
+    }
+
+    // Time the same call with and without Doorstop in between
+    const Case timed = {"timed", unity, "--optimize=inline,simd --aot --llvm",
+                        1, none};
+    Result baseline, injected;
+    memset(&baseline, 0, sizeof(baseline));
+    memset(&injected, 0, sizeof(injected));
+    if (ok && run_case(self, stub_dir, NULL, target_path, &timed, iterations,
+                       &baseline) &&
+        run_case(self, stub_dir, doorstop_path, target_path, &timed,
+                 iterations, &injected)) {
+        printf("\n%-32s %12s %12s %12s\n", "ns per call", "baseline",
+               "doorstop", "overhead");
+        printf("%-32s %12.1f %12.1f %+12.1f\n", "mono_jit_parse_options",
+               baseline.call_ns, injected.call_ns,
+               injected.call_ns - baseline.call_ns);
+    } else if (ok) {
+        fprintf(stderr, "Timing runs failed\n");
+        ok = 0;
+    }
+    free_result(&baseline);
+    free_result(&injected);
+
+    unlink(target_path);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,272 @@
+/*
+ * Stress test and benchmark of the pool allocator that can serve il2cpp's
+ * allocations (il2cpp_pool_allocator).
+ *
+ * Usage: bench_pool [threads] [operations per thread]
+ *
+ * Every thread runs a random mix of malloc, calloc, realloc, free and their
+ * aligned variants, with sizes mostly below POOL_MAX_SIZE and some above it
+ * to reach the system allocator. Every block is filled with a pattern that is
+ * checked before it is reallocated or freed, and about a quarter of the
+ * blocks are handed to another thread through a shared exchange and freed
+ * there. The same workload is then timed against the system allocator.
+ */
+#include "util/pool.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define LIVE_BLOCKS 256
+#define EXCHANGE_SLOTS 64
+#define LARGE_SIZE (64 * 1024)
+
+// The first bytes of every block describe it, the rest holds the pattern
+typedef struct {
+    uint32_t size;
+    uint8_t aligned;
+    uint8_t pattern;
+} BlockHeader;
+
+typedef struct {
+    void *(*malloc)(size_t size);
+    void *(*calloc)(size_t count, size_t size);
+    void *(*realloc)(void *ptr, size_t size);
+    void (*free)(void *ptr);
+    void *(*aligned_malloc)(size_t size, size_t alignment);
+    void *(*aligned_realloc)(void *ptr, size_t size, size_t alignment);
+    void (*aligned_free)(void *ptr);
+} Allocator;
+
+typedef struct {
+    const Allocator *allocator;
+    unsigned int seed;
+    int ops;
+    int failed;
+} Worker;
+
+static void *exchange[EXCHANGE_SLOTS];
+
+static void *sys_aligned_malloc(size_t size, size_t alignment) {
+    void *result = NULL;
+    if (posix_memalign(&result, alignment < sizeof(void *) ? sizeof(void *)
+                                                           : alignment,
+                       size) != 0)
+        return NULL;
+    return result;
+}
+
+static void *sys_aligned_realloc(void *ptr, size_t size, size_t alignment) {
+    void *result = sys_aligned_malloc(size, alignment);
+    if (result && ptr) {
+        size_t old_size = ((BlockHeader *)ptr)->size;
+        memcpy(result, ptr, old_size < size ? old_size : size);
+        free(ptr);
+    }
+    return result;
+}
+
+static const Allocator pool_allocator = {
+    pool_malloc,         pool_calloc,          pool_realloc,
+    pool_free,           pool_aligned_malloc,  pool_aligned_realloc,
+    pool_aligned_free,
+};
+
+static const Allocator system_allocator = {
+    malloc, calloc, realloc, free, sys_aligned_malloc, sys_aligned_realloc,
+    free,
+};
+
+static unsigned int next_random(unsigned int *state) {
+    // xorshift32
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static size_t random_size(unsigned int *state) {
+    unsigned int r = next_random(state);
+    if (r % 64 == 0)
+        return POOL_MAX_SIZE + 1 + r % LARGE_SIZE;
+    if (r % 4 == 0)
+        return sizeof(BlockHeader) + r % POOL_MAX_SIZE;
+    return sizeof(BlockHeader) + r % 128;
+}
+
+static void fill(void *ptr, size_t size, int aligned, unsigned char pattern) {
+    BlockHeader *header = ptr;
+    header->size = (uint32_t)size;
+    header->aligned = (uint8_t)aligned;
+    header->pattern = pattern;
+    memset((char *)ptr + sizeof(BlockHeader), pattern,
+           size - sizeof(BlockHeader));
+}
+
+static int verify(const void *ptr, size_t size) {
+    const BlockHeader *header = ptr;
+    if (header->size < size)
+        size = header->size;
+    const unsigned char *bytes = ptr;
+    for (size_t i = sizeof(BlockHeader); i < size; i++) {
+        if (bytes[i] != header->pattern)
+            return 0;
+    }
+    return 1;
+}
+
+static int release(const Allocator *allocator, void *ptr) {
+    if (!ptr)
+        return 1;
+    int ok = verify(ptr, ((BlockHeader *)ptr)->size);
+    if (((BlockHeader *)ptr)->aligned)
+        allocator->aligned_free(ptr);
+    else
+        allocator->free(ptr);
+    return ok;
+}
+
+static void *run_worker(void *arg) {
+    Worker *worker = arg;
+    const Allocator *allocator = worker->allocator;
+    unsigned int state = worker->seed;
+    void *live[LIVE_BLOCKS] = {0};
+
+    for (int op = 0; op < worker->ops && !worker->failed; op++) {
+        unsigned int r = next_random(&state);
+        void **slot = &live[r % LIVE_BLOCKS];
+        unsigned char pattern = (unsigned char)(r >> 24);
+        size_t size = random_size(&state);
+
+        if (!*slot) {
+            switch (r % 3) {
+            case 0:
+                *slot = allocator->malloc(size);
+                break;
+            case 1:
+                *slot = allocator->calloc(1, size);
+                for (size_t i = 0; *slot && i < size; i++)
+                    worker->failed |= ((unsigned char *)*slot)[i] != 0;
+                break;
+            default: {
+                // Alignments above 16 bytes go to the system allocator
+                size_t alignment = (r >> 8) % 8 ? 16 : 64;
+                *slot = allocator->aligned_malloc(size, alignment);
+                worker->failed |= ((uintptr_t)*slot & (alignment - 1)) != 0;
+                break;
+            }
+            }
+            if (!*slot) {
+                worker->failed = 1;
+                break;
+            }
+            fill(*slot, size, r % 3 == 2, pattern);
+            continue;
+        }
+
+        BlockHeader *header = *slot;
+        switch (r % 4) {
+        case 0: {
+            // Grow or shrink, keeping the contents up to the smaller size
+            size_t old_size = header->size;
+            int aligned = header->aligned;
+            void *result =
+                aligned ? allocator->aligned_realloc(*slot, size, 16)
+                        : allocator->realloc(*slot, size);
+            if (!result) {
+                worker->failed = 1;
+                break;
+            }
+            ((BlockHeader *)result)->size =
+                (uint32_t)(old_size < size ? old_size : size);
+            worker->failed |= !verify(result, size);
+            fill(result, size, aligned, pattern);
+            *slot = result;
+            break;
+        }
+        case 1: {
+            // Hand the block to another thread and free the one it left
+            void *other = __atomic_exchange_n(
+                &exchange[r % EXCHANGE_SLOTS], *slot, __ATOMIC_ACQ_REL);
+            *slot = NULL;
+            worker->failed |= !release(allocator, other);
+            break;
+        }
+        default:
+            worker->failed |= !release(allocator, *slot);
+            *slot = NULL;
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < LIVE_BLOCKS; i++)
+        worker->failed |= !release(allocator, live[i]);
+    return NULL;
+}
+
+static double run(const Allocator *allocator, int threads, int ops,
+                  int *failed) {
+    pthread_t *handles = calloc(threads, sizeof(pthread_t));
+    Worker *workers = calloc(threads, sizeof(Worker));
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < threads; i++) {
+        workers[i].allocator = allocator;
+        workers[i].seed = 2463534242u + i * 7919;
+        workers[i].ops = ops;
+        pthread_create(&handles[i], NULL, run_worker, &workers[i]);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(handles[i], NULL);
+        *failed |= workers[i].failed;
+    }
+    for (size_t i = 0; i < EXCHANGE_SLOTS; i++) {
+        *failed |= !release(allocator, exchange[i]);
+        exchange[i] = NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    free(handles);
+    free(workers);
+    return ((end.tv_sec - start.tv_sec) * 1e9 +
+            (end.tv_nsec - start.tv_nsec)) /
+           ((double)threads * ops);
+}
+
+int main(int argc, char **argv) {
+    int threads = argc > 1 ? atoi(argv[1]) : 8;
+    int ops = argc > 2 ? atoi(argv[2]) : 1000000;
+    if (threads < 1)
+        threads = 1;
+    if (ops < 1)
+        ops = 1;
+
+    if (!pool_init()) {
+        printf("Failed to initialize the pool\n");
+        return 1;
+    }
+
+    int failed = 0;
+    double pool_ns = run(&pool_allocator, threads, ops, &failed);
+    PoolStats stats;
+    pool_get_stats(&stats);
+    // Thread caches merge their counters when their thread exits
+    if (stats.allocs != stats.frees) {
+        printf("Pool: %zu allocations but %zu frees\n", stats.allocs,
+               stats.frees);
+        failed = 1;
+    }
+    double system_ns = run(&system_allocator, threads, ops, &failed);
+
+    printf("%d threads x %d operations, %zu allocations (%zu from the system "
+           "allocator)\n",
+           threads, ops, stats.allocs, stats.system_allocs);
+    printf("%-12s %10s\n", "allocator", "ns/op");
+    printf("%-12s %10.1f\n", "pool", pool_ns);
+    printf("%-12s %10.1f\n", "system", system_ns);
+    if (failed)
+        printf("Corrupted or misaligned blocks were found\n");
+    return failed ? 1 : 0;
+}
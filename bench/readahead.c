@@ -0,0 +1,239 @@
+/*
+ * Measures how much boot readahead shortens a cold start.
+ *
+ * Usage: bench_readahead [runs] [files] [file_kib] [work_us]
+ *
+ * A folder of files stands in for the Managed folder and
+ * global-metadata.dat. A boot opens and reads every file in order and then
+ * spends work_us of CPU time on it, like the runtime parsing an assembly.
+ * The first boot records the opened files with readahead_record, as the open
+ * hooks do, into a list. Each run then evicts the files from the page cache
+ * and boots twice: once on its own and once right after readahead_init has
+ * started replaying the list. The medians of both are compared with a boot
+ * from a warm cache.
+ *
+ * The folder is created in the working directory, which must not be on a
+ * tmpfs: its pages can't be evicted, so every boot would be warm.
+ */
+#define _GNU_SOURCE
+#include "config/config.h"
+#include "nix/readahead.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_RUNS 64
+#define READ_SIZE (64 * 1024)
+
+Config config;
+
+static char dir[PATH_MAX];
+static char list_path[PATH_MAX];
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void file_path(char *path, int i) {
+    snprintf(path, PATH_MAX, "%s/Assembly%03d.dll", dir, i);
+}
+
+static int create_files(int files, size_t size) {
+    char *data = malloc(size);
+    for (size_t i = 0; i < size; i++)
+        data[i] = (char)(i * 31 + i / 4096);
+
+    char path[PATH_MAX];
+    for (int i = 0; i < files; i++) {
+        file_path(path, i);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || write(fd, data, size) != (ssize_t)size) {
+            perror(path);
+            free(data);
+            return 0;
+        }
+        // Dirty pages can't be evicted
+        fsync(fd);
+        close(fd);
+    }
+    free(data);
+    return 1;
+}
+
+static void evict(int files) {
+    char path[PATH_MAX];
+    for (int i = 0; i < files; i++) {
+        file_path(path, i);
+        int fd = open(path, O_RDONLY);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+// Fraction of the pages of the files in the page cache
+static double resident(int files, size_t size) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t pages = (size + page - 1) / page;
+    unsigned char *vec = malloc(pages);
+    size_t in_cache = 0;
+    char path[PATH_MAX];
+    for (int i = 0; i < files; i++) {
+        file_path(path, i);
+        int fd = open(path, O_RDONLY);
+        void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED && mincore(map, size, vec) == 0) {
+            for (size_t p = 0; p < pages; p++)
+                in_cache += vec[p] & 1;
+        }
+        if (map != MAP_FAILED)
+            munmap(map, size);
+        close(fd);
+    }
+    free(vec);
+    return (double)in_cache / ((double)pages * files);
+}
+
+static void work(long us) {
+    struct timespec start, now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    do {
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000 +
+                 (now.tv_nsec - start.tv_nsec) / 1000 <
+             us);
+}
+
+static double boot(int files, long work_us, int record) {
+    static char buf[READ_SIZE];
+    char path[PATH_MAX];
+    double start = now_ms();
+    for (int i = 0; i < files; i++) {
+        file_path(path, i);
+        int fd = open(path, O_RDONLY);
+        if (fd < 0)
+            continue;
+        if (record) {
+            // Files are often opened more than once
+            readahead_record(path);
+            readahead_record(path);
+        }
+        while (read(fd, buf, sizeof(buf)) > 0)
+            ;
+        close(fd);
+        work(work_us);
+    }
+    return now_ms() - start;
+}
+
+static int count_lines(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return -1;
+    int lines = 0;
+    int c;
+    while ((c = fgetc(file)) != EOF)
+        lines += c == '\n';
+    fclose(file);
+    return lines;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *values, int count) {
+    qsort(values, count, sizeof(double), compare_double);
+    return values[count / 2];
+}
+
+static void cleanup(int files) {
+    char path[PATH_MAX];
+    for (int i = 0; i < files; i++) {
+        file_path(path, i);
+        unlink(path);
+    }
+    unlink(list_path);
+    rmdir(dir);
+}
+
+int main(int argc, char **argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 5;
+    int files = argc > 2 ? atoi(argv[2]) : 64;
+    size_t size = (argc > 3 ? atol(argv[3]) : 1024) * 1024;
+    long work_us = argc > 4 ? atol(argv[4]) : 2000;
+    if (runs < 1 || runs > MAX_RUNS || files < 1 || !size) {
+        printf("Usage: bench_readahead [runs] [files] [file_kib] [work_us]\n");
+        return 1;
+    }
+
+    char template[] = "doorstop_readahead_XXXXXX";
+    if (!mkdtemp(template) || !realpath(template, dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(list_path, sizeof(list_path), "%s/readahead.txt", dir);
+    if (!create_files(files, size)) {
+        cleanup(files);
+        return 1;
+    }
+
+    config.boot_readahead_list = list_path;
+    config.boot_readahead_seconds = 1;
+    if (!readahead_init()) {
+        printf("Failed to start recording\n");
+        cleanup(files);
+        return 1;
+    }
+    boot(files, 0, 1);
+    for (int i = 0; i < 50 && count_lines(list_path) < 0; i++)
+        usleep(100000);
+    int recorded = count_lines(list_path);
+    printf("Recorded %d of %d files\n", recorded, files);
+
+    evict(files);
+    double cold_resident = resident(files, size);
+    if (cold_resident > 0.5)
+        printf("%.0f%% of the files stay cached after eviction; is the "
+               "working directory on a tmpfs?\n",
+               cold_resident * 100);
+
+    double cold[MAX_RUNS];
+    double replayed[MAX_RUNS];
+    for (int run = 0; run < runs; run++) {
+        evict(files);
+        cold[run] = boot(files, work_us, 0);
+
+        evict(files);
+        double start = now_ms();
+        readahead_init();
+        boot(files, work_us, 0);
+        replayed[run] = now_ms() - start;
+        // Let the replay thread finish before the files are evicted again
+        usleep(200000);
+    }
+    double warm = boot(files, work_us, 0);
+
+    double cold_ms = median(cold, runs);
+    double replayed_ms = median(replayed, runs);
+    printf("%d files of %lu KiB, %ld us of work per file, %d runs\n", files,
+           (unsigned long)(size / 1024), work_us, runs);
+    printf("%-20s %10.1f ms\n", "cold", cold_ms);
+    printf("%-20s %10.1f ms\n", "cold with readahead", replayed_ms);
+    printf("%-20s %10.1f ms\n", "warm", warm);
+    printf("Readahead saves %.1f ms (%.0f%% of the cold I/O time)\n",
+           cold_ms - replayed_ms,
+           cold_ms > warm ? (cold_ms - replayed_ms) / (cold_ms - warm) * 100
+                          : 0.0);
+
+    cleanup(files);
+    return recorded == files ? 0 : 1;
+}
@@ -0,0 +1,50 @@
+/*
+ * Stub of the CoreCLR hosting API that hands Doorstop a delegate recording
+ * when Doorstop.Entrypoint.Start is invoked.
+ */
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief CLOCK_MONOTONIC time of the first call to the entrypoint delegate,
+ * in nanoseconds, or 0 if it wasn't called. Read by bench_injection.
+ */
+uint64_t stub_coreclr_start_ns = 0;
+
+static char host;
+
+static void entrypoint_start() {
+    if (stub_coreclr_start_ns)
+        return;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    stub_coreclr_start_ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int coreclr_initialize(const char *exePath, const char *appDomainFriendlyName,
+                       int propertyCount, const char **propertyKeys,
+                       const char **propertyValues, void **hostHandle,
+                       unsigned int *domainId) {
+    (void)exePath;
+    (void)appDomainFriendlyName;
+    (void)propertyCount;
+    (void)propertyKeys;
+    (void)propertyValues;
+    *hostHandle = &host;
+    *domainId = 1;
+    return 0;
+}
+
+int coreclr_create_delegate(void *hostHandle, unsigned int domainId,
+                            const char *entryPointAssemblyName,
+                            const char *entryPointTypeName,
+                            const char *entryPointMethodName,
+                            void **delegate) {
+    (void)hostHandle;
+    (void)domainId;
+    (void)entryPointAssemblyName;
+    (void)entryPointTypeName;
+    (void)entryPointMethodName;
+    *delegate = (void *)entrypoint_start;
+    return 0;
+}
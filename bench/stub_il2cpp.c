@@ -0,0 +1,11 @@
+/*
+ * Stub of the functions of GameAssembly that Doorstop's bootstrap needs. The
+ * rest are no-ops from stub_il2cpp_exports.c.
+ */
+
+int il2cpp_init(const char *domain_name) {
+    (void)domain_name;
+    return 1;
+}
+
+void il2cpp_shutdown() {}
@@ -0,0 +1,66 @@
+/*
+ * Stub of the functions of libmono that Doorstop's bootstrap needs to reach
+ * Doorstop.Entrypoint.Start, and of mono_jit_parse_options to record the
+ * arguments Doorstop passes on. The rest are no-ops from
+ * stub_mono_exports.c.
+ */
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define STUB_MONO_MAX_ARGS 32
+
+/**
+ * @brief CLOCK_MONOTONIC time of the first runtime_invoke, in nanoseconds, or
+ * 0 if it wasn't called. Read by bench_injection.
+ */
+uint64_t stub_mono_invoke_ns = 0;
+
+/**
+ * @brief Copy of the arguments of the last mono_jit_parse_options call. argc
+ * is -1 if argv wasn't NULL-terminated. Read by bench_mono_jit_options.
+ */
+int stub_mono_jit_argc = 0;
+char *stub_mono_jit_argv[STUB_MONO_MAX_ARGS];
+
+static char root_domain;
+static char entrypoint;
+
+char *mono_assembly_getrootdir() { return "/usr/lib/mono/4.5"; }
+
+void *mono_jit_init_version(const char *root_domain_name,
+                            const char *runtime_version) {
+    (void)root_domain_name;
+    (void)runtime_version;
+    return &root_domain;
+}
+
+void mono_jit_parse_options(int argc, char **argv) {
+    for (int i = 0; i < STUB_MONO_MAX_ARGS && stub_mono_jit_argv[i]; i++) {
+        free(stub_mono_jit_argv[i]);
+        stub_mono_jit_argv[i] = NULL;
+    }
+    stub_mono_jit_argc = argv[argc] == NULL ? argc : -1;
+    for (int i = 0; i < argc && i < STUB_MONO_MAX_ARGS; i++)
+        stub_mono_jit_argv[i] = strdup(argv[i]);
+}
+
+void *mono_method_desc_search_in_image(void *desc, void *image) {
+    (void)desc;
+    (void)image;
+    return &entrypoint;
+}
+
+void *mono_runtime_invoke(void *method, void *obj, void **params, void **exc) {
+    (void)obj;
+    (void)params;
+    if (method == &entrypoint && !stub_mono_invoke_ns) {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        stub_mono_invoke_ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    }
+    if (exc)
+        *exc = NULL;
+    return NULL;
+}
@@ -0,0 +1,15 @@
+/*
+ * Exports every function Doorstop imports from mono as a no-op returning 0.
+ *
+ * The prototypes don't matter to the callers, which only look the functions
+ * up with dlsym. Functions the bootstrap depends on are overridden in
+ * stub_mono.c.
+ */
+#include <stddef.h>
+
+#define DEF_CALL(ret_type, name, ...)                                          \
+    __attribute__((weak)) void *mono_##name() { return NULL; }
+#define DEFINE_CALLS
+#include "runtimes/mono.h"
+#undef DEFINE_CALLS
+#undef DEF_CALL
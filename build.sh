@@ -3,6 +3,7 @@
 # Script that downloads xmake if it's missing and builds the project
 # Parameters
 # -with_logging : enable logging
+# -binary_log : enable logging in the binary format read by log_decoder
 # -arch=<arch> : comma-separated list of architectures to build for
 # ... : additional parameters passed to xmake
 
@@ -65,10 +66,11 @@ commands_exist () {
 
 help () {
   echo "
-    ./build.sh [-with_logging] [-arch=<arch>] [--help|-h] [...]
+    ./build.sh [-with_logging] [-binary_log] [-arch=<arch>] [--help|-h] [...]
     Script that downloads xmake if it's missing and builds the project
       Parameters
         -with_logging : enable logging
+        -binary_log : enable logging in the binary format read by log_decoder
         -arch=<arch> : comma-separated list of architectures to build for
         -h, --help: show this help message
         ... : additional parameters passed to xmake
@@ -77,6 +79,7 @@ help () {
 
 # Parse parameters into variables
 WITH_LOGGING="n"
+BINARY_LOG="n"
 PROFILE="release"
 # Bash list of architectures to build for
 ARCHS=("x86" "x64")
@@ -90,6 +93,10 @@ while [[ $# > 0 ]]; do
             WITH_LOGGING="y"
             shift
             ;;
+        -binary_log)
+            BINARY_LOG="y"
+            shift
+            ;;
         -debug)
             PROFILE="debug"
             shift
@@ -250,14 +257,14 @@ fi
 
 if [[ "$(uname)" == "Darwin" ]]; then
   log-8601-local "Building for macOS universal binary..."
-  "$xmake" f -m $PROFILE --include_logging=$WITH_LOGGING
+  "$xmake" f -m $PROFILE --include_logging=$WITH_LOGGING --binary_log=$BINARY_LOG
   "$xmake" "$@"
 else
   # Build projects for each arch
   for arch in "${ARCHS[@]}"
   do
       log-8601-local "Building for $arch..."
-      "$xmake" f -a $arch -m $PROFILE --include_logging=$WITH_LOGGING
+      "$xmake" f -a $arch -m $PROFILE --include_logging=$WITH_LOGGING --binary_log=$BINARY_LOG
       "$xmake" "$@"
   done
 fi
@@ -1,16 +1,53 @@
+#define LOG_CATEGORY LOG_CAT_BOOTSTRAP
 #include "bootstrap.h"
 #include "config/config.h"
 #include "crt.h"
+#include "preload/preload.h"
+#include "preload/warmup.h"
 #include "runtimes/coreclr.h"
 #include "runtimes/il2cpp.h"
 #include "runtimes/mono.h"
+#include "util/arena.h"
+#include "util/args.h"
 #include "util/logging.h"
 #include "util/paths.h"
+#include "util/pool.h"
+#include "util/profiler.h"
+#include "util/thread.h"
+#include "util/token_cache.h"
+#include "util/trace.h"
 #include "util/util.h"
 
 bool_t mono_debug_init_called = FALSE;
 bool_t mono_is_net35 = FALSE;
 
+// Transient allocations of the main thread until the runtime is bootstrapped
+static Arena boot_arena;
+
+// Names returned by the runtime are UTF-8 on every platform
+static bool_t utf8_equal(const char *a, const char *b) {
+    if (!a || !b)
+        return FALSE;
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+/**
+ * @brief Check that a method resolved from a cached token is still
+ * Doorstop.Entrypoint:Start. An assembly rebuilt or copied with its old
+ * modification time may keep the same stamp, and the token then names another
+ * method.
+ */
+static bool_t is_entrypoint(void *method) {
+    void *klass = mono.method_get_class(method);
+    return klass && utf8_equal(mono.method_get_name(method), "Start") &&
+           utf8_equal(mono.class_get_name(klass), "Entrypoint") &&
+           utf8_equal(mono.class_get_namespace(klass), "Doorstop");
+}
+
 void mono_doorstop_bootstrap(void *mono_domain) {
     if (getenv(TEXT("DOORSTOP_INITIALIZED"))) {
         LOG("DOORSTOP_INITIALIZED is set! Skipping!");
@@ -20,27 +57,20 @@ void mono_doorstop_bootstrap(void *mono_domain) {
 
     mono.thread_set_main(mono.thread_current());
 
-    char_t *app_path = program_path();
+    char_t *app_path = arena_program_path(&boot_arena);
     if (mono.domain_set_config) {
 #define CONFIG_EXT TEXT(".config")
         char_t *config_path =
-            calloc(strlen(app_path) + 1 + STR_LEN(CONFIG_EXT), sizeof(char_t));
-        strcpy(config_path, app_path);
-        strcat(config_path, CONFIG_EXT);
-        char_t *folder_path = get_folder_name(app_path);
+            arena_concat(&boot_arena, app_path, CONFIG_EXT, NULL);
+        char_t *folder_path = arena_folder_name(&boot_arena, app_path);
 
-        char *config_path_n = narrow(config_path);
-        char *folder_path_n = narrow(folder_path);
+        char *config_path_n = arena_narrow(&boot_arena, config_path);
+        char *folder_path_n = arena_narrow(&boot_arena, folder_path);
 
         LOG("Setting config paths: base dir: %s; config path: %s\n",
             folder_path, config_path);
 
         mono.domain_set_config(mono_domain, folder_path_n, config_path_n);
-
-        free(folder_path);
-        free(config_path);
-        free(config_path_n);
-        free(folder_path_n);
 #undef CONFIG_EXT
     }
 
@@ -48,174 +78,295 @@ void mono_doorstop_bootstrap(void *mono_domain) {
     setenv(TEXT("DOORSTOP_PROCESS_PATH"), app_path, TRUE);
 
     char *assembly_dir = mono.assembly_getrootdir();
-    char_t *norm_assembly_dir = widen(assembly_dir);
+    char_t *norm_assembly_dir = arena_widen(&boot_arena, assembly_dir);
 
     mono.config_parse(NULL);
 
     LOG("Assembly dir: %s", norm_assembly_dir);
     setenv(TEXT("DOORSTOP_MANAGED_FOLDER_DIR"), norm_assembly_dir, TRUE);
-    free(norm_assembly_dir);
 
     LOG("Opening assembly: %s", config.target_assembly);
-    void *file = fopen(config.target_assembly, "r");
-    if (!file) {
-        LOG("Failed to open assembly: %s", config.target_assembly);
+    size_t size = 0;
+    // Preloaded buffers live for the whole process, so mono can use them
+    // without making its own copy
+    bool_t need_copy = FALSE;
+    void *data = preload_get(config.target_assembly, &size);
+    if (!data) {
+        need_copy = TRUE;
+        data = read_assembly_file(config.target_assembly, &size);
+    }
+    if (!data) {
+        LOG_ERROR("Failed to open assembly: %s", config.target_assembly);
         return;
     }
 
-    size_t size = get_file_size(file);
-    void *data = malloc(size);
-    fread(data, size, 1, file);
-    fclose(file);
-
     LOG("Opened Assembly DLL (%d bytes); opening its main image", size);
 
-    char *dll_path = narrow(config.target_assembly);
+    // The entrypoint token is keyed on the stamp of the assembly rather than
+    // on a hash of its contents, which would cost a pass over the whole
+    // assembly on every boot. The method it resolves to is checked instead.
+    FileStamp stamp;
+    bool_t use_token_cache = mono.get_method && mono.method_get_token &&
+                             mono.method_get_name && mono.method_get_class &&
+                             mono.class_get_name && mono.class_get_namespace &&
+                             get_file_stamp(config.target_assembly, &stamp);
+
+    char *dll_path = arena_narrow(&boot_arena, config.target_assembly);
     MonoImageOpenStatus s = MONO_IMAGE_OK;
-    void *image = mono.image_open_from_data_with_name(data, size, TRUE, &s,
-                                                      FALSE, dll_path);
-    free(data);
+    trace_begin("image_open_from_data_with_name");
+    void *image = mono.image_open_from_data_with_name(data, size, need_copy,
+                                                      &s, FALSE, dll_path);
+    trace_end("image_open_from_data_with_name");
+    if (need_copy)
+        free(data);
     if (s != MONO_IMAGE_OK) {
-        LOG("Failed to load assembly image: %s. Got result: %d\n",
-            config.target_assembly, s);
+        LOG_ERROR("Failed to load assembly image: %s. Got result: %d\n",
+                  config.target_assembly, s);
         return;
     }
 
     LOG("Image opened; loading included assembly");
 
     s = MONO_IMAGE_OK;
+    trace_begin("assembly_load_from_full");
     void *assembly = mono.assembly_load_from_full(image, dll_path, &s, FALSE);
-    free(dll_path);
+    trace_end("assembly_load_from_full");
     if (s != MONO_IMAGE_OK) {
-        LOG("Failed to load assembly: %s. Got result: %d\n",
-            config.target_assembly, s);
+        LOG_ERROR("Failed to load assembly: %s. Got result: %d\n",
+                  config.target_assembly, s);
         return;
     }
 
-    LOG("Assembly loaded; looking for Doorstop.Entrypoint:Start");
-    void *desc = mono.method_desc_new("Doorstop.Entrypoint:Start", TRUE);
-    void *method = mono.method_desc_search_in_image(desc, image);
-    mono.method_desc_free(desc);
+    void *method = NULL;
+    char_t *cache_path = NULL;
+    if (use_token_cache) {
+        cache_path = token_cache_path(config.target_assembly);
+        unsigned int token = 0;
+        if (token_cache_load(cache_path, &stamp, &token)) {
+            LOG("Assembly loaded; resolving entrypoint from cached token "
+                "0x%08x",
+                token);
+            method = mono.get_method(image, token, NULL);
+            if (method && !is_entrypoint(method)) {
+                LOG_WARN("Cached token 0x%08x is not the entrypoint anymore",
+                         token);
+                method = NULL;
+            }
+        }
+    }
+
+    if (!method) {
+        LOG("Assembly loaded; looking for Doorstop.Entrypoint:Start");
+        void *desc = mono.method_desc_new("Doorstop.Entrypoint:Start", TRUE);
+        method = mono.method_desc_search_in_image(desc, image);
+        mono.method_desc_free(desc);
+        if (method && cache_path &&
+            !token_cache_store(cache_path, &stamp,
+                               mono.method_get_token(method)))
+            LOG_WARN("Failed to write entrypoint token cache: %s", cache_path);
+    }
+    if (cache_path)
+        free(cache_path);
     if (!method) {
-        LOG("Failed to find method Doorstop.Entrypoint:Start");
+        LOG_ERROR("Failed to find method Doorstop.Entrypoint:Start");
         return;
     }
 
     void *signature = mono.method_signature(method);
     unsigned int params = mono.signature_get_param_count(signature);
     if (params != 0) {
-        LOG("Method has %d parameters; expected 0", params);
+        LOG_ERROR("Method has %d parameters; expected 0", params);
         return;
     }
 
     LOG("Invoking method %p", method);
     void *exc = NULL;
+    trace_begin("Doorstop.Entrypoint.Start");
     mono.runtime_invoke(method, NULL, NULL, &exc);
+    trace_end("Doorstop.Entrypoint.Start");
     if (exc != NULL) {
-        LOG("Error invoking code!");
+        LOG_ERROR("Error invoking code!");
         if (mono.object_to_string) {
             void *str = mono.object_to_string(exc, NULL);
             char *exc_str_n = mono.string_to_utf8(str);
-            char_t *exc_str = widen(exc_str_n);
-            LOG("Error message: %s", exc_str);
+            LOG_ERROR("Error message: %s",
+                      arena_widen(&boot_arena, exc_str_n));
             LOG("\n");
-            free(exc_str);
             mono.free(exc_str_n);
         }
     }
     LOG("Done");
+}
 
-    free(app_path);
+#if _WIN32
+#define NAME_EQUAL(a, b) (lstrcmp(a, b) == 0)
+#else
+#define NAME_EQUAL(a, b) (strcmp(a, b) == 0)
+#endif
+
+typedef struct {
+    const char_t *name;
+    char_t *old_value;
+    bool_t set;
+} ScopedEnv;
+
+static void scoped_env_set(ScopedEnv *env, const char_t *name,
+                           const char_t *value) {
+    env->name = name;
+    char_t *old_value = getenv(name);
+    env->old_value = old_value ? strdup(old_value) : NULL;
+    shutenv(old_value);
+    env->set = setenv(name, value, TRUE) == 0;
+    if (!env->set && env->old_value) {
+        free(env->old_value);
+        env->old_value = NULL;
+    }
+}
+
+static void scoped_env_restore(ScopedEnv *env) {
+    if (!env->set)
+        return;
+    if (env->old_value) {
+        setenv(env->name, env->old_value, TRUE);
+        free(env->old_value);
+    } else {
+        unsetenv(env->name);
+    }
+    env->set = FALSE;
+}
+
+static bool_t is_gc_size(const char_t *value) {
+    // SGen accepts a decimal size with an optional k, m or g suffix
+    size_t len = strlen(value);
+    if (!len)
+        return FALSE;
+    char_t suffix = value[len - 1];
+    if (suffix == 'k' || suffix == 'K' || suffix == 'm' || suffix == 'M' ||
+        suffix == 'g' || suffix == 'G')
+        len--;
+    if (!len)
+        return FALSE;
+    for (size_t i = 0; i < len; i++) {
+        if (value[i] < '0' || value[i] > '9')
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static bool_t is_gc_major(const char_t *value) {
+    static const char_t *majors[] = {
+        TEXT("marksweep"),
+        TEXT("marksweep-conc"),
+        TEXT("marksweep-conc-par"),
+    };
+    for (size_t i = 0; i < STR_LEN(majors); i++) {
+        if (NAME_EQUAL(value, majors[i]))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static void append_gc_param(char_t **params, const char_t *name,
+                            const char_t *value) {
+    size_t len = *params ? strlen(*params) : 0;
+    size_t name_len = name ? strlen(name) : 0;
+    char_t *result =
+        calloc(len + name_len + strlen(value) + 2, sizeof(char_t));
+    if (*params) {
+        strcpy(result, *params);
+        strcat(result, TEXT(","));
+        free(*params);
+    }
+    if (name)
+        strcat(result, name);
+    strcat(result, value);
+    *params = result;
+}
+
+/**
+ * @brief Build MONO_GC_PARAMS from the existing value and the configuration.
+ *
+ * SGen applies the options in order, so the configured ones are appended
+ * after the inherited ones to take precedence.
+ *
+ * @remark Return value must be freed by caller.
+ *
+ * @return char_t* The new value, or NULL if no GC parameters are configured.
+ */
+static char_t *build_mono_gc_params() {
+    char_t *params = NULL;
+    if (config.mono_gc_params)
+        append_gc_param(&params, NULL, config.mono_gc_params);
+    if (config.mono_gc_nursery_size) {
+        if (is_gc_size(config.mono_gc_nursery_size))
+            append_gc_param(&params, TEXT("nursery-size="),
+                            config.mono_gc_nursery_size);
+        else
+            LOG_WARN("Ignoring invalid GC nursery size: %s",
+                     config.mono_gc_nursery_size);
+    }
+    if (config.mono_gc_major) {
+        if (is_gc_major(config.mono_gc_major))
+            append_gc_param(&params, TEXT("major="), config.mono_gc_major);
+        else
+            LOG_WARN("Ignoring unknown GC major collector: %s",
+                     config.mono_gc_major);
+    }
+    if (config.mono_gc_soft_heap_limit) {
+        if (is_gc_size(config.mono_gc_soft_heap_limit))
+            append_gc_param(&params, TEXT("soft-heap-limit="),
+                            config.mono_gc_soft_heap_limit);
+        else
+            LOG_WARN("Ignoring invalid GC soft heap limit: %s",
+                     config.mono_gc_soft_heap_limit);
+    }
+    if (!params)
+        return NULL;
+
+    char_t *inherited = getenv(TEXT("MONO_GC_PARAMS"));
+    if (inherited && strlen(inherited)) {
+        char_t *configured = params;
+        params = NULL;
+        append_gc_param(&params, NULL, inherited);
+        append_gc_param(&params, NULL, configured);
+        free(configured);
+    }
+    shutenv(inherited);
+    return params;
 }
 
 void *init_mono(const char *root_domain_name, const char *runtime_version) {
-    char_t *root_domain_name_w = widen(root_domain_name);
-    char_t *runtime_version_w = widen(runtime_version);
-    LOG("Starting mono domain \"%s\"", root_domain_name_w);
+    trace_begin("init_mono");
+    char_t *runtime_version_w = arena_widen(&boot_arena, runtime_version);
+    LOG("Starting mono domain \"%s\"",
+        arena_widen(&boot_arena, root_domain_name));
     LOG("Runtime version: %s", runtime_version_w);
     if (strlen(runtime_version_w) > 2 &&
         (runtime_version_w[1] == L'2' || runtime_version_w[1] == L'1')) {
         mono_is_net35 = TRUE;
     }
-    free(root_domain_name_w);
-    free(runtime_version_w);
     char *root_dir_n = mono.assembly_getrootdir();
-    char_t *root_dir = widen(root_dir_n);
+    char_t *root_dir = arena_widen(&boot_arena, root_dir_n);
     LOG("Current root: %s", root_dir);
 
     LOG("Overriding mono DLL search path");
 
-    size_t mono_search_path_len = strlen(root_dir) + 1;
-
-    char_t *override_dir_full = NULL;
-    char_t *config_path_value = config.mono_dll_search_path_override;
-    bool_t has_override = config_path_value && strlen(config_path_value);
-    if (has_override) {
-        size_t path_start = 0;
-        override_dir_full = calloc(MAX_PATH, sizeof(char_t));
-        memset(override_dir_full, 0, MAX_PATH * sizeof(char_t));
-
-        bool_t found_path = FALSE;
-        for (size_t i = 0; i <= strlen(config_path_value); i++) {
-            char_t current_char = config_path_value[i];
-            if (current_char == *PATH_SEP || current_char == 0) {
-                if (i <= path_start) {
-                    path_start++;
-                    continue;
-                }
-
-                size_t path_len = i - path_start;
-                char_t *path = calloc(path_len + 1, sizeof(char_t));
-                strncpy(path, config_path_value + path_start, path_len);
-                path[path_len] = 0;
-
-                char_t *full_path = get_full_path(path);
-
-                if (strlen(override_dir_full) + strlen(full_path) + 2 >
-                    MAX_PATH) {
-                    LOG("Ignoring this root path because its absolute version "
-                        "is too long: %s",
-                        full_path);
-                    free(path);
-                    free(full_path);
-                    path_start = i + 1;
-                    continue;
-                }
-
-                if (found_path) {
-                    strcat(override_dir_full, PATH_SEP);
-                }
-
-                strcat(override_dir_full, full_path);
-                LOG("Adding root path: %s", full_path);
-
-                free(path);
-                free(full_path);
-
-                found_path = TRUE;
-                path_start = i + 1;
-            }
-        }
-
-        mono_search_path_len += strlen(override_dir_full) + 1;
-    }
+    // Search paths were resolved and the target assembly and compressed
+    // overrides read by the warm-up thread while Unity was starting up
+    char_t *override_dir_full = warmup_override_dirs();
+    if (override_dir_full)
+        LOG("Override root paths: %s", override_dir_full);
 
-    char_t *mono_search_path = calloc(mono_search_path_len + 1, sizeof(char_t));
-    if (override_dir_full && strlen(override_dir_full)) {
-        strcat(mono_search_path, override_dir_full);
-        strcat(mono_search_path, PATH_SEP);
-    }
-    strcat(mono_search_path, root_dir);
+    char_t *mono_search_path =
+        override_dir_full && strlen(override_dir_full)
+            ? arena_concat(&boot_arena, override_dir_full, PATH_SEP, root_dir,
+                           NULL)
+            : root_dir;
 
     LOG("Mono search path: %s", mono_search_path);
-    char *mono_search_path_n = narrow(mono_search_path);
+    char *mono_search_path_n = arena_narrow(&boot_arena, mono_search_path);
     mono.set_assemblies_path(mono_search_path_n);
     setenv(TEXT("DOORSTOP_DLL_SEARCH_DIRS"), mono_search_path, TRUE);
-    free(mono_search_path);
-    free(mono_search_path_n);
-    if (override_dir_full) {
-        free(override_dir_full);
-    }
 
     hook_mono_jit_parse_options(0, NULL);
 
@@ -229,14 +380,69 @@ void *init_mono(const char *root_domain_name, const char *runtime_version) {
         LOG("Detected mono debugger is not initialized; initialized it");
         mono.debug_init(MONO_DEBUG_FORMAT_MONO);
     }
+
+    // Mono reads the GC settings while the root domain is initialized; they
+    // are only set for that long so they don't leak into child processes
+    ScopedEnv gc_params_env = {0};
+    ScopedEnv gc_debug_env = {0};
+    char_t *gc_params = build_mono_gc_params();
+    if (gc_params) {
+        LOG("MONO_GC_PARAMS: %s", gc_params);
+        scoped_env_set(&gc_params_env, TEXT("MONO_GC_PARAMS"), gc_params);
+        free(gc_params);
+    }
+    if (config.mono_gc_debug) {
+        LOG("MONO_GC_DEBUG: %s", config.mono_gc_debug);
+        scoped_env_set(&gc_debug_env, TEXT("MONO_GC_DEBUG"),
+                       config.mono_gc_debug);
+    }
+
+    if (config.perf_map) {
+        // mono only handles --jitmap in its own main, so it can't be passed
+        // through mono_jit_parse_options
+        if (mono.enable_jit_map) {
+            LOG("Writing JIT map to /tmp/perf-<pid>.map");
+            mono.enable_jit_map();
+        } else {
+            LOG("This mono build doesn't support JIT maps");
+        }
+    }
+
+    trace_begin("jit_init_version");
     domain = mono.jit_init_version(root_domain_name, runtime_version);
+    trace_end("jit_init_version");
+
+    if (gc_params_env.set || gc_debug_env.set) {
+        scoped_env_restore(&gc_params_env);
+        scoped_env_restore(&gc_debug_env);
+        LOG("Restored GC environment");
+    }
 
     mono_doorstop_bootstrap(domain);
 
+    trace_end("init_mono");
+    trace_write();
+    arena_reset(&boot_arena, TEXT("mono bootstrap"));
     return domain;
 }
 
-void il2cpp_doorstop_bootstrap() {
+typedef struct {
+    char_t *app_path;
+    char_t *target_dir;
+    char_t *app_paths_env;
+    void (*startup)();
+    unsigned long long init_start;
+    unsigned long long init_end;
+} ClrBootstrap;
+
+static ClrBootstrap clr_bootstrap;
+
+/**
+ * @brief Resolve the paths of the entrypoint and export them to the
+ * environment before CoreCLR is initialized, so that the managed side sees
+ * them at every stage. Runs on the main thread.
+ */
+static void clr_doorstop_prepare() {
     if (!config.clr_corlib_dir || !config.clr_runtime_coreclr_path) {
         LOG("No CoreCLR paths set, skipping loading");
         return;
@@ -251,72 +457,281 @@ void il2cpp_doorstop_bootstrap() {
         return;
     }
 
+    // Kept until the entrypoint is invoked, which is before the arena is reset
+    char_t *app_path = arena_program_path(&boot_arena);
+    char_t *target_dir = arena_folder_name(&boot_arena, config.target_assembly);
+    char_t *app_paths_env = arena_concat(&boot_arena, config.clr_corlib_dir,
+                                         PATH_SEP, target_dir, NULL);
+
+    setenv(TEXT("DOORSTOP_INITIALIZED"), TEXT("TRUE"), TRUE);
+    setenv(TEXT("DOORSTOP_INVOKE_DLL_PATH"), config.target_assembly, TRUE);
+    setenv(TEXT("DOORSTOP_MANAGED_FOLDER_DIR"), config.clr_corlib_dir, TRUE);
+    setenv(TEXT("DOORSTOP_PROCESS_PATH"), app_path, TRUE);
+    setenv(TEXT("DOORSTOP_DLL_SEARCH_DIRS"), app_paths_env, TRUE);
+
+    clr_bootstrap.app_path = app_path;
+    clr_bootstrap.target_dir = target_dir;
+    clr_bootstrap.app_paths_env = app_paths_env;
+}
+
+/**
+ * @brief Load and initialize CoreCLR and resolve the entrypoint. May run on
+ * a background thread, so it must not touch the environment.
+ *
+ * @param arena Arena of the calling thread for transient allocations.
+ */
+static void clr_doorstop_initialize(Arena *arena) {
+    // The paths are only set if CoreCLR is set up
+    if (!clr_bootstrap.app_path)
+        return;
+
     void *coreclr_module = dlopen(config.clr_runtime_coreclr_path, RTLD_LAZY);
     LOG("Loaded coreclr.dll: %p", coreclr_module);
     if (!coreclr_module) {
-        LOG("Failed to load CoreCLR runtime!");
+        LOG_ERROR("Failed to load CoreCLR runtime!");
         return;
     }
 
     load_coreclr_funcs(coreclr_module);
 
-    char_t *app_path = program_path();
-    char *app_path_n = narrow(app_path);
+    char_t *app_path = clr_bootstrap.app_path;
+    char *app_path_n = arena_narrow(arena, app_path);
+
+    char_t *target_dir = clr_bootstrap.target_dir;
+    char_t *target_name = arena_file_name(arena, config.target_assembly, FALSE);
+    char *target_name_n = arena_narrow(arena, target_name);
+
+    char_t *app_paths_env = clr_bootstrap.app_paths_env;
+    const char *app_paths_env_n = arena_narrow(arena, app_paths_env);
+
+    // CoreCLR expects folder properties to end with a separator
+    char_t *base_dir = arena_concat(arena, target_dir, DIR_SEP, NULL);
+    char *base_dir_n = arena_narrow(arena, base_dir);
 
-    char_t *target_dir = get_folder_name(config.target_assembly);
-    char *target_dir_n = narrow(target_dir);
-    char_t *target_name = get_file_name(config.target_assembly, FALSE);
-    char *target_name_n = narrow(target_name);
+    char_t *native_dirs = arena_concat(arena, config.clr_corlib_dir, DIR_SEP,
+                                       PATH_SEP, base_dir, NULL);
+    char *native_dirs_n = arena_narrow(arena, native_dirs);
 
-    char_t *app_paths_env =
-        calloc(strlen(config.clr_corlib_dir) + 1 + strlen(target_dir) + 1,
-               sizeof(char_t));
-    strcat(app_paths_env, config.clr_corlib_dir);
-    strcat(app_paths_env, PATH_SEP);
-    strcat(app_paths_env, target_dir);
-    const char *app_paths_env_n = narrow(app_paths_env);
+    // Listing the framework up front lets CoreCLR bind it without probing
+    // and use the ReadyToRun code of the framework images
+    char_t *tpa = warmup_trusted_assemblies();
+    char *tpa_n = tpa ? arena_narrow(arena, tpa) : NULL;
 
     LOG("App path: %s", app_path);
     LOG("Target dir: %s", target_dir);
     LOG("Target name: %s", target_name);
     LOG("APP_PATHS: %s", app_paths_env);
+    LOG("NATIVE_DLL_SEARCH_DIRECTORIES: %s", native_dirs);
+
+#define BUILTIN_PROPERTY_COUNT 4
+    size_t prop_capacity =
+        BUILTIN_PROPERTY_COUNT + config.clr_runtime_property_count;
+    const char **prop_keys = arena_alloc(arena, prop_capacity * sizeof(char *));
+    const char **prop_values =
+        arena_alloc(arena, prop_capacity * sizeof(char *));
+    int prop_count = 0;
+
+#define ADD_PROPERTY(key, value)                                               \
+    prop_keys[prop_count] = key;                                               \
+    prop_values[prop_count++] = value;
+
+    ADD_PROPERTY("APP_PATHS", app_paths_env_n);
+    ADD_PROPERTY("APP_CONTEXT_BASE_DIRECTORY", base_dir_n);
+    ADD_PROPERTY("NATIVE_DLL_SEARCH_DIRECTORIES", native_dirs_n);
+    if (tpa_n) {
+        ADD_PROPERTY("TRUSTED_PLATFORM_ASSEMBLIES", tpa_n);
+    }
+    for (size_t i = 0; i < config.clr_runtime_property_count; i++) {
+        RuntimeProperty *prop = &config.clr_runtime_properties[i];
+        LOG_DEBUG("CoreCLR runtime property: %s = %s", prop->key, prop->value);
+        ADD_PROPERTY(arena_narrow(arena, prop->key),
+                     arena_narrow(arena, prop->value));
+    }
 
-    const char *props = "APP_PATHS";
-
-    setenv(TEXT("DOORSTOP_INITIALIZED"), TEXT("TRUE"), TRUE);
-    setenv(TEXT("DOORSTOP_INVOKE_DLL_PATH"), config.target_assembly, TRUE);
-    setenv(TEXT("DOORSTOP_MANAGED_FOLDER_DIR"), config.clr_corlib_dir, TRUE);
-    setenv(TEXT("DOORSTOP_PROCESS_PATH"), app_path, TRUE);
-    setenv(TEXT("DOORSTOP_DLL_SEARCH_DIRS"), app_paths_env, TRUE);
+#undef ADD_PROPERTY
+#undef BUILTIN_PROPERTY_COUNT
 
     void *host = NULL;
     unsigned int domain_id = 0;
-    int result = coreclr.initialize(app_path_n, "Doorstop Domain", 1, &props,
-                                    &app_paths_env_n, &host, &domain_id);
+    trace_begin("coreclr_initialize");
+    int result =
+        coreclr.initialize(app_path_n, "Doorstop Domain", prop_count,
+                           prop_keys, prop_values, &host, &domain_id);
+    trace_end("coreclr_initialize");
     if (result != 0) {
-        LOG("Failed to initialize CoreCLR: 0x%08x", result);
+        LOG_ERROR("Failed to initialize CoreCLR: 0x%08x", result);
         return;
     }
 
     void (*startup)() = NULL;
+    trace_begin("coreclr_create_delegate");
     result = coreclr.create_delegate(host, domain_id, target_name_n,
                                      "Doorstop.Entrypoint", "Start",
                                      (void **)&startup);
+    trace_end("coreclr_create_delegate");
     if (result != 0) {
-        LOG("Failed to get entrypoint delegate: 0x%08x", result);
+        LOG_ERROR("Failed to get entrypoint delegate: 0x%08x", result);
         return;
     }
 
+    clr_bootstrap.startup = startup;
+}
+
+static void clr_doorstop_init(void *arg) {
+    (void)arg;
+    clr_bootstrap.init_start = monotonic_time_us();
+    trace_event("clr_doorstop_init", 'B', clr_bootstrap.init_start);
+    // CoreCLR copies the properties, so they are freed once it is loaded
+    Arena arena = {0};
+    clr_doorstop_initialize(&arena);
+    arena_reset(&arena, TEXT("CoreCLR bootstrap"));
+    clr_bootstrap.init_end = monotonic_time_us();
+    trace_event("clr_doorstop_init", 'E', clr_bootstrap.init_end);
+}
+
+/**
+ * @brief Invoke the entrypoint resolved by clr_doorstop_init on the calling
+ * thread.
+ */
+static void clr_doorstop_start() {
+    if (!clr_bootstrap.startup)
+        return;
+
     LOG("Invoking Doorstop.Entrypoint.Start()");
-    startup();
+    trace_begin("Doorstop.Entrypoint.Start");
+    clr_bootstrap.startup();
+    trace_end("Doorstop.Entrypoint.Start");
 }
 
+#if VERBOSE
+static void log_clr_timing(unsigned long long il2cpp_start,
+                           unsigned long long il2cpp_end, bool_t concurrent) {
+    unsigned long long init_start = clr_bootstrap.init_start;
+    unsigned long long init_end = clr_bootstrap.init_end;
+    LOG("il2cpp_init took %lu ms",
+        (unsigned long)((il2cpp_end - il2cpp_start) / 1000));
+    if (!concurrent) {
+        LOG("CoreCLR initialization took %lu ms",
+            (unsigned long)((init_end - init_start) / 1000));
+        return;
+    }
+
+    unsigned long long overlap_end =
+        init_end < il2cpp_end ? init_end : il2cpp_end;
+    unsigned long long overlap =
+        overlap_end > init_start ? overlap_end - init_start : 0;
+    unsigned long long waited =
+        init_end > il2cpp_end ? init_end - il2cpp_end : 0;
+    LOG("CoreCLR initialization took %lu ms, %lu ms of it overlapped "
+        "il2cpp_init; waited %lu ms for it to finish",
+        (unsigned long)((init_end - init_start) / 1000),
+        (unsigned long)(overlap / 1000), (unsigned long)(waited / 1000));
+}
+#endif
+
+static void configure_il2cpp_gc() {
+    if (config.il2cpp_gc_mode && il2cpp.gc_set_mode) {
+        if (NAME_EQUAL(config.il2cpp_gc_mode, TEXT("enabled")))
+            il2cpp.gc_set_mode(IL2CPP_GC_MODE_ENABLED);
+        else if (NAME_EQUAL(config.il2cpp_gc_mode, TEXT("disabled")))
+            il2cpp.gc_set_mode(IL2CPP_GC_MODE_DISABLED);
+        else if (NAME_EQUAL(config.il2cpp_gc_mode, TEXT("manual")))
+            il2cpp.gc_set_mode(IL2CPP_GC_MODE_MANUAL);
+        else
+            LOG_WARN("Ignoring unknown il2cpp GC mode: %s",
+                     config.il2cpp_gc_mode);
+    }
+
+    bool_t incremental =
+        il2cpp.gc_is_incremental && il2cpp.gc_is_incremental();
+    if (config.il2cpp_gc_max_time_slice_ns && il2cpp.gc_set_max_time_slice_ns) {
+        if (incremental)
+            il2cpp.gc_set_max_time_slice_ns(
+                config.il2cpp_gc_max_time_slice_ns);
+        else
+            LOG_WARN("il2cpp GC is not incremental; ignoring the time slice");
+    }
+
+    LOG("il2cpp GC: %s, %s",
+        il2cpp.gc_is_disabled && il2cpp.gc_is_disabled() ? TEXT("disabled")
+                                                         : TEXT("enabled"),
+        incremental ? TEXT("incremental") : TEXT("not incremental"));
+    if (incremental && il2cpp.gc_get_max_time_slice_ns)
+        LOG("il2cpp GC max time slice: %lu ns",
+            (unsigned long)il2cpp.gc_get_max_time_slice_ns());
+    if (il2cpp.gc_get_heap_size && il2cpp.gc_get_used_size)
+        LOG("il2cpp GC heap: %lu KiB, %lu KiB used",
+            (unsigned long)(il2cpp.gc_get_heap_size() / 1024),
+            (unsigned long)(il2cpp.gc_get_used_size() / 1024));
+}
+
+static Il2CppMemoryCallbacks pool_callbacks = {
+    pool_malloc,  pool_aligned_malloc, pool_free,           pool_aligned_free,
+    pool_calloc,  pool_realloc,        pool_aligned_realloc,
+};
+
 int init_il2cpp(const char *domain_name) {
-    char_t *domain_name_w = widen(domain_name);
-    LOG("Starting IL2CPP domain \"%s\"", domain_name_w);
-    free(domain_name_w);
+    trace_begin("init_il2cpp");
+    LOG("Starting IL2CPP domain \"%s\"",
+        arena_widen(&boot_arena, domain_name));
+
+    // Memory callbacks must be set before il2cpp_init. Blocks allocated with
+    // the previous callbacks are passed to the system allocator when freed.
+    if (config.il2cpp_pool_allocator) {
+        if (!il2cpp.set_memory_callbacks) {
+            LOG_WARN("il2cpp_set_memory_callbacks not found; not using the "
+                     "pool allocator");
+        } else if (!pool_init()) {
+            LOG_ERROR("Failed to initialize the pool allocator");
+        } else {
+            LOG("Installing pool allocator as il2cpp memory callbacks");
+            il2cpp.set_memory_callbacks(&pool_callbacks);
+        }
+    }
+
+    // CoreCLR reads the setting from the environment when it is initialized,
+    // which may happen on another thread where setenv is not safe
+    ScopedEnv perf_map_env = {0};
+    if (config.perf_map) {
+        LOG("Enabling CoreCLR perf map");
+        scoped_env_set(&perf_map_env, TEXT("DOTNET_PerfMapEnabled"),
+                       TEXT("1"));
+    }
+
+    clr_doorstop_prepare();
+
+    thread_t clr_thread = NULL;
+    if (config.clr_concurrent_init) {
+        LOG("Initializing CoreCLR concurrently with il2cpp");
+        clr_thread = thread_start(clr_doorstop_init, NULL);
+    }
+
+    unsigned long long il2cpp_start = monotonic_time_us();
     const int orig_result = il2cpp.init(domain_name);
-    il2cpp_doorstop_bootstrap();
+    unsigned long long il2cpp_end = monotonic_time_us();
+    trace_event("il2cpp_init", 'B', il2cpp_start);
+    trace_event("il2cpp_init", 'E', il2cpp_end);
+    configure_il2cpp_gc();
+
+    if (clr_thread) {
+        thread_join(clr_thread);
+    } else {
+        // CoreCLR files were prefetched while il2cpp was initializing
+        warmup_wait();
+        clr_doorstop_init(NULL);
+    }
+    scoped_env_restore(&perf_map_env);
+#if VERBOSE
+    log_clr_timing(il2cpp_start, il2cpp_end, clr_thread != NULL);
+#endif
+
+    // Entrypoint is always invoked on the main thread, after il2cpp is
+    // initialized
+    clr_doorstop_start();
+
+    trace_end("init_il2cpp");
+    trace_write();
+    arena_reset(&boot_arena, TEXT("il2cpp bootstrap"));
     return orig_result;
 }
 
@@ -326,53 +741,51 @@ int init_il2cpp(const char *domain_name) {
 #define MONO_DEBUG_NO_SUSPEND_NET35 TEXT(",suspend=n,defer=y")
 
 void hook_mono_jit_parse_options(int argc, char **argv) {
-    char_t *debug_options = getenv(TEXT("DNSPY_UNITY_DBG2"));
-    if (debug_options) {
+    ArgList args;
+    args_init(&args, argc, argv);
+
+    if (config.mono_jit_options && strlen(config.mono_jit_options)) {
+        LOG("Configured JIT options: %s", config.mono_jit_options);
+        if (!args_add_list(&args, config.mono_jit_options))
+            LOG("All configured JIT options are already set");
+    }
+
+    char_t *env_debug_options = getenv(TEXT("DNSPY_UNITY_DBG2"));
+    if (env_debug_options) {
         config.mono_debug_enabled = TRUE;
     }
 
     if (config.mono_debug_enabled) {
         LOG("Configuring mono debug server");
 
-        int size = argc + 1;
-        char **new_argv = calloc(size, sizeof(char *));
-        memcpy(new_argv, argv, argc * sizeof(char *));
-
-        size_t debug_args_len =
-            STR_LEN(MONO_DEBUG_ARG_START) + strlen(config.mono_debug_address);
-        if (!config.mono_debug_suspend) {
-            if (mono_is_net35) {
-                debug_args_len += STR_LEN(MONO_DEBUG_NO_SUSPEND_NET35);
-            } else {
-                debug_args_len += STR_LEN(MONO_DEBUG_NO_SUSPEND);
-            }
-        }
-
+        char_t *debug_options = env_debug_options;
         if (!debug_options) {
-            debug_options = calloc(debug_args_len + 1, sizeof(char_t));
-            strcat(debug_options, MONO_DEBUG_ARG_START);
-            strcat(debug_options, config.mono_debug_address);
+            const char_t *suspend = TEXT("");
             if (!config.mono_debug_suspend) {
-                if (mono_is_net35) {
-                    strcat(debug_options, MONO_DEBUG_NO_SUSPEND_NET35);
-                } else {
-                    strcat(debug_options, MONO_DEBUG_NO_SUSPEND);
-                }
+                suspend = mono_is_net35 ? MONO_DEBUG_NO_SUSPEND_NET35
+                                        : MONO_DEBUG_NO_SUSPEND;
             }
+            debug_options =
+                arena_concat(&boot_arena, MONO_DEBUG_ARG_START,
+                             config.mono_debug_address, suspend, NULL);
         }
 
         LOG("Debug options: %s", debug_options);
+        args_add(&args, arena_narrow(&boot_arena, debug_options));
+    }
+    shutenv(env_debug_options);
 
-        char *debug_options_n = narrow(debug_options);
-        new_argv[argc] = debug_options_n;
-        mono.jit_parse_options(size, new_argv);
-
-        free(debug_options);
-        free(debug_options_n);
-        free(new_argv);
-    } else {
-        mono.jit_parse_options(argc, argv);
+#if VERBOSE
+    if (args.argc > argc) {
+        for (int i = 0; i < args.argc; i++) {
+            LOG_DEBUG("JIT argv[%d]: %s", i,
+                      arena_widen(&boot_arena, args.argv[i]));
+        }
     }
+#endif
+
+    mono.jit_parse_options(args.argc, args.argv);
+    args_free(&args);
 }
 
 void *hook_mono_image_open_from_data_with_name(void *data,
@@ -382,6 +795,8 @@ void *hook_mono_image_open_from_data_with_name(void *data,
                                                int refonly, const char *name) {
     void *result = NULL;
     if (config.mono_dll_search_path_override) {
+        // The preloader is started by the warm-up thread
+        warmup_wait();
         char_t *name_wide = widen(name);
         char_t *name_file = get_file_name(name_wide, TRUE);
         free(name_wide);
@@ -395,18 +810,24 @@ void *hook_mono_image_open_from_data_with_name(void *data,
         strcat(new_full_path, TEXT("/"));
         strcat(new_full_path, name_file);
 
-        if (file_exists(new_full_path)) {
-            void *file = fopen(new_full_path, "r");
-            size_t size = get_file_size(file);
-            void *buf = malloc(size);
-            fread(buf, 1, size, file);
-            fclose(file);
-            result = mono.image_open_from_data_with_name(buf, size, need_copy,
+        size_t size = 0;
+        void *buf = preload_get_by_name(name_file, &size);
+        if (buf) {
+            LOG_DEBUG("Using preloaded assembly for %s", name_file);
+            result = mono.image_open_from_data_with_name(buf, size, FALSE,
                                                          status, refonly, name);
-            if (need_copy)
-                free(buf);
+        } else if (warmup_has_override(name_file) &&
+                   file_exists(new_full_path)) {
+            buf = read_assembly_file(new_full_path, &size);
+            if (buf) {
+                result = mono.image_open_from_data_with_name(
+                    buf, size, need_copy, status, refonly, name);
+                if (need_copy)
+                    free(buf);
+            }
         }
         free(new_full_path);
+        free(name_file);
     }
 
     if (!result) {
@@ -419,4 +840,80 @@ void *hook_mono_image_open_from_data_with_name(void *data,
 void hook_mono_debug_init(MonoDebugFormat format) {
     mono_debug_init_called = TRUE;
     mono.debug_init(format);
-}
\ No newline at end of file
+}
+
+// Names are looked up only when the profile is written, since that may be
+// slow and the runtime must still be alive
+static size_t format_method_name(char *buffer, size_t size,
+                                 const char *namespace_name,
+                                 const char *class_name,
+                                 const char *method_name) {
+    if (!method_name)
+        return 0;
+
+    const char *parts[] = {namespace_name,
+                           namespace_name && *namespace_name ? "." : NULL,
+                           class_name,
+                           class_name ? "::" : NULL,
+                           method_name};
+    size_t len = 0;
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++) {
+        for (const char *c = parts[i]; c && *c && len + 1 < size; c++)
+            buffer[len++] = *c;
+    }
+    buffer[len] = '\0';
+    return len;
+}
+
+static size_t mono_method_full_name(void *method, char *buffer,
+                                    size_t size) {
+    if (!mono.method_get_name)
+        return 0;
+    void *klass = mono.method_get_class ? mono.method_get_class(method) : NULL;
+    return format_method_name(
+        buffer, size,
+        klass && mono.class_get_namespace ? mono.class_get_namespace(klass)
+                                          : NULL,
+        klass && mono.class_get_name ? mono.class_get_name(klass) : NULL,
+        mono.method_get_name(method));
+}
+
+static size_t il2cpp_method_full_name(void *method, char *buffer,
+                                      size_t size) {
+    if (!il2cpp.method_get_name)
+        return 0;
+    void *klass =
+        il2cpp.method_get_class ? il2cpp.method_get_class(method) : NULL;
+    return format_method_name(
+        buffer, size,
+        klass && il2cpp.class_get_namespace ? il2cpp.class_get_namespace(klass)
+                                            : NULL,
+        klass && il2cpp.class_get_name ? il2cpp.class_get_name(klass) : NULL,
+        il2cpp.method_get_name(method));
+}
+
+void *hook_mono_runtime_invoke(void *method, void *obj, void **params,
+                               void **exc) {
+    unsigned long long start = profiler_ticks();
+    void *result = mono.runtime_invoke(method, obj, params, exc);
+    profiler_record(method, profiler_ticks() - start);
+    return result;
+}
+
+void hook_mono_jit_cleanup(void *domain) {
+    profiler_dump(mono_method_full_name);
+    mono.jit_cleanup(domain);
+}
+
+void *hook_il2cpp_runtime_invoke(void *method, void *obj, void **params,
+                                 void **exc) {
+    unsigned long long start = profiler_ticks();
+    void *result = il2cpp.runtime_invoke(method, obj, params, exc);
+    profiler_record(method, profiler_ticks() - start);
+    return result;
+}
+
+void hook_il2cpp_shutdown() {
+    profiler_dump(il2cpp_method_full_name);
+    il2cpp.shutdown();
+}
@@ -14,5 +14,11 @@ void *hook_mono_image_open_from_data_with_name(void *data,
                                                int refonly, const char *name);
 void hook_mono_jit_parse_options(int argc, char **argv);
 void hook_mono_debug_init(MonoDebugFormat format);
+void *hook_mono_runtime_invoke(void *method, void *obj, void **params,
+                               void **exc);
+void hook_mono_jit_cleanup(void *domain);
+void *hook_il2cpp_runtime_invoke(void *method, void *obj, void **params,
+                                 void **exc);
+void hook_il2cpp_shutdown();
 
 #endif
\ No newline at end of file
@@ -1,8 +1,407 @@
+#define LOG_CATEGORY LOG_CAT_CONFIG
 #include "../crt.h"
+#include "../util/hash.h"
+#include "../util/logging.h"
 #include "config.h"
+#include "ini.h"
+
+#if _WIN32
+#define KEY_EQUAL(a, b) (lstrcmp(a, b) == 0)
+#else
+#define KEY_EQUAL(a, b) (strcmp(a, b) == 0)
+#endif
 
 Config config;
 
+// Properties computed by Doorstop when initializing CoreCLR
+static const char_t *reserved_properties[] = {
+    TEXT("APP_PATHS"),
+    TEXT("APP_CONTEXT_BASE_DIRECTORY"),
+    TEXT("NATIVE_DLL_SEARCH_DIRECTORIES"),
+    TEXT("TRUSTED_PLATFORM_ASSEMBLIES"),
+};
+
+static const char_t *bool_properties[] = {
+    TEXT("System.GC.Server"),
+    TEXT("System.GC.Concurrent"),
+    TEXT("System.GC.RetainVM"),
+    TEXT("System.GC.CpuGroup"),
+    TEXT("System.Runtime.TieredCompilation"),
+    TEXT("System.Runtime.TieredCompilation.QuickJit"),
+    TEXT("System.Runtime.TieredCompilation.QuickJitForLoops"),
+    TEXT("System.Runtime.TieredPGO"),
+};
+
+static const char_t *number_properties[] = {
+    TEXT("System.GC.HeapCount"),
+    TEXT("System.GC.HeapHardLimit"),
+    TEXT("System.GC.HeapHardLimitPercent"),
+    TEXT("System.GC.ConserveMemory"),
+};
+
+static bool_t is_in(const char_t *key, const char_t **list, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (KEY_EQUAL(key, list[i]))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static bool_t is_valid_key(const char_t *key) {
+    if (!*key)
+        return FALSE;
+    for (const char_t *c = key; *c; c++) {
+        if (!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+              (*c >= '0' && *c <= '9') || *c == '.' || *c == '_' ||
+              *c == '-'))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+static bool_t is_number(const char_t *value) {
+    // CoreCLR parses GC limits as decimal or 0x-prefixed hexadecimal
+    bool_t hex = value[0] == '0' && (value[1] == 'x' || value[1] == 'X');
+    if (hex)
+        value += 2;
+    if (!*value)
+        return FALSE;
+    for (const char_t *c = value; *c; c++) {
+        if (!((*c >= '0' && *c <= '9') ||
+              (hex && ((*c >= 'a' && *c <= 'f') || (*c >= 'A' && *c <= 'F')))))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+// Takes ownership of the key
+static bool_t add_property(char_t *key, const char_t *value) {
+    const char_t *error = NULL;
+    if (!is_valid_key(key))
+        error = TEXT("invalid key");
+    else if (is_in(key, reserved_properties, STR_LEN(reserved_properties)))
+        error = TEXT("key is set by Doorstop");
+    else if (is_in(key, bool_properties, STR_LEN(bool_properties)) &&
+             !KEY_EQUAL(value, TEXT("true")) &&
+             !KEY_EQUAL(value, TEXT("false")))
+        error = TEXT("value must be true or false");
+    else if (is_in(key, number_properties, STR_LEN(number_properties)) &&
+             !is_number(value))
+        error = TEXT("value must be a number");
+
+    if (error) {
+        LOG_WARN("Ignoring CoreCLR runtime property %s=%s (%s)", key, value,
+                 error);
+        free(key);
+        return FALSE;
+    }
+
+    for (size_t i = 0; i < config.clr_runtime_property_count; i++) {
+        RuntimeProperty *prop = &config.clr_runtime_properties[i];
+        if (KEY_EQUAL(prop->key, key)) {
+            free(key);
+            free(prop->value);
+            prop->value = strdup(value);
+            return TRUE;
+        }
+    }
+
+    config.clr_runtime_properties =
+        realloc(config.clr_runtime_properties,
+                (config.clr_runtime_property_count + 1) *
+                    sizeof(RuntimeProperty));
+    RuntimeProperty *prop =
+        &config.clr_runtime_properties[config.clr_runtime_property_count++];
+    prop->key = key;
+    prop->value = strdup(value);
+    return TRUE;
+}
+
+bool_t add_clr_runtime_property(const char_t *entry) {
+    size_t len = strlen(entry);
+    size_t key_len = 0;
+    while (key_len < len && entry[key_len] != '=')
+        key_len++;
+    if (key_len == len) {
+        LOG_WARN("Ignoring CoreCLR runtime property without a value: %s",
+                 entry);
+        return FALSE;
+    }
+
+    char_t *key = calloc(key_len + 1, sizeof(char_t));
+    strncpy(key, entry, key_len);
+    key[key_len] = 0;
+    return add_property(key, entry + key_len + 1);
+}
+
+void add_clr_runtime_properties(const char_t *list, char_t sep) {
+    char_t *entries = strdup(list);
+    size_t len = strlen(entries);
+    size_t start = 0;
+    for (size_t i = 0; i <= len; i++) {
+        if (entries[i] != sep && entries[i] != 0)
+            continue;
+        entries[i] = 0;
+        if (i > start)
+            add_clr_runtime_property(entries + start);
+        start = i + 1;
+    }
+    free(entries);
+}
+
+// Section suffix of the profile of the running executable, if any
+static const char_t *profile = NULL;
+
+#define PROFILE_SECTION_SIZE 128
+#define PROFILE_HEADER_SIZE 4096
+
+// Builds the name of the profile section overriding a section
+static bool_t profile_section(const char_t *section, char_t *name) {
+    if (!profile ||
+        strlen(section) + strlen(profile) + 2 > PROFILE_SECTION_SIZE)
+        return FALSE;
+    strcpy(name, section);
+    strcat(name, TEXT(":"));
+    strcat(name, profile);
+    return TRUE;
+}
+
+// Looks a key up in the profile section first, then in the section itself
+static const char_t *get_option(const IniFile *ini, const char_t *section,
+                                const char_t *key) {
+    char_t name[PROFILE_SECTION_SIZE];
+    const char_t *value = NULL;
+    if (profile_section(section, name))
+        value = ini_get(ini, name, key);
+    return value ? value : ini_get(ini, section, key);
+}
+
+// Formats the key of an executable header hash, e.g. `hash:0123abcd`
+static void format_header_key(unsigned int hash, char_t *key) {
+    static const char digits[] = "0123456789abcdef";
+    strcpy(key, TEXT("hash:"));
+    char_t *out = key + strlen(key);
+    for (int shift = 28; shift >= 0; shift -= 4)
+        *out++ = (char_t)digits[(hash >> shift) & 0xF];
+    *out = '\0';
+}
+
+static bool_t hash_header(char_t *program, unsigned int *hash) {
+    void *file = fopen(program, "rb");
+    // fopen returns INVALID_HANDLE_VALUE on failure on Windows
+    if (!file || file == (void *)-1)
+        return FALSE;
+    char header[PROFILE_HEADER_SIZE];
+    size_t read = fread(header, 1, sizeof(header), file);
+    fclose(file);
+    *hash = hash_fnv1a(header, read, FNV1A_OFFSET_BASIS);
+    return read > 0;
+}
+
+/*
+ * Finds the profile of the running executable in the [Profiles] section,
+ * by file name with and without extension, then by the hash of the first
+ * bytes of the file. The header is only read if no name matches.
+ */
+static const char_t *select_profile(const IniFile *ini) {
+    if (!ini_next(ini, TEXT("Profiles"), NULL))
+        return NULL;
+    char_t *program = program_path();
+    if (!program)
+        return NULL;
+
+    const char_t *result = NULL;
+    for (int with_ext = 1; !result && with_ext >= 0; with_ext--) {
+        char_t *name = get_file_name(program, with_ext);
+        result = ini_get(ini, TEXT("Profiles"), name);
+        free(name);
+    }
+
+    unsigned int hash;
+    if (!result && hash_header(program, &hash)) {
+        char_t key[16];
+        format_header_key(hash, key);
+        LOG("Executable header key: %s", key);
+        result = ini_get(ini, TEXT("Profiles"), key);
+    }
+    free(program);
+    return result && *result ? result : NULL;
+}
+
+static void load_bool_file(const IniFile *ini, const char_t *section,
+                           const char_t *key, bool_t def, bool_t *value) {
+    const char_t *text = get_option(ini, section, key);
+    LOG_DEBUG("CONFIG: %s.%s = %s", section, key,
+              text ? text : TEXT("(default)"));
+    if (!text)
+        *value = def;
+    else if (ini_equal(text, TEXT("true")))
+        *value = TRUE;
+    else if (ini_equal(text, TEXT("false")))
+        *value = FALSE;
+}
+
+static bool_t load_str_file(const IniFile *ini, const char_t *section,
+                            const char_t *key, const char_t *def,
+                            char_t **value) {
+    const char_t *text = get_option(ini, section, key);
+    if (!text)
+        text = def;
+    LOG_DEBUG("CONFIG: %s.%s = %s", section, key, text);
+    if (!text || !*text)
+        return FALSE;
+    if (*value)
+        free(*value);
+    *value = strdup(text);
+    return TRUE;
+}
+
+static void load_path_file(const IniFile *ini, const char_t *section,
+                           const char_t *key, const char_t *def,
+                           char_t **value) {
+    if (!load_str_file(ini, section, key, def, value))
+        return;
+    char_t *tmp = *value;
+    *value = get_full_path(tmp);
+    LOG_DEBUG("(%s.%s) %s => %s", section, key, tmp, *value);
+    free(tmp);
+}
+
+static void load_uint_file(const IniFile *ini, const char_t *section,
+                           const char_t *key, unsigned int def,
+                           unsigned int *value) {
+    const char_t *text = get_option(ini, section, key);
+    char_t *end = NULL;
+    unsigned long parsed = text ? strtoul(text, &end, 10) : 0;
+    *value = text && end != text && *end == 0 ? (unsigned int)parsed : def;
+    LOG_DEBUG("CONFIG: %s.%s = %u", section, key, *value);
+}
+
+static void load_section_properties(const IniFile *ini,
+                                    const char_t *section) {
+    for (const IniEntry *entry = ini_next(ini, section, NULL); entry;
+         entry = ini_next(ini, section, entry)) {
+        LOG_DEBUG("CONFIG: %s: %s=%s", section, entry->key, entry->value);
+        add_property(strdup(entry->key), entry->value);
+    }
+}
+
+// Properties of the profile are added last, so that they take precedence
+static void load_properties_file(const IniFile *ini, const char_t *section) {
+    load_section_properties(ini, section);
+    char_t name[PROFILE_SECTION_SIZE];
+    if (profile_section(section, name))
+        load_section_properties(ini, name);
+}
+
+bool_t load_config_file(const char_t *path) {
+    IniFile ini;
+    if (!ini_load(&ini, path))
+        return FALSE;
+
+    profile = select_profile(&ini);
+
+    // Read first, so that the levels apply to the rest of the file
+    load_str_file(&ini, TEXT("General"), TEXT("log_level"), NULL,
+                  &config.log_level);
+    log_configure(config.log_level);
+    if (profile)
+        LOG("Using config profile %s", profile);
+
+    load_bool_file(&ini, TEXT("General"), TEXT("enabled"), TRUE,
+                   &config.enabled);
+    load_bool_file(&ini, TEXT("General"), TEXT("ignore_disable_switch"), FALSE,
+                   &config.ignore_disabled_env);
+    load_bool_file(&ini, TEXT("General"), TEXT("redirect_output_log"), FALSE,
+                   &config.redirect_output_log);
+    load_path_file(&ini, TEXT("General"), TEXT("target_assembly"),
+                   DEFAULT_TARGET_ASSEMBLY, &config.target_assembly);
+    load_path_file(&ini, TEXT("General"), TEXT("boot_config_override"), NULL,
+                   &config.boot_config_override);
+    load_path_file(&ini, TEXT("General"), TEXT("runtime_invoke_profile"),
+                   NULL, &config.runtime_invoke_profile);
+    load_path_file(&ini, TEXT("General"), TEXT("boot_trace"), NULL,
+                   &config.boot_trace);
+    load_path_file(&ini, TEXT("General"), TEXT("boot_readahead_list"), NULL,
+                   &config.boot_readahead_list);
+    load_uint_file(&ini, TEXT("General"), TEXT("boot_readahead_seconds"), 30,
+                   &config.boot_readahead_seconds);
+    load_bool_file(&ini, TEXT("General"), TEXT("perf_map"), FALSE,
+                   &config.perf_map);
+
+    load_str_file(&ini, TEXT("UnityMono"), TEXT("dll_search_path_override"),
+                  NULL, &config.mono_dll_search_path_override);
+    load_bool_file(&ini, TEXT("UnityMono"), TEXT("debug_enabled"), FALSE,
+                   &config.mono_debug_enabled);
+    load_bool_file(&ini, TEXT("UnityMono"), TEXT("debug_suspend"), FALSE,
+                   &config.mono_debug_suspend);
+    load_str_file(&ini, TEXT("UnityMono"), TEXT("debug_address"),
+                  TEXT("127.0.0.1:10000"), &config.mono_debug_address);
+    load_str_file(&ini, TEXT("UnityMono"), TEXT("jit_options"), NULL,
+                  &config.mono_jit_options);
+    load_str_file(&ini, TEXT("UnityMono"), TEXT("gc_nursery_size"), NULL,
+                  &config.mono_gc_nursery_size);
+    load_str_file(&ini, TEXT("UnityMono"), TEXT("gc_major"), NULL,
+                  &config.mono_gc_major);
+    load_str_file(&ini, TEXT("UnityMono"), TEXT("gc_soft_heap_limit"), NULL,
+                  &config.mono_gc_soft_heap_limit);
+    load_str_file(&ini, TEXT("UnityMono"), TEXT("gc_params"), NULL,
+                  &config.mono_gc_params);
+    load_str_file(&ini, TEXT("UnityMono"), TEXT("gc_debug"), NULL,
+                  &config.mono_gc_debug);
+    load_bool_file(&ini, TEXT("UnityMono"), TEXT("shared_cache"), FALSE,
+                   &config.mono_shared_cache);
+
+    load_path_file(&ini, TEXT("Il2Cpp"), TEXT("coreclr_path"), NULL,
+                   &config.clr_runtime_coreclr_path);
+    load_path_file(&ini, TEXT("Il2Cpp"), TEXT("corlib_dir"), NULL,
+                   &config.clr_corlib_dir);
+    load_bool_file(&ini, TEXT("Il2Cpp"), TEXT("concurrent_init"), FALSE,
+                   &config.clr_concurrent_init);
+    load_bool_file(&ini, TEXT("Il2Cpp"), TEXT("pool_allocator"), FALSE,
+                   &config.il2cpp_pool_allocator);
+    load_str_file(&ini, TEXT("Il2Cpp"), TEXT("gc_mode"), NULL,
+                  &config.il2cpp_gc_mode);
+    load_uint_file(&ini, TEXT("Il2Cpp"), TEXT("gc_max_time_slice_ns"), 0,
+                   &config.il2cpp_gc_max_time_slice_ns);
+    load_properties_file(&ini, TEXT("Il2CppRuntimeProperties"));
+
+    // The profile name points into the text of the file
+    profile = NULL;
+    ini_free(&ini);
+    return TRUE;
+}
+
+#define BOOT_CONFIG_SUFFIX TEXT("_Data") DIR_SEP TEXT("boot.config")
+
+void resolve_config() {
+    if (config.default_boot_config_path) {
+        free(config.default_boot_config_path);
+        config.default_boot_config_path = NULL;
+    }
+    if (!config.boot_config_override)
+        return;
+
+    char_t *working_dir = get_working_dir();
+    char_t *program = program_path();
+    char_t *name = program ? get_file_name(program, FALSE) : NULL;
+    if (working_dir && name) {
+        size_t len = strlen(working_dir) + STR_LEN(DIR_SEP) + strlen(name) +
+                     STR_LEN(BOOT_CONFIG_SUFFIX);
+        config.default_boot_config_path = calloc(len, sizeof(char_t));
+        strcpy(config.default_boot_config_path, working_dir);
+        strcat(config.default_boot_config_path, DIR_SEP);
+        strcat(config.default_boot_config_path, name);
+        strcat(config.default_boot_config_path, BOOT_CONFIG_SUFFIX);
+    }
+    if (working_dir)
+        free(working_dir);
+    if (program)
+        free(program);
+    if (name)
+        free(name);
+}
+
 void cleanup_config() {
 #define FREE_NON_NULL(val)                                                     \
     if (val != NULL) {                                                         \
@@ -16,6 +415,24 @@ void cleanup_config() {
     FREE_NON_NULL(config.clr_corlib_dir);
     FREE_NON_NULL(config.clr_runtime_coreclr_path);
     FREE_NON_NULL(config.mono_debug_address);
+    FREE_NON_NULL(config.mono_jit_options);
+    FREE_NON_NULL(config.mono_gc_nursery_size);
+    FREE_NON_NULL(config.mono_gc_major);
+    FREE_NON_NULL(config.mono_gc_soft_heap_limit);
+    FREE_NON_NULL(config.mono_gc_params);
+    FREE_NON_NULL(config.mono_gc_debug);
+    for (size_t i = 0; i < config.clr_runtime_property_count; i++) {
+        FREE_NON_NULL(config.clr_runtime_properties[i].key);
+        FREE_NON_NULL(config.clr_runtime_properties[i].value);
+    }
+    FREE_NON_NULL(config.clr_runtime_properties);
+    config.clr_runtime_property_count = 0;
+    FREE_NON_NULL(config.il2cpp_gc_mode);
+    FREE_NON_NULL(config.runtime_invoke_profile);
+    FREE_NON_NULL(config.boot_trace);
+    FREE_NON_NULL(config.boot_readahead_list);
+    FREE_NON_NULL(config.log_level);
+    FREE_NON_NULL(config.default_boot_config_path);
 
 #undef FREE_NON_NULL
 }
@@ -27,9 +444,29 @@ void init_config_defaults() {
     config.mono_debug_enabled = FALSE;
     config.mono_debug_suspend = FALSE;
     config.mono_debug_address = NULL;
+    config.mono_jit_options = NULL;
+    config.mono_gc_nursery_size = NULL;
+    config.mono_gc_major = NULL;
+    config.mono_gc_soft_heap_limit = NULL;
+    config.mono_gc_params = NULL;
+    config.mono_gc_debug = NULL;
+    config.mono_shared_cache = FALSE;
     config.target_assembly = NULL;
     config.boot_config_override = NULL;
     config.mono_dll_search_path_override = NULL;
     config.clr_corlib_dir = NULL;
     config.clr_runtime_coreclr_path = NULL;
+    config.clr_runtime_properties = NULL;
+    config.clr_runtime_property_count = 0;
+    config.clr_concurrent_init = FALSE;
+    config.il2cpp_pool_allocator = FALSE;
+    config.il2cpp_gc_mode = NULL;
+    config.il2cpp_gc_max_time_slice_ns = 0;
+    config.perf_map = FALSE;
+    config.runtime_invoke_profile = NULL;
+    config.boot_trace = NULL;
+    config.boot_readahead_list = NULL;
+    config.boot_readahead_seconds = 30;
+    config.log_level = NULL;
+    config.default_boot_config_path = NULL;
 }
\ No newline at end of file
@@ -3,6 +3,24 @@
 
 #include "../util/util.h"
 
+/**
+ * @brief Name of the config file, looked up in the working directory.
+ */
+#define CONFIG_NAME TEXT("doorstop_config.ini")
+
+/**
+ * @brief Target assembly used when a config file doesn't set one.
+ */
+#define DEFAULT_TARGET_ASSEMBLY TEXT("Doorstop.dll")
+
+/**
+ * @brief Property passed to the CoreCLR runtime on initialization.
+ */
+typedef struct {
+    char_t *key;
+    char_t *value;
+} RuntimeProperty;
+
 /**
  * @brief Doorstop configuration
  */
@@ -65,6 +83,54 @@ typedef struct {
      */
     char_t *mono_debug_address;
 
+    /**
+     * @brief Extra options to pass to the mono JIT, separated by whitespace
+     * (e.g. `--optimize=inline,simd --llvm`).
+     *
+     * The options are appended to the ones Unity passes to
+     * mono_jit_parse_options. Options Unity already passes are not repeated.
+     */
+    char_t *mono_jit_options;
+
+    /**
+     * @brief SGen nursery size (e.g. `64m`).
+     */
+    char_t *mono_gc_nursery_size;
+
+    /**
+     * @brief SGen major collector (`marksweep`, `marksweep-conc` or
+     * `marksweep-conc-par`).
+     */
+    char_t *mono_gc_major;
+
+    /**
+     * @brief SGen soft heap limit (e.g. `1g`).
+     */
+    char_t *mono_gc_soft_heap_limit;
+
+    /**
+     * @brief Extra comma separated options to add to MONO_GC_PARAMS.
+     */
+    char_t *mono_gc_params;
+
+    /**
+     * @brief Value of MONO_GC_DEBUG.
+     *
+     * The GC settings are only set in the environment while mono is
+     * initialized, so they don't leak into child processes.
+     */
+    char_t *mono_gc_debug;
+
+    /**
+     * @brief Whether to share preloaded assemblies with other instances.
+     *
+     * If enabled, assemblies read from the DLL search path are published to a
+     * shared memory segment that other Doorstop instances on the same machine
+     * map instead of reading the files again. Only supported on Linux and
+     * macOS.
+     */
+    bool_t mono_shared_cache;
+
     /**
      * @brief Path to the CoreCLR runtime library.
      */
@@ -74,6 +140,111 @@ typedef struct {
      * @brief Path to the CoreCLR core libraries folder.
      */
     char_t *clr_corlib_dir;
+
+    /**
+     * @brief Additional properties to initialize CoreCLR with (e.g.
+     * `System.GC.Server=true`).
+     *
+     * Properties set by Doorstop itself (APP_PATHS,
+     * TRUSTED_PLATFORM_ASSEMBLIES, etc.) can't be overridden.
+     */
+    RuntimeProperty *clr_runtime_properties;
+    size_t clr_runtime_property_count;
+
+    /**
+     * @brief Whether to initialize CoreCLR on a background thread while
+     * il2cpp initializes.
+     *
+     * The entrypoint is still invoked on the main thread once il2cpp_init
+     * returns.
+     */
+    bool_t clr_concurrent_init;
+
+    /**
+     * @brief Whether to serve il2cpp's native allocations from Doorstop's
+     * pool allocator.
+     *
+     * If enabled, Doorstop installs its own il2cpp memory callbacks before
+     * il2cpp_init. Small allocations come from per-thread caches of fixed
+     * size classes and allocation counters are logged on shutdown.
+     */
+    bool_t il2cpp_pool_allocator;
+
+    /**
+     * @brief il2cpp GC mode (`enabled`, `disabled` or `manual`).
+     *
+     * If not set, the mode chosen by the game is kept.
+     */
+    char_t *il2cpp_gc_mode;
+
+    /**
+     * @brief Maximum time the incremental GC may spend per slice, in
+     * nanoseconds.
+     *
+     * Only has an effect if the game uses the incremental GC. If 0, the
+     * game's setting is kept.
+     */
+    unsigned int il2cpp_gc_max_time_slice_ns;
+
+    /**
+     * @brief Whether to write a perf map of JIT-compiled managed code.
+     *
+     * If enabled, mono and CoreCLR write `/tmp/perf-<pid>.map` so that
+     * profilers like perf can symbolize managed frames. Only supported on
+     * Linux.
+     */
+    bool_t perf_map;
+
+    /**
+     * @brief Path of the runtime_invoke profile.
+     *
+     * If set, calls from native code into managed code through mono or
+     * il2cpp runtime_invoke are counted and timed per method, and a report
+     * sorted by total time is written to this path when the runtime shuts
+     * down or the process exits.
+     */
+    char_t *runtime_invoke_profile;
+
+    /**
+     * @brief Path of the startup trace.
+     *
+     * If set, the time spent in each startup phase is recorded and written
+     * to this path as Chrome trace-event JSON once the runtime is
+     * bootstrapped.
+     */
+    char_t *boot_trace;
+
+    /**
+     * @brief Path to the boot readahead list.
+     *
+     * If the file exists, the files listed in it are prefetched into the page
+     * cache in the background as soon as Doorstop is loaded. Otherwise,
+     * Doorstop records the files opened by the game during the first
+     * boot_readahead_seconds seconds into it. Only supported on Linux and
+     * macOS.
+     */
+    char_t *boot_readahead_list;
+
+    /**
+     * @brief How long to record opened files for, in seconds.
+     */
+    unsigned int boot_readahead_seconds;
+
+    /**
+     * @brief Log levels per category, e.g. `debug` or `off,mapper=trace`.
+     *
+     * Only used by builds with logging. See log_configure for the syntax.
+     */
+    char_t *log_level;
+
+    /**
+     * @brief Path of the game's own boot.config, which boot_config_override
+     * replaces.
+     *
+     * Derived from the working directory and the executable name by
+     * resolve_config if boot_config_override is set.
+     */
+    char_t *default_boot_config_path;
 } Config;
 
 extern Config config;
@@ -83,6 +254,23 @@ extern Config config;
  */
 extern void load_config();
 
+/**
+ * @brief Load the options set in a config file.
+ *
+ * Options missing from the file are set to their default value. If the
+ * [Profiles] section maps the running executable to a profile, the options
+ * of the `[<section>:<profile>]` sections override the ones of `[<section>]`.
+ *
+ * @param path Path to the config file.
+ * @return bool_t TRUE if the file was read.
+ */
+extern bool_t load_config_file(const char_t *path);
+
+/**
+ * @brief Compute the values derived from the loaded options.
+ */
+extern void resolve_config();
+
 /**
  * @brief Initialize default values for configuration.
  */
@@ -92,4 +280,24 @@ extern void init_config_defaults();
  * @brief Clean up configuration.
  */
 extern void cleanup_config();
+
+/**
+ * @brief Add a CoreCLR runtime property to the configuration.
+ *
+ * The key must be a valid runtime property name that is not set by Doorstop
+ * itself. Values of well-known GC and JIT knobs are checked as well. A
+ * property that is added twice keeps the last value.
+ *
+ * @param entry Property in `key=value` format.
+ * @return bool_t TRUE if the property was valid and added.
+ */
+extern bool_t add_clr_runtime_property(const char_t *entry);
+
+/**
+ * @brief Add a list of CoreCLR runtime properties to the configuration.
+ *
+ * @param list Properties in `key=value` format separated by `sep`.
+ * @param sep Character separating the properties.
+ */
+extern void add_clr_runtime_properties(const char_t *list, char_t sep);
 #endif
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "ini.h"
+#include "../crt.h"
+#include "../util/hash.h"
+
+static char_t fold(char_t c) {
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+bool_t ini_equal(const char_t *a, const char_t *b) {
+    while (*a && fold(*a) == fold(*b)) {
+        a++;
+        b++;
+    }
+    return fold(*a) == fold(*b);
+}
+
+static unsigned int hash_name(const char_t *name, unsigned int hash) {
+    for (; *name; name++) {
+        hash ^= (unsigned int)fold(*name);
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+static unsigned int hash_key(const char_t *section, const char_t *key) {
+    // Hash the terminator of the section too, so that "ab" "c" and "a" "bc"
+    // differ
+    unsigned int hash = hash_name(section, FNV1A_OFFSET_BASIS) * FNV1A_PRIME;
+    return hash_name(key, hash);
+}
+
+static bool_t is_space(char_t c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Removes the whitespace around [start, *end) and terminates it
+static char_t *trim(char_t *start, char_t **end) {
+    while (start < *end && is_space(*start))
+        start++;
+    while (*end > start && is_space((*end)[-1]))
+        (*end)--;
+    **end = '\0';
+    return start;
+}
+
+static const IniEntry *find(const IniFile *ini, unsigned int hash,
+                            const char_t *section, const char_t *key,
+                            size_t *slot) {
+    for (size_t i = hash & ini->slot_mask;; i = (i + 1) & ini->slot_mask) {
+        unsigned int index = ini->slots[i];
+        *slot = i;
+        if (!index)
+            return NULL;
+        const IniEntry *entry = &ini->entries[index - 1];
+        if (entry->hash == hash && ini_equal(entry->section, section) &&
+            ini_equal(entry->key, key))
+            return entry;
+    }
+}
+
+static void add_entry(IniFile *ini, const char_t *section, char_t *key,
+                      char_t *value) {
+    IniEntry *entry = &ini->entries[ini->count];
+    entry->section = section;
+    entry->key = key;
+    entry->value = value;
+    entry->hash = hash_key(section, key);
+    ini->count++;
+
+    // Lookups return the first value, like GetPrivateProfileString
+    size_t slot;
+    if (!find(ini, entry->hash, section, key, &slot))
+        ini->slots[slot] = (unsigned int)ini->count;
+}
+
+bool_t ini_parse(IniFile *ini, char_t *text, size_t length) {
+    memset(ini, 0, sizeof(*ini));
+    ini->text = text;
+
+    // Every line holds at most one key, so counting them bounds the entries
+    size_t lines = 1;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == '\n')
+            lines++;
+    }
+    size_t slot_count = 16;
+    while (slot_count < lines * 2)
+        slot_count *= 2;
+    ini->entries = malloc(lines * sizeof(IniEntry));
+    ini->slots = calloc(slot_count, sizeof(unsigned int));
+    if (!ini->entries || !ini->slots) {
+        ini_free(ini);
+        return FALSE;
+    }
+    ini->slot_mask = slot_count - 1;
+
+    // Keys before the first section belong to the section with an empty name
+    const char_t *section = TEXT("");
+    char_t *text_end = text + length;
+    char_t *line = text;
+    while (line < text_end) {
+        char_t *end = line;
+        while (end < text_end && *end != '\n')
+            end++;
+        char_t *next = end + 1;
+        char_t *start = trim(line, &end);
+        line = next;
+
+        if (*start == '[') {
+            char_t *close = start + 1;
+            while (close < end && *close != ']')
+                close++;
+            if (close < end)
+                section = trim(start + 1, &close);
+            continue;
+        }
+        if (*start == '\0' || *start == ';' || *start == '#')
+            continue;
+
+        char_t *equals = start;
+        while (equals < end && *equals != '=')
+            equals++;
+        if (equals == end)
+            continue;
+
+        char_t *value = trim(equals + 1, &end);
+        char_t *key = trim(start, &equals);
+        if (end - value >= 2 && (*value == '"' || *value == '\'') &&
+            end[-1] == *value) {
+            end[-1] = '\0';
+            value++;
+        }
+        add_entry(ini, section, key, value);
+    }
+    return TRUE;
+}
+
+bool_t ini_load(IniFile *ini, const char_t *path) {
+    memset(ini, 0, sizeof(*ini));
+    void *file = fopen((char_t *)path, "rb");
+    // fopen returns INVALID_HANDLE_VALUE on failure on Windows
+    if (!file || file == (void *)-1)
+        return FALSE;
+
+    size_t size = get_file_size(file);
+    // Room for a terminator, in UTF-16 too
+    char *data = malloc(size + 2);
+    size_t read = data ? fread(data, 1, size, file) : 0;
+    fclose(file);
+    if (!data)
+        return FALSE;
+    if (read != size) {
+        free(data);
+        return FALSE;
+    }
+    data[size] = '\0';
+    data[size + 1] = '\0';
+
+    const unsigned char *bytes = (const unsigned char *)data;
+    size_t bom = 0;
+    if (size >= 3 && bytes[0] == 0xEF && bytes[1] == 0xBB && bytes[2] == 0xBF)
+        bom = 3;
+#ifdef UNICODE
+    char_t *text;
+    if (size >= 2 && bytes[0] == 0xFF && bytes[1] == 0xFE) {
+        size_t length = size / sizeof(char_t) - 1;
+        text = malloc((length + 1) * sizeof(char_t));
+        if (text) {
+            memcpy(text, data + 2, length * sizeof(char_t));
+            text[length] = '\0';
+        }
+    } else {
+        text = widen(data + bom);
+    }
+    free(data);
+    if (!text)
+        return FALSE;
+    return ini_parse(ini, text, strlen(text));
+#else
+    if (bom)
+        memmove(data, data + bom, size - bom + 1);
+    return ini_parse(ini, data, size - bom);
+#endif
+}
+
+const char_t *ini_get(const IniFile *ini, const char_t *section,
+                      const char_t *key) {
+    if (!ini->slots)
+        return NULL;
+    size_t slot;
+    const IniEntry *entry =
+        find(ini, hash_key(section, key), section, key, &slot);
+    return entry ? entry->value : NULL;
+}
+
+const IniEntry *ini_next(const IniFile *ini, const char_t *section,
+                         const IniEntry *previous) {
+    const IniEntry *entry = previous ? previous + 1 : ini->entries;
+    for (; entry && entry < ini->entries + ini->count; entry++) {
+        if (ini_equal(entry->section, section))
+            return entry;
+    }
+    return NULL;
+}
+
+void ini_free(IniFile *ini) {
+    if (ini->text)
+        free(ini->text);
+    if (ini->entries)
+        free(ini->entries);
+    if (ini->slots)
+        free(ini->slots);
+    memset(ini, 0, sizeof(*ini));
+}
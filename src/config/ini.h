@@ -0,0 +1,89 @@
+#ifndef INI_H
+#define INI_H
+
+#include "../util/util.h"
+
+/**
+ * @brief Key of an INI file. All strings point into the text of the file.
+ */
+typedef struct {
+    const char_t *section;
+    const char_t *key;
+    const char_t *value;
+    unsigned int hash;
+} IniEntry;
+
+/**
+ * @brief INI file parsed in a single pass.
+ *
+ * Sections and keys are matched ignoring ASCII case, like
+ * GetPrivateProfileString does. The text, the entries and the hash table are
+ * the only allocations, whatever the number of keys.
+ */
+typedef struct {
+    char_t *text;
+    IniEntry *entries;
+    size_t count;
+    // Index + 1 of the entry of each slot, or 0 if the slot is free
+    unsigned int *slots;
+    size_t slot_mask;
+} IniFile;
+
+/**
+ * @brief Read and parse an INI file.
+ *
+ * Lines are `[section]`, `key=value`, or comments starting with `;` or `#`.
+ * Whitespace around keys and values and quotes around values are removed. If
+ * a key is set twice in a section, the first value is kept.
+ *
+ * @param ini Receives the parsed file. Free with ini_free.
+ * @param path Path to the file, read as UTF-8 or UTF-16 with a BOM on
+ *             Windows.
+ * @return bool_t TRUE if the file was read.
+ */
+bool_t ini_load(IniFile *ini, const char_t *path);
+
+/**
+ * @brief Parse INI text in place.
+ *
+ * @param ini Receives the parsed text. Free with ini_free.
+ * @param text Text to parse, followed by a terminator. It is modified and
+ *             must be allocated with malloc; ini_free frees it.
+ * @param length Length of the text in characters, without the terminator.
+ * @return bool_t TRUE if the entries could be allocated.
+ */
+bool_t ini_parse(IniFile *ini, char_t *text, size_t length);
+
+/**
+ * @brief Find the value of a key.
+ *
+ * @param ini Parsed file.
+ * @param section Section of the key.
+ * @param key Name of the key.
+ * @return const char_t* Value of the key, or NULL if it isn't set.
+ */
+const char_t *ini_get(const IniFile *ini, const char_t *section,
+                      const char_t *key);
+
+/**
+ * @brief Iterate the keys of a section in the order of the file.
+ *
+ * @param ini Parsed file.
+ * @param section Section to iterate.
+ * @param previous Entry returned by the previous call, or NULL to start.
+ * @return const IniEntry* Next entry, or NULL after the last one.
+ */
+const IniEntry *ini_next(const IniFile *ini, const char_t *section,
+                         const IniEntry *previous);
+
+/**
+ * @brief Compare two names ignoring ASCII case.
+ */
+bool_t ini_equal(const char_t *a, const char_t *b);
+
+/**
+ * @brief Free a parsed file.
+ */
+void ini_free(IniFile *ini);
+
+#endif
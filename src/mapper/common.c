@@ -1,3 +1,4 @@
+#define LOG_CATEGORY LOG_CAT_MAPPER
 #include "../crt.h"
 #include "../util/logging.h"
 #include "mapper.h"
@@ -20,8 +21,82 @@ void cleanup_mapper() {
     }
     if (mapper) {
         FREE_NON_NULL(mapper);
-        LOG("Global mappings successfully freed and reset.");
+        LOG_DEBUG("Global mappings successfully freed and reset.");
     }
 
 #undef FREE_NON_NULL
-}
\ No newline at end of file
+}
+
+// Symbol names are ASCII; lstrcmpiA isn't available on every platform
+static int compare_names(const char *a, const char *b) {
+    for (;; a++, b++) {
+        char ca = *a >= 'A' && *a <= 'Z' ? *a - 'A' + 'a' : *a;
+        char cb = *b >= 'A' && *b <= 'Z' ? *b - 'A' + 'a' : *b;
+        if (ca != cb || !ca)
+            return (unsigned char)ca - (unsigned char)cb;
+    }
+}
+
+void mapper_index(Mapper *mapper) {
+    if (!mapper || mapper->count < 2)
+        return;
+
+    // Bottom-up merge sort, which is stable and needs no qsort
+    size_t count = mapper->count;
+    MapperEntry *from = mapper->entries;
+    MapperEntry *to = malloc(count * sizeof(MapperEntry));
+    if (!to) {
+        LOG_ERROR("Failed to allocate memory to sort the mapper");
+        return;
+    }
+    MapperEntry *buffer = to;
+
+    for (size_t width = 1; width < count; width *= 2) {
+        for (size_t start = 0; start < count; start += 2 * width) {
+            size_t mid = start + width < count ? start + width : count;
+            size_t end = start + 2 * width < count ? start + 2 * width : count;
+            size_t i = start, j = mid, k = start;
+            while (i < mid && j < end) {
+                if (compare_names((const char *)from[j].original_name,
+                                  (const char *)from[i].original_name) < 0)
+                    to[k++] = from[j++];
+                else
+                    to[k++] = from[i++];
+            }
+            while (i < mid)
+                to[k++] = from[i++];
+            while (j < end)
+                to[k++] = from[j++];
+        }
+        MapperEntry *swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != mapper->entries)
+        memcpy(mapper->entries, from, count * sizeof(MapperEntry));
+    free(buffer);
+}
+
+const char *mapper_find(const Mapper *mapper, const char *name) {
+    if (!mapper || !mapper->entries)
+        return NULL;
+
+    // Find the first entry that isn't less than the name
+    size_t low = 0;
+    size_t high = mapper->count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (compare_names((const char *)mapper->entries[mid].original_name,
+                          name) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if (low < mapper->count &&
+        compare_names((const char *)mapper->entries[low].original_name,
+                      name) == 0)
+        return (const char *)mapper->entries[low].mapped_name;
+    return NULL;
+}
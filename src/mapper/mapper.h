@@ -39,6 +39,25 @@ extern void load_mapper(void);
  */
 extern void cleanup_mapper(void);
 
+/**
+ * @brief Sorts the entries by original name so that they can be looked up
+ * with mapper_find. Entries with the same name keep their order.
+ *
+ * @param mapper Mapper whose entries to sort.
+ */
+extern void mapper_index(Mapper *mapper);
+
+/**
+ * @brief Finds the mapped name of a symbol with a binary search. The mapper
+ * must have been sorted with mapper_index.
+ *
+ * @param mapper Mapper to search.
+ * @param name The original function name to search for, ignoring case.
+ * @return The mapped name of the first entry with that name, or NULL if
+ * there is none.
+ */
+extern const char *mapper_find(const Mapper *mapper, const char *name);
+
 /**
  * @brief Looks up the mapped symbol string (e.g., "_RQluJpGVqK") given the
  * original function name (e.g., "il2cpp_init").
@@ -1,12 +1,16 @@
+#define LOG_CATEGORY LOG_CAT_CONFIG
 #include "../config/config.h"
 #include "../util/logging.h"
 #include "../crt.h"
 
+// Variables that aren't set or are empty keep the value of the config file,
+// if any
+
 void get_env_bool(const char_t *name, bool_t *target) {
     char_t *value = getenv(name);
     if (value != NULL && strcmp(value, "1") == 0) {
         *target = TRUE;
-    } else if (value == NULL || strcmp(value, "0") == 0) {
+    } else if (value != NULL && strcmp(value, "0") == 0) {
         *target = FALSE;
     }
 }
@@ -14,22 +18,38 @@ void get_env_bool(const char_t *name, bool_t *target) {
 void try_get_env(const char_t *name, char_t *def, char_t **target) {
     char_t *value = getenv(name);
     if (value != NULL && strlen(value) > 0) {
+        if (*target)
+            free(*target);
         *target = strdup(value);
-    } else {
-        *target = def;
+    } else if (*target == NULL && def != NULL) {
+        *target = strdup(def);
     }
 }
 
 void get_env_path(const char_t *name, char_t **target) {
     char_t *value = getenv(name);
     if (value != NULL && strlen(value) > 0) {
+        if (*target)
+            free(*target);
         *target = get_full_path(value);
-    } else {
-        *target = NULL;
     }
 }
 
-void load_config() {
+void get_env_uint(const char_t *name, unsigned int *target) {
+    char_t *value = getenv(name);
+    char_t *end = NULL;
+    if (value != NULL && strlen(value) > 0) {
+        unsigned long parsed = strtoul(value, &end, 10);
+        if (*end == 0)
+            *target = (unsigned int)parsed;
+    }
+}
+
+static void load_env() {
+    // Read first, so that the levels apply to the rest of the config
+    try_get_env("DOORSTOP_LOG_LEVEL", NULL, &config.log_level);
+    log_configure(config.log_level);
+
     get_env_bool("DOORSTOP_ENABLED", &config.enabled);
     get_env_bool("DOORSTOP_REDIRECT_OUTPUT_LOG", &config.redirect_output_log);
     get_env_bool("DOORSTOP_IGNORE_DISABLED_ENV", &config.ignore_disabled_env);
@@ -37,6 +57,15 @@ void load_config() {
     get_env_bool("DOORSTOP_MONO_DEBUG_SUSPEND", &config.mono_debug_suspend);
     try_get_env("DOORSTOP_MONO_DEBUG_ADDRESS", TEXT("127.0.0.1:10000"),
                 &config.mono_debug_address);
+    try_get_env("DOORSTOP_MONO_JIT_OPTIONS", NULL, &config.mono_jit_options);
+    try_get_env("DOORSTOP_MONO_GC_NURSERY_SIZE", NULL,
+                &config.mono_gc_nursery_size);
+    try_get_env("DOORSTOP_MONO_GC_MAJOR", NULL, &config.mono_gc_major);
+    try_get_env("DOORSTOP_MONO_GC_SOFT_HEAP_LIMIT", NULL,
+                &config.mono_gc_soft_heap_limit);
+    try_get_env("DOORSTOP_MONO_GC_PARAMS", NULL, &config.mono_gc_params);
+    try_get_env("DOORSTOP_MONO_GC_DEBUG", NULL, &config.mono_gc_debug);
+    get_env_bool("DOORSTOP_MONO_SHARED_CACHE", &config.mono_shared_cache);
     get_env_path("DOORSTOP_TARGET_ASSEMBLY", &config.target_assembly);
     get_env_path("DOORSTOP_BOOT_CONFIG_OVERRIDE", &config.boot_config_override);
     try_get_env("DOORSTOP_MONO_DLL_SEARCH_PATH_OVERRIDE", TEXT(""),
@@ -44,18 +73,76 @@ void load_config() {
     get_env_path("DOORSTOP_CLR_RUNTIME_CORECLR_PATH",
                  &config.clr_runtime_coreclr_path);
     get_env_path("DOORSTOP_CLR_CORLIB_DIR", &config.clr_corlib_dir);
+    get_env_bool("DOORSTOP_CLR_CONCURRENT_INIT", &config.clr_concurrent_init);
+    get_env_bool("DOORSTOP_IL2CPP_POOL_ALLOCATOR",
+                 &config.il2cpp_pool_allocator);
+    try_get_env("DOORSTOP_IL2CPP_GC_MODE", NULL, &config.il2cpp_gc_mode);
+    get_env_uint("DOORSTOP_IL2CPP_GC_MAX_TIME_SLICE_NS",
+                 &config.il2cpp_gc_max_time_slice_ns);
+    char_t *clr_properties = getenv("DOORSTOP_CLR_RUNTIME_PROPERTIES");
+    if (clr_properties && *clr_properties)
+        add_clr_runtime_properties(clr_properties, ';');
+    get_env_bool("DOORSTOP_PERF_MAP", &config.perf_map);
+    get_env_path("DOORSTOP_RUNTIME_INVOKE_PROFILE",
+                 &config.runtime_invoke_profile);
+    get_env_path("DOORSTOP_BOOT_TRACE", &config.boot_trace);
+    get_env_path("DOORSTOP_BOOT_READAHEAD_LIST", &config.boot_readahead_list);
+    get_env_uint("DOORSTOP_BOOT_READAHEAD_SECONDS",
+                 &config.boot_readahead_seconds);
+}
+
+static void log_config() {
+    //Print out all the relevant configuration settings using LOG_DEBUG()
+    LOG_DEBUG("DOORSTOP_ENABLED: %d", config.enabled);
+    LOG_DEBUG("DOORSTOP_REDIRECT_OUTPUT_LOG: %d", config.redirect_output_log);
+    LOG_DEBUG("DOORSTOP_IGNORE_DISABLED_ENV: %d", config.ignore_disabled_env);
+    LOG_DEBUG("DOORSTOP_MONO_DEBUG_ENABLED: %d", config.mono_debug_enabled);
+    LOG_DEBUG("DOORSTOP_MONO_DEBUG_SUSPEND: %d", config.mono_debug_suspend);
+    LOG_DEBUG("DOORSTOP_MONO_DEBUG_ADDRESS: %s", config.mono_debug_address);
+    LOG_DEBUG("DOORSTOP_MONO_JIT_OPTIONS: %s", config.mono_jit_options);
+    LOG_DEBUG("DOORSTOP_MONO_GC_NURSERY_SIZE: %s", config.mono_gc_nursery_size);
+    LOG_DEBUG("DOORSTOP_MONO_GC_MAJOR: %s", config.mono_gc_major);
+    LOG_DEBUG("DOORSTOP_MONO_GC_SOFT_HEAP_LIMIT: %s",
+              config.mono_gc_soft_heap_limit);
+    LOG_DEBUG("DOORSTOP_MONO_GC_PARAMS: %s", config.mono_gc_params);
+    LOG_DEBUG("DOORSTOP_MONO_GC_DEBUG: %s", config.mono_gc_debug);
+    LOG_DEBUG("DOORSTOP_MONO_SHARED_CACHE: %d", config.mono_shared_cache);
+    LOG_DEBUG("DOORSTOP_TARGET_ASSEMBLY: %s", config.target_assembly);
+    LOG_DEBUG("DOORSTOP_BOOT_CONFIG_OVERRIDE: %s", config.boot_config_override);
+    LOG_DEBUG("DOORSTOP_MONO_DLL_SEARCH_PATH_OVERRIDE: %s",
+              config.mono_dll_search_path_override);
+    LOG_DEBUG("DOORSTOP_CLR_RUNTIME_CORECLR_PATH: %s",
+              config.clr_runtime_coreclr_path);
+    LOG_DEBUG("DOORSTOP_CLR_CORLIB_DIR: %s", config.clr_corlib_dir);
+    LOG_DEBUG("DOORSTOP_CLR_CONCURRENT_INIT: %d", config.clr_concurrent_init);
+    LOG_DEBUG("DOORSTOP_IL2CPP_POOL_ALLOCATOR: %d",
+              config.il2cpp_pool_allocator);
+    LOG_DEBUG("DOORSTOP_IL2CPP_GC_MODE: %s", config.il2cpp_gc_mode);
+    LOG_DEBUG("DOORSTOP_IL2CPP_GC_MAX_TIME_SLICE_NS: %u",
+              config.il2cpp_gc_max_time_slice_ns);
+    for (size_t i = 0; i < config.clr_runtime_property_count; i++)
+        LOG_DEBUG("DOORSTOP_CLR_RUNTIME_PROPERTIES: %s=%s",
+                  config.clr_runtime_properties[i].key,
+                  config.clr_runtime_properties[i].value);
+    LOG_DEBUG("DOORSTOP_PERF_MAP: %d", config.perf_map);
+    LOG_DEBUG("DOORSTOP_RUNTIME_INVOKE_PROFILE: %s",
+              config.runtime_invoke_profile);
+    LOG_DEBUG("DOORSTOP_BOOT_TRACE: %s", config.boot_trace);
+    LOG_DEBUG("DOORSTOP_BOOT_READAHEAD_LIST: %s", config.boot_readahead_list);
+    LOG_DEBUG("DOORSTOP_BOOT_READAHEAD_SECONDS: %u",
+              config.boot_readahead_seconds);
+    LOG_DEBUG("DOORSTOP_LOG_LEVEL: %s", config.log_level);
+}
 
-    //Print out all the relevant configuration settings using LOG()
-    LOG("DOORSTOP_ENABLED: %d", config.enabled);
-    LOG("DOORSTOP_REDIRECT_OUTPUT_LOG: %d", config.redirect_output_log);
-    LOG("DOORSTOP_IGNORE_DISABLED_ENV: %d", config.ignore_disabled_env);
-    LOG("DOORSTOP_MONO_DEBUG_ENABLED: %d", config.mono_debug_enabled);
-    LOG("DOORSTOP_MONO_DEBUG_SUSPEND: %d", config.mono_debug_suspend);
-    LOG("DOORSTOP_MONO_DEBUG_ADDRESS: %s", config.mono_debug_address);
-    LOG("DOORSTOP_TARGET_ASSEMBLY: %s", config.target_assembly);
-    LOG("DOORSTOP_BOOT_CONFIG_OVERRIDE: %s", config.boot_config_override);
-    LOG("DOORSTOP_MONO_DLL_SEARCH_PATH_OVERRIDE: %s",
-        config.mono_dll_search_path_override);
-    LOG("DOORSTOP_CLR_RUNTIME_CORECLR_PATH: %s", config.clr_runtime_coreclr_path);
-    LOG("DOORSTOP_CLR_CORLIB_DIR: %s", config.clr_corlib_dir);
-}
\ No newline at end of file
+void load_config() {
+    init_config_defaults();
+    // Environment variables, as set by run.sh, override the config file.
+    // Without the file, the options still get the defaults of its keys.
+    if (!load_config_file(CONFIG_NAME)) {
+        config.enabled = TRUE;
+        config.target_assembly = get_full_path(DEFAULT_TARGET_ASSEMBLY);
+    }
+    load_env();
+    resolve_config();
+    log_config();
+}
@@ -1,10 +1,18 @@
+#define LOG_CATEGORY LOG_CAT_HOOKS
 #include "../bootstrap.h"
 #include "../config/config.h"
 #include "../crt.h"
+#include "../preload/warmup.h"
 #include "../util/logging.h"
 #include "../util/paths.h"
+#include "../util/pool.h"
+#include "../util/profiler.h"
+#include "../util/trace.h"
 #include "../util/util.h"
 #include "./plthook/plthook.h"
+#include "readahead.h"
+#include <fcntl.h>
+#include <stdarg.h>
 
 #if defined(__APPLE__)
 #define PLTHOOK_OPEN_BY_HANDLE_OR_ADDRESS plthook_open_by_handle
@@ -18,6 +26,8 @@ void capture_mono_path(void *handle) {
     setenv(TEXT("DOORSTOP_MONO_LIB_PATH"), result, TRUE);
 }
 
+static void hook_runtime_opens(void *handle, void *symbol);
+
 static bool_t initialized = FALSE;
 void *dlsym_hook(void *handle, const char *name) {
 #define REDIRECT_INIT(init_name, init_func, target, extra_init)                \
@@ -25,6 +35,7 @@ void *dlsym_hook(void *handle, const char *name) {
         if (!initialized) {                                                    \
             initialized = TRUE;                                                \
             init_func(handle);                                                 \
+            hook_runtime_opens(handle, res);                                   \
             extra_init;                                                        \
         }                                                                      \
         return (void *)target;                                                 \
@@ -47,6 +58,17 @@ void *dlsym_hook(void *handle, const char *name) {
     REDIRECT_INIT("mono_debug_init", load_mono_funcs, hook_mono_debug_init,
                   capture_mono_path(res));
 
+    if (config.runtime_invoke_profile) {
+        REDIRECT_INIT("il2cpp_runtime_invoke", load_il2cpp_funcs,
+                      hook_il2cpp_runtime_invoke, {});
+        REDIRECT_INIT("il2cpp_shutdown", load_il2cpp_funcs,
+                      hook_il2cpp_shutdown, {});
+        REDIRECT_INIT("mono_runtime_invoke", load_mono_funcs,
+                      hook_mono_runtime_invoke, capture_mono_path(res));
+        REDIRECT_INIT("mono_jit_cleanup", load_mono_funcs,
+                      hook_mono_jit_cleanup, capture_mono_path(res));
+    }
+
 #undef REDIRECT_INIT
     return res;
 }
@@ -64,24 +86,149 @@ char_t *default_boot_config_path = NULL;
 FILE *fopen64_hook(char *filename, char *mode) {
     char *actual_file_name = filename;
 
-    if (strcmp(filename, default_boot_config_path) == 0) {
+    if (default_boot_config_path &&
+        strcmp(filename, default_boot_config_path) == 0) {
         actual_file_name = config.boot_config_override;
         LOG("Overriding boot.config to %s", actual_file_name);
     }
 
-    return fopen64(actual_file_name, mode);
+    FILE *result = fopen64(actual_file_name, mode);
+    if (result)
+        readahead_record(actual_file_name);
+    return result;
 }
 #endif
 
 FILE *fopen_hook(char *filename, char *mode) {
     char *actual_file_name = filename;
 
-    if (strcmp(filename, default_boot_config_path) == 0) {
+    if (default_boot_config_path &&
+        strcmp(filename, default_boot_config_path) == 0) {
         actual_file_name = config.boot_config_override;
         LOG("Overriding boot.config to %s", actual_file_name);
     }
 
-    return fopen(actual_file_name, mode);
+    FILE *result = fopen(actual_file_name, mode);
+    if (result)
+        readahead_record(actual_file_name);
+    return result;
+}
+
+// open and openat only take a mode when a file may be created
+#if defined(O_TMPFILE)
+#define OPEN_NEEDS_MODE(flags)                                                 \
+    (((flags) & O_CREAT) || ((flags) & O_TMPFILE) == O_TMPFILE)
+#else
+#define OPEN_NEEDS_MODE(flags) ((flags) & O_CREAT)
+#endif
+
+#define OPEN_HOOK_BODY(call)                                                   \
+    mode_t mode = 0;                                                           \
+    if (OPEN_NEEDS_MODE(flags)) {                                              \
+        va_list args;                                                          \
+        va_start(args, flags);                                                 \
+        mode = va_arg(args, int);                                              \
+        va_end(args);                                                          \
+    }                                                                          \
+    int fd = call;                                                             \
+    if (fd >= 0 && (flags & O_ACCMODE) == O_RDONLY)                            \
+        readahead_record(path);                                                \
+    return fd;
+
+int open_hook(const char *path, int flags, ...) {
+    OPEN_HOOK_BODY(open(path, flags, mode));
+}
+
+#if !defined(__APPLE__)
+int open64_hook(const char *path, int flags, ...) {
+    OPEN_HOOK_BODY(open64(path, flags, mode));
+}
+#endif
+
+int openat_hook(int dir_fd, const char *path, int flags, ...) {
+    mode_t mode = 0;
+    if (OPEN_NEEDS_MODE(flags)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, int);
+        va_end(args);
+    }
+    int fd = openat(dir_fd, path, flags, mode);
+    // Paths relative to another folder can't be replayed
+    if (fd >= 0 && (flags & O_ACCMODE) == O_RDONLY &&
+        (dir_fd == AT_FDCWD || path[0] == '/'))
+        readahead_record(path);
+    return fd;
+}
+
+#undef OPEN_HOOK_BODY
+
+static void hook_fopen_calls(plthook_t *hook) {
+#if !defined(__APPLE__)
+    if (plthook_replace(hook, "fopen64", &fopen64_hook, NULL) != 0)
+        LOG_AT(LOG_LEVEL_WARN, LOG_CAT_PLTHOOK,
+               "Failed to hook fopen64, ignoring it. Error: %s",
+               plthook_error());
+#endif
+    if (plthook_replace(hook, "fopen", &fopen_hook, NULL) != 0)
+        LOG_AT(LOG_LEVEL_WARN, LOG_CAT_PLTHOOK,
+               "Failed to hook fopen, ignoring it. Error: %s",
+               plthook_error());
+}
+
+static void hook_open_calls(plthook_t *hook) {
+#if !defined(__APPLE__)
+    if (plthook_replace(hook, "open64", &open64_hook, NULL) != 0)
+        LOG_AT(LOG_LEVEL_WARN, LOG_CAT_PLTHOOK,
+               "Failed to hook open64, ignoring it. Error: %s",
+               plthook_error());
+#endif
+    if (plthook_replace(hook, "open", &open_hook, NULL) != 0)
+        LOG_AT(LOG_LEVEL_WARN, LOG_CAT_PLTHOOK,
+               "Failed to hook open, ignoring it. Error: %s",
+               plthook_error());
+    if (plthook_replace(hook, "openat", &openat_hook, NULL) != 0)
+        LOG_AT(LOG_LEVEL_WARN, LOG_CAT_PLTHOOK,
+               "Failed to hook openat, ignoring it. Error: %s",
+               plthook_error());
+}
+
+static bool_t record_readahead = FALSE;
+
+/**
+ * @brief Record the runtime library and the files it opens itself for boot
+ * readahead. The runtime is loaded by the dynamic loader and opens the
+ * managed assemblies or global-metadata.dat through its own PLT, so neither
+ * goes through the hooks on UnityPlayer.
+ *
+ * @param handle Handle of the runtime library.
+ * @param symbol Any symbol of the runtime library.
+ */
+static void hook_runtime_opens(void *handle, void *symbol) {
+    if (!record_readahead || !symbol)
+        return;
+
+    Dl_info info;
+    if (dladdr(symbol, &info) && info.dli_fname)
+        readahead_record(info.dli_fname);
+
+    plthook_t *hook;
+#if defined(__APPLE__)
+    int result = plthook_open_by_handle(&hook, handle);
+#else
+    (void)handle;
+    int result = plthook_open_by_address(&hook, symbol);
+#endif
+    if (result != 0) {
+        LOG_AT(LOG_LEVEL_WARN, LOG_CAT_PLTHOOK,
+               "Failed to open the runtime PLT, its files won't be recorded. "
+               "Error: %s",
+               plthook_error());
+        return;
+    }
+    hook_fopen_calls(hook);
+    hook_open_calls(hook);
+    plthook_close(hook);
 }
 
 int dup2_hook(int od, int nd) {
@@ -93,64 +240,83 @@ int dup2_hook(int od, int nd) {
 }
 
 __attribute__((constructor)) void doorstop_ctor() {
+    unsigned long long ctor_start = monotonic_time_us();
     init_logger();
+    unsigned long long config_start = monotonic_time_us();
     load_config();
+    unsigned long long config_end = monotonic_time_us();
 
     if (!config.enabled) {
         LOG("Doorstop not enabled! Skipping!");
         return;
     }
 
+    // Phases before the config was loaded are recorded retroactively
+    if (config.boot_trace && trace_init(config.boot_trace)) {
+        trace_event("doorstop_ctor", 'B', ctor_start);
+        trace_event("load_config", 'B', config_start);
+        trace_event("load_config", 'E', config_end);
+    }
+
+    record_readahead = readahead_init();
+
+    if (config.runtime_invoke_profile &&
+        !profiler_init(config.runtime_invoke_profile)) {
+        LOG_ERROR("Failed to start the runtime_invoke profiler");
+        free(config.runtime_invoke_profile);
+        config.runtime_invoke_profile = NULL;
+    }
+
     plthook_t *hook;
 
+    trace_begin("plthook");
     void *unity_player = plthook_handle_by_name("UnityPlayer");
 
     if (unity_player &&
         PLTHOOK_OPEN_BY_HANDLE_OR_ADDRESS(&hook, unity_player) == 0) {
-        LOG("Found UnityPlayer, hooking into it instead");
+        LOG_AT(LOG_LEVEL_INFO, LOG_CAT_PLTHOOK,
+               "Found UnityPlayer, hooking into it instead");
     } else if (plthook_open(&hook, NULL) != 0) {
-        LOG("Failed to open current process PLT! Cannot run Doorstop! "
-            "Error: "
-            "%s\n",
-            plthook_error());
+        LOG_AT(LOG_LEVEL_ERROR, LOG_CAT_PLTHOOK,
+               "Failed to open current process PLT! Cannot run Doorstop! "
+               "Error: "
+               "%s\n",
+               plthook_error());
+        trace_end("plthook");
+        trace_end("doorstop_ctor");
         return;
     }
 
     if (plthook_replace(hook, "dlsym", &dlsym_hook, NULL) != 0)
-        LOG("Failed to hook dlsym, ignoring it. Error: %s",
+        LOG_AT(LOG_LEVEL_WARN, LOG_CAT_PLTHOOK,
+               "Failed to hook dlsym, ignoring it. Error: %s",
                plthook_error());
 
+    bool_t hook_fopen = record_readahead;
     if (config.boot_config_override) {
         if (file_exists(config.boot_config_override)) {
-            default_boot_config_path = calloc(MAX_PATH, sizeof(char_t));
-            memset(default_boot_config_path, 0, MAX_PATH * sizeof(char_t));
-            strcat(default_boot_config_path, get_working_dir());
-            strcat(default_boot_config_path, TEXT("/"));
-            strcat(default_boot_config_path,
-                   get_file_name(program_path(), FALSE));
-            strcat(default_boot_config_path, TEXT("_Data/boot.config"));
-
-#if !defined(__APPLE__)
-            if (plthook_replace(hook, "fopen64", &fopen64_hook, NULL) != 0)
-                LOG("Failed to hook fopen64, ignoring it. Error: %s",
-                       plthook_error());
-#endif
-            if (plthook_replace(hook, "fopen", &fopen_hook, NULL) != 0)
-                LOG("Failed to hook fopen, ignoring it. Error: %s",
-                       plthook_error());
+            default_boot_config_path = config.default_boot_config_path;
+            hook_fopen = TRUE;
         } else {
-            LOG("The boot.config file won't be overriden because the provided "
-                "one does not exist: %s",
-                config.boot_config_override);
+            LOG_WARN("The boot.config file won't be overriden because the "
+                     "provided one does not exist: %s",
+                     config.boot_config_override);
         }
     }
 
+    if (hook_fopen)
+        hook_fopen_calls(hook);
+    if (record_readahead)
+        hook_open_calls(hook);
+
     if (plthook_replace(hook, "fclose", &fclose_hook, NULL) != 0)
-        LOG("Failed to hook fclose, ignoring it. Error: %s",
+        LOG_AT(LOG_LEVEL_WARN, LOG_CAT_PLTHOOK,
+               "Failed to hook fclose, ignoring it. Error: %s",
                plthook_error());
 
     if (plthook_replace(hook, "dup2", &dup2_hook, NULL) != 0)
-        LOG("Failed to hook dup2, ignoring it. Error: %s",
+        LOG_AT(LOG_LEVEL_WARN, LOG_CAT_PLTHOOK,
+               "Failed to hook dup2, ignoring it. Error: %s",
                plthook_error());
 
 #if defined(__APPLE__)
@@ -162,11 +328,30 @@ __attribute__((constructor)) void doorstop_ctor() {
     void *mono_handle = plthook_handle_by_name("libmono");
 
     if (plthook_replace(hook, "mono_jit_init_version", &init_mono, NULL) != 0)
-        LOG("Failed to hook jit_init_version, ignoring it. This is probably fine unless you see other errors. Error: %s",
+        LOG_AT(LOG_LEVEL_WARN, LOG_CAT_PLTHOOK,
+               "Failed to hook jit_init_version, ignoring it. This is "
+               "probably fine unless you see other errors. Error: %s",
                plthook_error());
     else if (mono_handle)
         load_mono_funcs(mono_handle);
 #endif
 
     plthook_close(hook);
+    trace_end("plthook");
+
+    // Unity spends a while on its own setup before it initializes the
+    // runtime; use that time to read and prefetch everything Doorstop needs
+    warmup_start();
+    trace_end("doorstop_ctor");
+}
+
+__attribute__((destructor)) void doorstop_dtor() {
+    // The pool stays mapped, so il2cpp may still free into it afterwards
+    pool_log_stats();
+    // The runtime may already be gone, so methods are written as addresses
+    profiler_dump(NULL);
+    // Only written here if the runtime never finished bootstrapping
+    trace_write();
+    // Writes the messages still queued
+    free_logger(FALSE);
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "logger.h"
+#include "../crt.h"
+#include <fcntl.h>
+#include <stdarg.h>
+#include <sys/mman.h>
+
+#if VERBOSE
+// The log file is mapped into memory, so that writing to it is a copy instead
+// of a system call. The mapping is reserved in steps of LOG_MAP_SIZE, but the
+// file is only extended LOG_FILE_GROW_SIZE at a time: a log cut short by a
+// crash ends with at most that many zero bytes.
+#define LOG_MAP_SIZE (1024 * 1024)
+#define LOG_FILE_GROW_SIZE (16 * 1024)
+
+static int log_fd = -1;
+static char *log_map = NULL;
+static size_t log_map_size = 0;
+// Size the file is extended to, and size of the lines written to it
+static size_t log_file_capacity = 0;
+static size_t log_file_size = 0;
+
+void log_format(const char *format, ...) {
+    char message[LOG_RING_MESSAGE_SIZE];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    if (length < 0)
+        return;
+    if ((size_t)length >= sizeof(message))
+        length = sizeof(message) - 1;
+    log_ring_write(message, length);
+}
+
+static void write_fd(int fd, const char *data, size_t size) {
+    while (size) {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0)
+            return;
+        data += written;
+        size -= written;
+    }
+}
+
+#if !BINARY_LOG
+static void log_sink_stderr(const char *data, size_t size) {
+    write_fd(STDERR_FILENO, data, size);
+}
+#endif
+
+// The file is opened with O_APPEND, so this writes after the mapped lines
+static void log_sink_file(const char *data, size_t size) {
+    write_fd(log_fd, data, size);
+}
+
+// Cuts the preallocated tail that won't be written anymore
+static bool_t trim_log_file() { return ftruncate(log_fd, log_file_size) == 0; }
+
+static void unmap_log_file() {
+    if (log_map)
+        munmap(log_map, log_map_size);
+    log_map = NULL;
+    log_map_size = 0;
+    log_file_capacity = log_file_size;
+    trim_log_file();
+}
+
+// Extends the file, and maps it again if it outgrows the mapping. Pages
+// already written stay in the page cache, so nothing is copied.
+static bool_t grow_log_file(size_t needed) {
+    size_t capacity = log_file_capacity;
+    while (capacity < needed)
+        capacity += LOG_FILE_GROW_SIZE;
+
+    if (capacity > log_map_size) {
+        size_t map_size = log_map_size ? log_map_size : LOG_MAP_SIZE;
+        while (map_size < capacity)
+            map_size *= 2;
+        // Only the part within the file is ever touched
+        char *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                         log_fd, 0);
+        if (map == MAP_FAILED) {
+            unmap_log_file();
+            return FALSE;
+        }
+        if (log_map)
+            munmap(log_map, log_map_size);
+        log_map = map;
+        log_map_size = map_size;
+    }
+
+    if (ftruncate(log_fd, capacity) != 0) {
+        unmap_log_file();
+        return FALSE;
+    }
+    log_file_capacity = capacity;
+    return TRUE;
+}
+
+/*
+ * Only called by the log ring with its writer lock held. Lines copied to the
+ * mapping survive a crash of the game, as they are already in the page cache.
+ */
+static void log_sink_map(const char *data, size_t size) {
+    if (log_map && log_file_size + size > log_file_capacity)
+        grow_log_file(log_file_size + size);
+
+    if (log_map)
+        memcpy(log_map + log_file_size, data, size);
+    else
+        write_fd(log_fd, data, size);
+    log_file_size += size;
+}
+
+void init_logger() {
+    char name[64];
+#ifdef DETERMINISTIC_LOG
+    snprintf(name, sizeof(name), "doorstop.log");
+#else
+    snprintf(name, sizeof(name), "doorstop_%d.log", (int)getpid());
+#endif
+    log_fd = open(name, O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC,
+                  0644);
+    if (log_fd < 0) {
+#if !BINARY_LOG
+        log_ring_init(log_sink_stderr, "[Doorstop]");
+#endif
+        return;
+    }
+    grow_log_file(LOG_FILE_GROW_SIZE);
+    log_ring_init(log_sink_map, "");
+}
+
+void free_logger(bool_t terminating) {
+    log_ring_shutdown(terminating);
+    if (!log_map)
+        return;
+
+    // Messages logged after this are appended with write()
+    log_ring_set_sink(log_sink_file);
+    unmap_log_file();
+}
+#endif
@@ -2,16 +2,43 @@
 #define LOGGER_NIX_H
 #if VERBOSE
 
-#define LOG(message, ...) fprintf(stderr, "[Doorstop] " message "\n", ##__VA_ARGS__)
+#include "../util/log_binary.h"
+#include "../util/log_ring.h"
+#include <stdio.h>
+#include <stdlib.h>
 
+/**
+ * @brief Format a message and queue it to be written to the log file.
+ */
+void log_format(const char *format, ...)
+    __attribute__((format(printf, 1, 2)));
+
+#if BINARY_LOG
+#define LOG_WRITE(message, ...)                                                \
+    do {                                                                       \
+        static LogSite log_site;                                               \
+        log_binary_write(&log_site, message, ##__VA_ARGS__);                   \
+    } while (0)
+#else
+#define LOG_WRITE(message, ...) log_format(message, ##__VA_ARGS__)
+#endif
+
+// The queued messages are written first, then the error is written to the
+// log file directly, so that it isn't dropped if the ring is full
 #define ASSERT_F(test, message, ...)                                           \
     if (!(test)) {                                                             \
+        log_ring_shutdown(FALSE);                                              \
+        LOG_WRITE("[Fatal] " message, ##__VA_ARGS__);                          \
+        free_logger(FALSE);                                                    \
         fprintf(stderr, "[Doorstop][Fatal] " message "\n", ##__VA_ARGS__);     \
         exit(1);                                                               \
     }
 
 #define ASSERT(test, message)                                                  \
     if (!(test)) {                                                             \
+        log_ring_shutdown(FALSE);                                              \
+        LOG_WRITE("[Fatal] " message);                                         \
+        free_logger(FALSE);                                                    \
         fprintf(stderr, "[Doorstop][Fatal] " message "\n");                    \
         exit(1);                                                               \
     }
@@ -21,8 +48,24 @@
         return __VA_ARGS__;                                                    \
     }
 
-static inline void init_logger() {}
-static inline void free_logger() {}
+/**
+ * @brief Open the log file, doorstop_<pid>.log or doorstop.log with
+ * DETERMINISTIC_LOG, and start writing logged messages to it.
+ *
+ * The file is mapped into memory and grown in small steps as needed, so
+ * writing a message to it rarely makes a system call. If it can't be
+ * created, text messages are written to stderr instead.
+ */
+void init_logger();
 
+/**
+ * @brief Write the queued messages and trim the file to its contents.
+ *
+ * Messages logged after this are still appended to the file.
+ *
+ * @param terminating TRUE if every other thread was already killed.
+ */
+void free_logger(bool_t terminating);
+
+#endif
 #endif
-#endif
\ No newline at end of file
@@ -0,0 +1,4 @@
+#include "../mapper/mapper.h"
+
+// Only Windows players obfuscate the names of their exports
+const char *get_mapped_player_name(const char *name) { return name; }
@@ -0,0 +1,50 @@
+#include "../util/pool.h"
+#include "../crt.h"
+#include <sys/mman.h>
+
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#define usable_size malloc_size
+#else
+#include <malloc.h>
+#define usable_size malloc_usable_size
+#endif
+
+void *pool_sys_reserve(size_t size) {
+    void *addr = mmap(NULL, size, PROT_NONE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return addr == MAP_FAILED ? NULL : addr;
+}
+
+bool_t pool_sys_commit(void *addr, size_t size) {
+    return mprotect(addr, size, PROT_READ | PROT_WRITE) == 0;
+}
+
+void *pool_sys_malloc(size_t size) { return malloc(size); }
+
+void *pool_sys_realloc(void *ptr, size_t size) { return realloc(ptr, size); }
+
+void pool_sys_free(void *ptr) { free(ptr); }
+
+void *pool_sys_aligned_malloc(size_t size, size_t alignment) {
+    if (alignment < sizeof(void *))
+        alignment = sizeof(void *);
+    void *result = NULL;
+    if (posix_memalign(&result, alignment, size) != 0)
+        return NULL;
+    return result;
+}
+
+void *pool_sys_aligned_realloc(void *ptr, size_t size, size_t alignment) {
+    if (!ptr)
+        return pool_sys_aligned_malloc(size, alignment);
+    void *result = pool_sys_aligned_malloc(size, alignment);
+    if (!result)
+        return NULL;
+    size_t old_size = usable_size(ptr);
+    memcpy(result, ptr, old_size < size ? old_size : size);
+    free(ptr);
+    return result;
+}
+
+void pool_sys_aligned_free(void *ptr) { free(ptr); }
@@ -0,0 +1,214 @@
+#include "readahead.h"
+#include "../config/config.h"
+#include "../crt.h"
+#include "../util/hash.h"
+#include "../util/logging.h"
+#include <pthread.h>
+#include <time.h>
+
+#define READAHEAD_MIN_SLOTS 1024
+
+typedef struct {
+    unsigned int hash;
+    // Index of the path in the list plus one; 0 marks an empty slot
+    unsigned int index;
+} SeenSlot;
+
+typedef struct {
+    pthread_mutex_t lock;
+    volatile bool_t recording;
+
+    // Opened files in the order they were first seen
+    char **paths;
+    size_t count;
+    size_t capacity;
+
+    // Open-addressed set of the recorded paths, to skip files seen before
+    SeenSlot *seen;
+    size_t seen_slots;
+} Recorder;
+
+static Recorder recorder = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static bool_t start_detached(void *(*func)(void *)) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, func, NULL) != 0)
+        return FALSE;
+    pthread_detach(thread);
+    return TRUE;
+}
+
+static void *replay_thread(void *arg) {
+    (void)arg;
+    FILE *list = fopen(config.boot_readahead_list, "r");
+    if (!list)
+        return NULL;
+
+#if VERBOSE
+    unsigned long long start = monotonic_time_us();
+#endif
+    size_t total = 0;
+    size_t prefetched = 0;
+    char line[MAX_PATH];
+    while (fgets(line, sizeof(line), list)) {
+        line[strcspn(line, "\n")] = 0;
+        if (!*line)
+            continue;
+        total++;
+        if (prefetch_file(line))
+            prefetched++;
+    }
+    fclose(list);
+
+    LOG("Boot readahead: prefetched %lu of %lu files in %llu ms",
+        (unsigned long)prefetched, (unsigned long)total,
+        (monotonic_time_us() - start) / 1000);
+    return NULL;
+}
+
+/**
+ * @brief Add the path to the list unless it was recorded before.
+ *
+ * @param path Full path, allocated with malloc. Owned by the list if added.
+ * @param hash Hash of the path.
+ * @return bool_t FALSE if the path was already in the list.
+ */
+static bool_t record_path(char *path, unsigned int hash) {
+    // Keep the load factor under 1/2
+    if ((recorder.count + 1) * 2 > recorder.seen_slots) {
+        size_t old_slots = recorder.seen_slots;
+        SeenSlot *old_seen = recorder.seen;
+        recorder.seen_slots =
+            old_slots ? old_slots * 2 : READAHEAD_MIN_SLOTS;
+        recorder.seen = calloc(recorder.seen_slots, sizeof(SeenSlot));
+        for (size_t i = 0; i < old_slots; i++) {
+            if (!old_seen[i].index)
+                continue;
+            size_t slot = old_seen[i].hash & (recorder.seen_slots - 1);
+            while (recorder.seen[slot].index)
+                slot = (slot + 1) & (recorder.seen_slots - 1);
+            recorder.seen[slot] = old_seen[i];
+        }
+        free(old_seen);
+    }
+
+    size_t slot = hash & (recorder.seen_slots - 1);
+    while (recorder.seen[slot].index) {
+        // Different paths may have the same hash
+        if (recorder.seen[slot].hash == hash &&
+            !strcmp(recorder.paths[recorder.seen[slot].index - 1], path))
+            return FALSE;
+        slot = (slot + 1) & (recorder.seen_slots - 1);
+    }
+
+    if (recorder.count >= recorder.capacity) {
+        recorder.capacity = recorder.capacity ? recorder.capacity * 2 : 256;
+        recorder.paths =
+            realloc(recorder.paths, recorder.capacity * sizeof(char *));
+    }
+    recorder.paths[recorder.count++] = path;
+    recorder.seen[slot].hash = hash;
+    recorder.seen[slot].index = (unsigned int)recorder.count;
+    return TRUE;
+}
+
+static bool_t should_record(const char *path) {
+    // Pseudo filesystems are not backed by the page cache
+    if (!strncmp(path, "/proc/", 6) || !strncmp(path, "/sys/", 5) ||
+        !strncmp(path, "/dev/", 5))
+        return FALSE;
+    if (!strcmp(path, config.boot_readahead_list))
+        return FALSE;
+
+    struct stat sb;
+    return stat(path, &sb) == 0 && S_ISREG(sb.st_mode);
+}
+
+void readahead_record(const char *path) {
+    if (!recorder.recording || !path)
+        return;
+
+    char *full_path = get_full_path((char_t *)path);
+    if (!full_path)
+        return;
+    if (!should_record(full_path)) {
+        free(full_path);
+        return;
+    }
+
+    unsigned int hash =
+        hash_fnv1a(full_path, strlen(full_path), FNV1A_OFFSET_BASIS);
+
+    pthread_mutex_lock(&recorder.lock);
+    bool_t recorded = recorder.recording && record_path(full_path, hash);
+    pthread_mutex_unlock(&recorder.lock);
+    if (!recorded)
+        free(full_path);
+}
+
+static void write_list() {
+    char *tmp_path =
+        calloc(strlen(config.boot_readahead_list) + 32, sizeof(char));
+    sprintf(tmp_path, "%s.%d.tmp", config.boot_readahead_list, (int)getpid());
+
+    FILE *list = fopen(tmp_path, "w");
+    if (!list) {
+        LOG("Boot readahead: failed to write %s", tmp_path);
+        free(tmp_path);
+        return;
+    }
+    for (size_t i = 0; i < recorder.count; i++)
+        fprintf(list, "%s\n", recorder.paths[i]);
+    bool_t ok = fclose(list) == 0;
+
+    // Written to a temporary file first so that a concurrently booting
+    // instance never replays a partial list
+    if (ok && rename(tmp_path, config.boot_readahead_list) == 0) {
+        LOG("Boot readahead: recorded %lu files to %s",
+            (unsigned long)recorder.count, config.boot_readahead_list);
+    } else {
+        unlink(tmp_path);
+    }
+    free(tmp_path);
+}
+
+static void *record_timer_thread(void *arg) {
+    (void)arg;
+    struct timespec duration = {.tv_sec = config.boot_readahead_seconds};
+    while (nanosleep(&duration, &duration) != 0)
+        ;
+
+    pthread_mutex_lock(&recorder.lock);
+    recorder.recording = FALSE;
+    pthread_mutex_unlock(&recorder.lock);
+
+    write_list();
+
+    for (size_t i = 0; i < recorder.count; i++)
+        free(recorder.paths[i]);
+    free(recorder.paths);
+    free(recorder.seen);
+    recorder.paths = NULL;
+    recorder.seen = NULL;
+    return NULL;
+}
+
+bool_t readahead_init() {
+    if (!config.boot_readahead_list)
+        return FALSE;
+
+    if (file_exists(config.boot_readahead_list)) {
+        LOG("Boot readahead: replaying %s", config.boot_readahead_list);
+        start_detached(replay_thread);
+        return FALSE;
+    }
+
+    LOG("Boot readahead: recording files opened during the first %u s to %s",
+        config.boot_readahead_seconds, config.boot_readahead_list);
+    recorder.recording = TRUE;
+    if (!start_detached(record_timer_thread)) {
+        recorder.recording = FALSE;
+        return FALSE;
+    }
+    return TRUE;
+}
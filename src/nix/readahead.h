@@ -0,0 +1,29 @@
+#ifndef READAHEAD_NIX_H
+#define READAHEAD_NIX_H
+
+#include "../util/util.h"
+
+/**
+ * @brief Set up boot readahead as configured by boot_readahead_list.
+ *
+ * If the list file exists, its files are prefetched into the page cache on a
+ * background thread. Otherwise, recording is started: every file opened by
+ * the game during the first boot_readahead_seconds seconds is appended to the
+ * list, which is written once the time is up.
+ *
+ * @return bool_t TRUE if recording was started and the open hooks should be
+ *                installed.
+ */
+bool_t readahead_init();
+
+/**
+ * @brief Record a file opened by the game.
+ *
+ * Does nothing unless recording is in progress. Safe to call from any thread.
+ *
+ * @param path Path to the opened file, relative to the working directory or
+ *             absolute.
+ */
+void readahead_record(const char *path);
+
+#endif
@@ -0,0 +1,246 @@
+#include "../preload/shared_cache.h"
+#include "../crt.h"
+#include "../util/logging.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#define SHARED_CACHE_MAGIC 0x43535344 // "DSSC"
+#define SHARED_CACHE_VERSION 1
+#define SHARED_CACHE_ALIGN 16
+
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    unsigned int count;
+    unsigned int reserved;
+    unsigned long long total_size;
+} SharedCacheHeader;
+
+typedef struct {
+    unsigned long long data_offset;
+    unsigned long long data_size;
+    unsigned long long src_size;
+    unsigned long long src_mtime;
+    unsigned int path_offset;
+    unsigned int path_len;
+} SharedCacheIndex;
+
+struct SharedCache {
+    unsigned char *base;
+    size_t size;
+    const SharedCacheHeader *header;
+    const SharedCacheIndex *index;
+};
+
+static size_t align_up(size_t value) {
+    return (value + SHARED_CACHE_ALIGN - 1) & ~(size_t)(SHARED_CACHE_ALIGN - 1);
+}
+
+/**
+ * @brief Get the path of the segment for the given key, creating the
+ * directory of the segments if needed.
+ *
+ * Segments live on tmpfs (/dev/shm) when available so that every instance
+ * maps the same physical pages. Their contents are handed to the runtime
+ * as-is, so they are kept in a directory that only the current user can
+ * access: in a shared directory, another user could plant a segment first.
+ *
+ * @return bool_t FALSE if the directory is not private to the current user.
+ */
+static bool_t get_segment_path(unsigned int key, char *buf, size_t buf_len) {
+    const char *base = "/dev/shm";
+    if (!folder_exists((char_t *)base)) {
+        base = getenv("TMPDIR");
+        if (!base || !*base)
+            base = "/tmp";
+    }
+
+    char dir[MAX_PATH];
+    snprintf(dir, sizeof(dir), "%s/doorstop-%u", base,
+             (unsigned int)geteuid());
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+        LOG("Failed to create shared cache directory %s", dir);
+        return FALSE;
+    }
+
+    struct stat sb;
+    if (lstat(dir, &sb) != 0 || !S_ISDIR(sb.st_mode) ||
+        sb.st_uid != geteuid() || (sb.st_mode & 077) != 0) {
+        LOG("Ignoring shared cache directory %s: not private to the current "
+            "user",
+            dir);
+        return FALSE;
+    }
+
+    int len = snprintf(buf, buf_len, "%s/%08x.cache", dir, key);
+    return len > 0 && (size_t)len < buf_len;
+}
+
+/**
+ * @brief Check that the index of a mapped segment only points inside it.
+ */
+static bool_t validate_index(const SharedCacheHeader *header, size_t size) {
+    if (header->magic != SHARED_CACHE_MAGIC ||
+        header->version != SHARED_CACHE_VERSION ||
+        header->total_size != (unsigned long long)size ||
+        header->count > (size - sizeof(SharedCacheHeader)) /
+                            sizeof(SharedCacheIndex))
+        return FALSE;
+
+    const SharedCacheIndex *index = (const SharedCacheIndex *)(header + 1);
+    for (unsigned int i = 0; i < header->count; i++) {
+        if (index[i].path_offset > size ||
+            index[i].path_len > size - index[i].path_offset ||
+            index[i].data_offset > size ||
+            index[i].data_size > size - index[i].data_offset)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+SharedCache *shared_cache_open(unsigned int key) {
+    char path[MAX_PATH];
+    if (!get_segment_path(key, path, sizeof(path)))
+        return NULL;
+
+    int fd = open(path, O_RDONLY | O_NOFOLLOW);
+    if (fd < 0) {
+        LOG("No shared cache segment at %s", path);
+        return NULL;
+    }
+
+    // Only trust segments that the current user published and that nobody
+    // else can modify. This also rules out other users truncating the file
+    // while it is mapped, which would fault the reader.
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || !S_ISREG(sb.st_mode) ||
+        sb.st_uid != geteuid() || (sb.st_mode & 022) != 0 ||
+        (size_t)sb.st_size < sizeof(SharedCacheHeader)) {
+        LOG("Ignoring shared cache segment %s: not a private read-only file",
+            path);
+        close(fd);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    const SharedCacheHeader *header = base;
+    if (!validate_index(header, sb.st_size)) {
+        LOG("Ignoring invalid shared cache segment %s", path);
+        munmap(base, sb.st_size);
+        return NULL;
+    }
+
+    SharedCache *cache = malloc(sizeof(SharedCache));
+    cache->base = base;
+    cache->size = sb.st_size;
+    cache->header = header;
+    cache->index = (const SharedCacheIndex *)(header + 1);
+    LOG("Mapped shared cache segment %s (%u entries, %lu bytes)", path,
+        header->count, (unsigned long)cache->size);
+    return cache;
+}
+
+void *shared_cache_find(SharedCache *cache, char_t *path,
+                        const FileStamp *stamp, size_t *size) {
+    if (!cache)
+        return NULL;
+
+    size_t path_len = strlen(path);
+    for (unsigned int i = 0; i < cache->header->count; i++) {
+        const SharedCacheIndex *entry = &cache->index[i];
+        // Offsets were checked by validate_index
+        if (entry->path_len != path_len)
+            continue;
+        if (memcmp(cache->base + entry->path_offset, path, path_len) != 0)
+            continue;
+        if (entry->src_size != stamp->size ||
+            entry->src_mtime != stamp->mtime) {
+            LOG("Shared cache entry for %s is stale", path);
+            return NULL;
+        }
+        *size = entry->data_size;
+        return cache->base + entry->data_offset;
+    }
+    return NULL;
+}
+
+bool_t shared_cache_publish(unsigned int key, SharedCacheEntry *entries,
+                            size_t count) {
+    size_t total = align_up(sizeof(SharedCacheHeader) +
+                            count * sizeof(SharedCacheIndex));
+    size_t strings_start = total;
+    for (size_t i = 0; i < count; i++)
+        total += strlen(entries[i].path);
+    total = align_up(total);
+    size_t data_start = total;
+    for (size_t i = 0; i < count; i++)
+        total += align_up(entries[i].size);
+
+    char path[MAX_PATH];
+    char tmp_path[MAX_PATH + 32];
+    if (!get_segment_path(key, path, sizeof(path)))
+        return FALSE;
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, (int)getpid());
+
+    int fd = open(tmp_path, O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW, 0600);
+    if (fd < 0) {
+        LOG("Failed to create shared cache segment %s", tmp_path);
+        return FALSE;
+    }
+    if (ftruncate(fd, total) != 0) {
+        close(fd);
+        unlink(tmp_path);
+        return FALSE;
+    }
+    unsigned char *base =
+        mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        unlink(tmp_path);
+        return FALSE;
+    }
+
+    SharedCacheHeader *header = (SharedCacheHeader *)base;
+    SharedCacheIndex *index = (SharedCacheIndex *)(header + 1);
+    size_t string_pos = strings_start;
+    size_t data_pos = data_start;
+    for (size_t i = 0; i < count; i++) {
+        size_t path_len = strlen(entries[i].path);
+        memcpy(base + string_pos, entries[i].path, path_len);
+        memcpy(base + data_pos, entries[i].data, entries[i].size);
+
+        index[i].path_offset = string_pos;
+        index[i].path_len = path_len;
+        index[i].data_offset = data_pos;
+        index[i].data_size = entries[i].size;
+        index[i].src_size = entries[i].stamp.size;
+        index[i].src_mtime = entries[i].stamp.mtime;
+
+        string_pos += path_len;
+        data_pos += align_up(entries[i].size);
+    }
+    header->count = count;
+    header->total_size = total;
+    header->version = SHARED_CACHE_VERSION;
+    // Write the magic last so a partially written segment is never valid
+    header->magic = SHARED_CACHE_MAGIC;
+
+    munmap(base, total);
+    // Other instances only ever get a read-only view of the segment
+    fchmod(fd, 0444);
+    close(fd);
+
+    if (rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        return FALSE;
+    }
+
+    LOG("Published %lu assemblies to shared cache segment %s (%lu bytes)",
+        (unsigned long)count, path, (unsigned long)total);
+    return TRUE;
+}
@@ -0,0 +1,56 @@
+#include "../util/thread.h"
+#include "../crt.h"
+#include <pthread.h>
+#include <time.h>
+
+typedef struct {
+    thread_func_t func;
+    void *arg;
+} ThreadStart;
+
+static void *thread_trampoline(void *param) {
+    ThreadStart start = *(ThreadStart *)param;
+    free(param);
+    start.func(start.arg);
+    return NULL;
+}
+
+thread_t thread_start(thread_func_t func, void *arg) {
+    ThreadStart *start = malloc(sizeof(ThreadStart));
+    start->func = func;
+    start->arg = arg;
+
+    pthread_t *thread = malloc(sizeof(pthread_t));
+    if (pthread_create(thread, NULL, thread_trampoline, start) != 0) {
+        free(start);
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void thread_join(thread_t thread) {
+    if (!thread)
+        return;
+    pthread_join(*(pthread_t *)thread, NULL);
+    free(thread);
+}
+
+unsigned long thread_current_id() { return (unsigned long)pthread_self(); }
+
+void thread_sleep_ms(unsigned long ms) {
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000};
+    nanosleep(&ts, NULL);
+}
+
+bool_t tls_alloc(tls_key_t *key, tls_destructor_t destructor) {
+    pthread_key_t pthread_key;
+    if (pthread_key_create(&pthread_key, destructor) != 0)
+        return FALSE;
+    *key = pthread_key;
+    return TRUE;
+}
+
+void *tls_get(tls_key_t key) { return pthread_getspecific(key); }
+
+void tls_set(tls_key_t key, void *value) { pthread_setspecific(key, value); }
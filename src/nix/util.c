@@ -1,8 +1,12 @@
 #include "../util/util.h"
+#include "../util/arena.h"
 #include "../crt.h"
+#include <dirent.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 char_t *widen(const char *str) {
@@ -110,20 +114,20 @@ char *normalize_path(char *pwd, const char *src, char *res) {
 }
 
 char_t *get_full_path(char_t *path) {
-    char_t *full_path = (char_t *)calloc(MAX_PATH + 1, sizeof(char_t));
-    char_t *cwd_str = getcwd(NULL, MAX_PATH);
-    normalize_path(cwd_str, path, full_path);
-    free(cwd_str);
-    if (full_path == NULL) {
-        free(full_path);
+    char_t *cwd_str = getcwd(NULL, 0);
+    if (cwd_str == NULL)
         return NULL;
-    }
+    // Normalizing never makes the path longer than the working directory,
+    // a separator and the path itself
+    char_t *full_path = (char_t *)malloc(strlen(cwd_str) + strlen(path) + 3);
+    if (full_path != NULL)
+        normalize_path(cwd_str, path, full_path);
+    free(cwd_str);
     return full_path;
 }
 
 char_t *get_folder_name(char_t *path) {
-    char_t *path_copy = (char_t *)calloc(MAX_PATH + 1, sizeof(char_t));
-    strcpy(path_copy, path);
+    char_t *path_copy = strdup(path);
     char_t *folder = dirname(path_copy);
     char_t *result = (char_t *)malloc(strlen(folder) + 1);
     strcpy(result, folder);
@@ -132,8 +136,7 @@ char_t *get_folder_name(char_t *path) {
 }
 
 char_t *get_file_name(char_t *path, bool_t with_ext) {
-    char_t *path_copy = (char_t *)calloc(MAX_PATH + 1, sizeof(char_t));
-    strcpy(path_copy, path);
+    char_t *path_copy = strdup(path);
     char_t *file = basename(path_copy);
     char_t *result = (char_t *)calloc(strlen(file) + 1, sizeof(char_t));
     if (!with_ext) {
@@ -148,6 +151,27 @@ char_t *get_file_name(char_t *path, bool_t with_ext) {
     return result;
 }
 
+char_t *arena_folder_name(Arena *arena, const char_t *path) {
+    char_t *path_copy = arena_strdup(arena, path);
+    // dirname returns a part of the copy or a static string
+    return path_copy ? dirname(path_copy) : NULL;
+}
+
+char_t *arena_file_name(Arena *arena, const char_t *path, bool_t with_ext) {
+    char_t *path_copy = arena_strdup(arena, path);
+    if (!path_copy)
+        return NULL;
+    char_t *file = basename(path_copy);
+    if (!with_ext) {
+        // A leading dot (or the static "." basename may return) is no
+        // extension
+        char_t *ext = strrchr(file, '.');
+        if (ext != NULL && ext != file)
+            *ext = '\0';
+    }
+    return file;
+}
+
 bool_t file_exists(char_t *file) { return access(file, F_OK) == 0; }
 
 bool_t folder_exists(char_t *folder) {
@@ -176,10 +200,90 @@ char_t *program_path() {
 #endif
 }
 
+char_t *arena_program_path(Arena *arena) {
+    char_t path[MAX_PATH + 1];
+#if defined(__linux__)
+    ssize_t len = readlink("/proc/self/exe", path, MAX_PATH);
+    if (len == -1)
+        return NULL;
+    path[len] = '\0';
+#elif defined(__APPLE__)
+    uint32_t size = MAX_PATH;
+    if (_NSGetExecutablePath(path, &size) != 0)
+        return NULL;
+#endif
+    return arena_strdup(arena, path);
+}
+
 size_t get_file_size(void *file) {
     struct stat sb;
     if (fstat(fileno(file), &sb) == -1) {
         return 0;
     }
     return sb.st_size;
-}
\ No newline at end of file
+}
+
+bool_t get_file_stamp(char_t *file, FileStamp *stamp) {
+    struct stat sb;
+    if (stat(file, &sb) != 0)
+        return FALSE;
+    stamp->size = sb.st_size;
+#if defined(__APPLE__)
+    stamp->mtime = (unsigned long long)sb.st_mtimespec.tv_sec * 1000000000ULL +
+                   sb.st_mtimespec.tv_nsec;
+#else
+    stamp->mtime = (unsigned long long)sb.st_mtim.tv_sec * 1000000000ULL +
+                   sb.st_mtim.tv_nsec;
+#endif
+    return TRUE;
+}
+
+size_t list_files(char_t *dir, const char_t *ext, file_visitor_t visitor,
+                  void *user_data) {
+    DIR *d = opendir(dir);
+    if (!d)
+        return 0;
+
+    size_t ext_len = strlen(ext);
+    size_t count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        size_t name_len = strlen(entry->d_name);
+        if (name_len <= ext_len ||
+            strcmp(entry->d_name + name_len - ext_len, ext) != 0)
+            continue;
+        if (entry->d_type != DT_REG && entry->d_type != DT_LNK &&
+            entry->d_type != DT_UNKNOWN)
+            continue;
+        visitor(dir, entry->d_name, user_data);
+        count++;
+    }
+
+    closedir(d);
+    return count;
+}
+
+unsigned long long monotonic_time_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool_t prefetch_file(char_t *file) {
+    int fd = open(file, O_RDONLY);
+    if (fd < 0)
+        return FALSE;
+#if defined(__APPLE__)
+    struct stat sb;
+    bool_t ok = fstat(fd, &sb) == 0;
+    if (ok) {
+        struct radvisory advice = {.ra_offset = 0,
+                                   .ra_count = (int)sb.st_size};
+        ok = fcntl(fd, F_RDADVISE, &advice) != -1;
+    }
+#else
+    bool_t ok = posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0;
+#endif
+    close(fd);
+    return ok;
+}
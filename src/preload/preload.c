@@ -0,0 +1,425 @@
+#include "preload.h"
+#include "../config/config.h"
+#include "../crt.h"
+#include "../util/hash.h"
+#include "../util/logging.h"
+#include "../util/lz4.h"
+#include "../util/thread.h"
+#include "shared_cache.h"
+
+#if _WIN32
+#define NAME_EQUAL(a, b) (strcmpi(a, b) == 0)
+#else
+#define NAME_EQUAL(a, b) (strcmp(a, b) == 0)
+#endif
+
+// Managed assemblies usually compress 3-4x; entries that don't fit into the
+// arena fall back to their own heap allocation
+#define LZ4_ARENA_RATIO 4
+#define ARENA_ALIGN 16
+
+typedef struct {
+    // Full path to the file to read
+    char_t *path;
+    // File name without the .lz4 extension; NULL for the target assembly
+    char_t *name;
+    FileStamp stamp;
+    void *data;
+    size_t size;
+    bool_t compressed;
+    // Whether data is an individual heap allocation rather than a slice of
+    // the arena or of the shared cache
+    bool_t heap;
+    bool_t shared;
+} PreloadEntry;
+
+typedef struct {
+    PreloadEntry *entries;
+    size_t count;
+    size_t capacity;
+    volatile size_t next_job;
+
+    unsigned char *arena;
+    size_t arena_capacity;
+    volatile size_t arena_used;
+
+    unsigned int shared_key;
+    SharedCache *shared_cache;
+
+    thread_t workers[PRELOAD_MAX_WORKERS];
+    size_t worker_count;
+    size_t pending;
+    bool_t started;
+    // Set with a release store once the entries can be read
+    volatile size_t finished;
+    // Held by the caller of preload_wait that joins the workers
+    volatile long wait_lock;
+} Preload;
+
+static Preload preload;
+
+static bool_t is_lz4_name(char_t *path) {
+    size_t len = strlen(path);
+    size_t ext_len = STR_LEN(PRELOAD_LZ4_EXT) - 1;
+    return len > ext_len && NAME_EQUAL(path + len - ext_len, PRELOAD_LZ4_EXT);
+}
+
+static void *arena_alloc(size_t size) {
+    size_t aligned = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (!preload.arena)
+        return NULL;
+    // Only commit the reservation if it fits, so that a large entry falling
+    // back to the heap leaves the rest of the arena to the smaller ones
+    for (;;) {
+        size_t offset = atomic_load_size(&preload.arena_used);
+        if (aligned > preload.arena_capacity - offset)
+            return NULL;
+        if (atomic_compare_exchange_size(&preload.arena_used, offset,
+                                         offset + aligned))
+            return preload.arena + offset;
+    }
+}
+
+static void *read_file(char_t *path, size_t *size) {
+    void *file = fopen(path, "rb");
+    // fopen returns INVALID_HANDLE_VALUE on failure on Windows
+    if (!file || file == (void *)-1)
+        return NULL;
+
+    size_t file_size = get_file_size(file);
+    void *data = malloc(file_size ? file_size : 1);
+    size_t read = fread(data, 1, file_size, file);
+    fclose(file);
+
+    if (read != file_size) {
+        free(data);
+        return NULL;
+    }
+    *size = file_size;
+    return data;
+}
+
+/**
+ * @brief Decompress an LZ4 frame read from disk. The input buffer is always
+ * freed.
+ */
+static void *decompress(void *data, size_t *size, bool_t use_arena,
+                        bool_t *heap) {
+    bool_t exact;
+    size_t bound = lz4_frame_decoded_bound(data, *size, &exact);
+    if (!bound) {
+        free(data);
+        return NULL;
+    }
+
+    // Without a content size the bound assumes that every block is full
+    // (4 MiB with the lz4 CLI defaults), so only exact sizes are reserved in
+    // the arena up front
+    bool_t in_arena = TRUE;
+    void *result = use_arena && exact ? arena_alloc(bound) : NULL;
+    if (!result) {
+        result = malloc(bound);
+        in_arena = FALSE;
+    }
+
+    size_t decoded = lz4_decompress_frame(data, *size, result, bound);
+    free(data);
+    if (!decoded) {
+        if (!in_arena)
+            free(result);
+        return NULL;
+    }
+
+    // Move the decoded data to the arena or trim it to its real length
+    if (!in_arena && decoded < bound) {
+        void *slice = use_arena ? arena_alloc(decoded) : NULL;
+        if (slice) {
+            memcpy(slice, result, decoded);
+            free(result);
+            result = slice;
+            in_arena = TRUE;
+        } else {
+            void *trimmed = realloc(result, decoded);
+            if (trimmed)
+                result = trimmed;
+        }
+    }
+
+    *size = decoded;
+    *heap = !in_arena;
+    return result;
+}
+
+void *read_assembly_file(char_t *path, size_t *size) {
+    void *data = read_file(path, size);
+    if (!data || !lz4_is_frame(data, *size))
+        return data;
+    bool_t heap;
+    return decompress(data, size, FALSE, &heap);
+}
+
+static void load_entry(PreloadEntry *entry) {
+    // Already served from the shared cache
+    if (entry->data)
+        return;
+
+    size_t size = 0;
+    bool_t heap = TRUE;
+    void *data = read_file(entry->path, &size);
+    if (!data)
+        return;
+
+    if (lz4_is_frame(data, size)) {
+        entry->compressed = TRUE;
+        data = decompress(data, &size, TRUE, &heap);
+        if (!data)
+            return;
+    }
+
+    entry->size = size;
+    entry->heap = heap;
+    entry->data = data;
+}
+
+static void preload_worker(void *arg) {
+    (void)arg;
+    for (;;) {
+        size_t job = atomic_fetch_add_size(&preload.next_job, 1);
+        if (job >= preload.count)
+            break;
+        load_entry(&preload.entries[job]);
+    }
+}
+
+static void add_entry(char_t *path, char_t *name) {
+    if (preload.count >= preload.capacity) {
+        preload.capacity = preload.capacity ? preload.capacity * 2 : 16;
+        preload.entries = realloc(preload.entries,
+                                  preload.capacity * sizeof(PreloadEntry));
+    }
+
+    PreloadEntry *entry = &preload.entries[preload.count++];
+    memset(entry, 0, sizeof(PreloadEntry));
+    entry->path = path;
+    entry->name = name;
+
+    get_file_stamp(path, &entry->stamp);
+}
+
+static void add_dir_entry(char_t *dir, char_t *name, void *user_data) {
+    size_t strip_len = *(size_t *)user_data;
+    size_t dir_len = strlen(dir);
+    size_t name_len = strlen(name);
+
+    char_t *path = calloc(dir_len + name_len + 2, sizeof(char_t));
+    strcat(path, dir);
+    strcat(path, TEXT("/"));
+    strcat(path, name);
+
+    size_t stripped_len = name_len - strip_len;
+    char_t *stripped = calloc(stripped_len + 1, sizeof(char_t));
+    memcpy(stripped, name, stripped_len * sizeof(char_t));
+
+    add_entry(path, stripped);
+}
+
+static void scan_search_dir(char_t *dir) {
+    size_t lz4_ext_len = STR_LEN(PRELOAD_LZ4_EXT) - 1;
+    list_files(dir, PRELOAD_LZ4_EXT, add_dir_entry, &lz4_ext_len);
+
+    // Plain assemblies are only worth reading ahead when they can be shared
+    // with other instances
+    if (config.mono_shared_cache) {
+        size_t no_strip = 0;
+        list_files(dir, PRELOAD_DLL_EXT, add_dir_entry, &no_strip);
+    }
+}
+
+static void open_shared_cache(char_t *search_dirs) {
+    unsigned int key = FNV1A_OFFSET_BASIS;
+    if (config.target_assembly)
+        key = hash_fnv1a(config.target_assembly,
+                         strlen(config.target_assembly) * sizeof(char_t), key);
+    if (search_dirs)
+        key = hash_fnv1a(search_dirs, strlen(search_dirs) * sizeof(char_t),
+                         key);
+    preload.shared_key = key;
+    preload.shared_cache = shared_cache_open(key);
+
+    for (size_t i = 0; i < preload.count; i++) {
+        PreloadEntry *entry = &preload.entries[i];
+        entry->data = shared_cache_find(preload.shared_cache, entry->path,
+                                        &entry->stamp, &entry->size);
+        entry->shared = entry->data != NULL;
+    }
+}
+
+/**
+ * @brief Publish freshly read assemblies to the shared cache and switch all
+ * entries over to the shared pages, releasing the private copies.
+ */
+static void publish_shared_cache() {
+    size_t count = 0;
+    bool_t fresh = FALSE;
+    SharedCacheEntry *published =
+        calloc(preload.count ? preload.count : 1, sizeof(SharedCacheEntry));
+    for (size_t i = 0; i < preload.count; i++) {
+        PreloadEntry *entry = &preload.entries[i];
+        if (!entry->data)
+            continue;
+        fresh |= !entry->shared;
+        published[count].path = entry->path;
+        published[count].stamp = entry->stamp;
+        published[count].data = entry->data;
+        published[count].size = entry->size;
+        count++;
+    }
+
+    if (!fresh || !shared_cache_publish(preload.shared_key, published, count)) {
+        free(published);
+        return;
+    }
+    free(published);
+
+    SharedCache *cache = shared_cache_open(preload.shared_key);
+    if (!cache)
+        return;
+
+    for (size_t i = 0; i < preload.count; i++) {
+        PreloadEntry *entry = &preload.entries[i];
+        size_t size = 0;
+        void *data =
+            shared_cache_find(cache, entry->path, &entry->stamp, &size);
+        if (!data || entry->shared)
+            continue;
+        if (entry->heap)
+            free(entry->data);
+        entry->data = data;
+        entry->size = size;
+        entry->heap = FALSE;
+        entry->shared = TRUE;
+    }
+
+    // Every arena slice now lives in the shared segment instead
+    bool_t arena_in_use = FALSE;
+    for (size_t i = 0; i < preload.count; i++)
+        arena_in_use |= preload.entries[i].data && !preload.entries[i].shared &&
+                        !preload.entries[i].heap;
+    if (!arena_in_use && preload.arena) {
+        free(preload.arena);
+        preload.arena = NULL;
+    }
+    preload.shared_cache = cache;
+}
+
+void preload_start(char_t *search_dirs) {
+    if (preload.started)
+        return;
+    preload.started = TRUE;
+
+    if (config.target_assembly)
+        add_entry(strdup(config.target_assembly), NULL);
+
+    if (search_dirs) {
+        size_t len = strlen(search_dirs);
+        char_t *dirs = strdup(search_dirs);
+        size_t start = 0;
+        for (size_t i = 0; i <= len; i++) {
+            if (dirs[i] != *PATH_SEP && dirs[i] != 0)
+                continue;
+            dirs[i] = 0;
+            if (i > start)
+                scan_search_dir(dirs + start);
+            start = i + 1;
+        }
+        free(dirs);
+    }
+
+    if (config.mono_shared_cache)
+        open_shared_cache(search_dirs);
+
+    size_t pending = 0;
+    for (size_t i = 0; i < preload.count; i++) {
+        PreloadEntry *entry = &preload.entries[i];
+        if (entry->data)
+            continue;
+        pending++;
+        if (entry->name && is_lz4_name(entry->path))
+            preload.arena_capacity +=
+                (size_t)entry->stamp.size * LZ4_ARENA_RATIO;
+    }
+    if (preload.arena_capacity)
+        preload.arena = malloc(preload.arena_capacity);
+
+    preload.pending = pending;
+    preload.worker_count =
+        pending < PRELOAD_MAX_WORKERS ? pending : PRELOAD_MAX_WORKERS;
+    for (size_t i = 0; i < preload.worker_count; i++)
+        preload.workers[i] = thread_start(preload_worker, NULL);
+}
+
+void preload_wait() {
+    if (!preload.started || atomic_load_size(&preload.finished))
+        return;
+
+    // Mono can open images from several threads, and only one of them may
+    // join the workers
+    spin_lock(&preload.wait_lock);
+    if (atomic_load_size(&preload.finished)) {
+        spin_unlock(&preload.wait_lock);
+        return;
+    }
+
+    // Logged here rather than in preload_start so that it shows up in order
+    // with the rest of the runtime startup
+    LOG("Preloading %lu assemblies on %lu workers (arena: %lu bytes, %lu "
+        "from shared cache)",
+        (unsigned long)preload.pending, (unsigned long)preload.worker_count,
+        (unsigned long)preload.arena_capacity,
+        (unsigned long)(preload.count - preload.pending));
+
+    for (size_t i = 0; i < preload.worker_count; i++)
+        thread_join(preload.workers[i]);
+    // Pick up any jobs left over by workers that failed to start
+    preload_worker(NULL);
+
+    if (config.mono_shared_cache)
+        publish_shared_cache();
+
+#if VERBOSE
+    for (size_t i = 0; i < preload.count; i++) {
+        PreloadEntry *entry = &preload.entries[i];
+        LOG("Preloaded %s: %lu bytes%s%s", entry->path,
+            (unsigned long)entry->size,
+            entry->compressed ? TEXT(" (LZ4)") : TEXT(""),
+            entry->shared ? TEXT(" (shared)") : TEXT(""));
+    }
+#endif
+
+    atomic_store_size(&preload.finished, 1);
+    spin_unlock(&preload.wait_lock);
+}
+
+void *preload_get(char_t *path, size_t *size) {
+    preload_wait();
+    for (size_t i = 0; i < preload.count; i++) {
+        PreloadEntry *entry = &preload.entries[i];
+        if (!entry->name && entry->data && NAME_EQUAL(entry->path, path)) {
+            *size = entry->size;
+            return entry->data;
+        }
+    }
+    return NULL;
+}
+
+void *preload_get_by_name(char_t *name, size_t *size) {
+    preload_wait();
+    for (size_t i = 0; i < preload.count; i++) {
+        PreloadEntry *entry = &preload.entries[i];
+        if (entry->name && entry->data && NAME_EQUAL(entry->name, name)) {
+            *size = entry->size;
+            return entry->data;
+        }
+    }
+    return NULL;
+}
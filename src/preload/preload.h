@@ -0,0 +1,82 @@
+#ifndef PRELOAD_H
+#define PRELOAD_H
+
+#include "../util/util.h"
+
+/**
+ * @brief Extension of LZ4-compressed assemblies in the DLL search paths.
+ */
+#define PRELOAD_LZ4_EXT TEXT(".lz4")
+
+/**
+ * @brief Extension of plain assemblies in the DLL search paths.
+ */
+#define PRELOAD_DLL_EXT TEXT(".dll")
+
+/**
+ * @brief Maximum number of worker threads used to read assemblies.
+ */
+#define PRELOAD_MAX_WORKERS 4
+
+/**
+ * @brief Start reading assemblies in the background.
+ *
+ * @remark Safe to call from the warm-up thread (see warmup_start).
+ *
+ * Queues the target assembly and every LZ4-compressed assembly (`*.lz4`) found
+ * in the given search folders and reads them on a small worker pool.
+ * Compressed entries are decompressed into a single arena that lives for the
+ * rest of the process, so the buffers can be handed to mono without copying.
+ *
+ * If the shared cache is enabled, plain assemblies in the search folders are
+ * queued too. Entries already published by another instance are mapped from
+ * the shared segment instead of being read, and the rest is published once
+ * all workers finish.
+ *
+ * @param search_dirs Folders to scan for compressed assemblies, separated by
+ *                    PATH_SEP. May be NULL.
+ */
+void preload_start(char_t *search_dirs);
+
+/**
+ * @brief Wait for all preload workers to finish.
+ */
+void preload_wait();
+
+/**
+ * @brief Get a preloaded assembly by its full path.
+ *
+ * @remark The returned buffer lives until the process exits and must not be
+ * freed.
+ *
+ * @param path Full path to the assembly.
+ * @param size Variable which will receive the size of the assembly.
+ * @return void* Assembly data, or NULL if the assembly was not preloaded.
+ */
+void *preload_get(char_t *path, size_t *size);
+
+/**
+ * @brief Get a preloaded assembly from the search folders by its file name.
+ *
+ * @remark The returned buffer lives until the process exits and must not be
+ * freed.
+ *
+ * @param name File name of the assembly (e.g. `mscorlib.dll`).
+ * @param size Variable which will receive the size of the assembly.
+ * @return void* Assembly data, or NULL if there is no such compressed
+ *               assembly.
+ */
+void *preload_get_by_name(char_t *name, size_t *size);
+
+/**
+ * @brief Read an assembly, decompressing it if it is an LZ4 frame.
+ *
+ * @remark Return value must be freed by caller.
+ *
+ * @param path Path to the assembly.
+ * @param size Variable which will receive the size of the assembly.
+ * @return void* Assembly data, or NULL if the file could not be read.
+ */
+void *read_assembly_file(char_t *path, size_t *size);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef SHARED_CACHE_H
+#define SHARED_CACHE_H
+
+#include "../util/util.h"
+
+/**
+ * @brief Assembly stored in the shared cache.
+ */
+typedef struct {
+    /**
+     * @brief Full path to the source file of the assembly.
+     */
+    char_t *path;
+
+    /**
+     * @brief Size and modification time of the source file, used to
+     * invalidate stale entries.
+     */
+    FileStamp stamp;
+
+    /**
+     * @brief Contents of the assembly (decompressed if needed).
+     */
+    void *data;
+    size_t size;
+} SharedCacheEntry;
+
+/**
+ * @brief Read-only mapping of a shared cache segment.
+ */
+typedef struct SharedCache SharedCache;
+
+/**
+ * @brief Map the shared cache segment published by another Doorstop instance.
+ *
+ * @remark The mapping is kept for the lifetime of the process since slices of
+ * it are handed to the runtime.
+ *
+ * @param key Hash identifying the set of assemblies (see preload_start).
+ * @return SharedCache* The mapped segment, or NULL if there is no valid one.
+ */
+SharedCache *shared_cache_open(unsigned int key);
+
+/**
+ * @brief Find an assembly in the shared cache.
+ *
+ * @param cache Mapped segment. NULL is allowed.
+ * @param path Full path to the source file of the assembly.
+ * @param stamp Current stamp of the source file. The entry is ignored if the
+ *              file changed since it was published.
+ * @param size Variable which will receive the size of the assembly.
+ * @return void* Read-only slice of the segment, or NULL if not found.
+ */
+void *shared_cache_find(SharedCache *cache, char_t *path,
+                        const FileStamp *stamp, size_t *size);
+
+/**
+ * @brief Publish the assemblies into a new shared cache segment, atomically
+ * replacing any previous segment with the same key.
+ *
+ * @param key Hash identifying the set of assemblies.
+ * @param entries Assemblies to publish.
+ * @param count Number of assemblies.
+ * @return bool_t TRUE if the segment was published.
+ */
+bool_t shared_cache_publish(unsigned int key, SharedCacheEntry *entries,
+                            size_t count);
+
+#endif
@@ -0,0 +1,226 @@
+#include "warmup.h"
+#include "../config/config.h"
+#include "../crt.h"
+#include "../util/logging.h"
+#include "../util/thread.h"
+#include "preload.h"
+
+#if _WIN32
+#define NAME_EQUAL(a, b) (strcmpi(a, b) == 0)
+#else
+#define NAME_EQUAL(a, b) (strcmp(a, b) == 0)
+#endif
+
+// The warm-up thread doesn't log; its results are logged from warmup_wait so
+// that they show up in order with the rest of the runtime startup.
+typedef struct {
+    char_t *override_dirs;
+    size_t ignored_dirs;
+
+    // Names of files in config.mono_dll_search_path_override
+    char_t **override_names;
+    size_t override_count;
+    size_t override_capacity;
+    bool_t override_indexed;
+
+    size_t prefetched;
+
+    // TRUSTED_PLATFORM_ASSEMBLIES built from config.clr_corlib_dir
+    char_t *tpa;
+    size_t tpa_len;
+    size_t tpa_capacity;
+    size_t tpa_count;
+
+    thread_t thread;
+    bool_t started;
+    // Set with a release store once the results above can be read
+    volatile size_t finished;
+    // Held by the caller of warmup_wait that joins the thread
+    volatile long wait_lock;
+} Warmup;
+
+static Warmup warmup;
+
+/**
+ * @brief Resolve the PATH_SEP separated override folders to absolute paths.
+ */
+static char_t *resolve_override_dirs(char_t *value) {
+    size_t path_start = 0;
+    char_t *result = calloc(MAX_PATH, sizeof(char_t));
+    memset(result, 0, MAX_PATH * sizeof(char_t));
+
+    bool_t found_path = FALSE;
+    for (size_t i = 0; i <= strlen(value); i++) {
+        char_t current_char = value[i];
+        if (current_char == *PATH_SEP || current_char == 0) {
+            if (i <= path_start) {
+                path_start++;
+                continue;
+            }
+
+            size_t path_len = i - path_start;
+            char_t *path = calloc(path_len + 1, sizeof(char_t));
+            strncpy(path, value + path_start, path_len);
+            path[path_len] = 0;
+
+            char_t *full_path = get_full_path(path);
+
+            if (strlen(result) + strlen(full_path) + 2 > MAX_PATH) {
+                warmup.ignored_dirs++;
+                free(path);
+                free(full_path);
+                path_start = i + 1;
+                continue;
+            }
+
+            if (found_path) {
+                strcat(result, PATH_SEP);
+            }
+
+            strcat(result, full_path);
+
+            free(path);
+            free(full_path);
+
+            found_path = TRUE;
+            path_start = i + 1;
+        }
+    }
+
+    return result;
+}
+
+static void add_override_name(char_t *dir, char_t *name, void *user_data) {
+    (void)dir;
+    (void)user_data;
+    if (warmup.override_count >= warmup.override_capacity) {
+        warmup.override_capacity =
+            warmup.override_capacity ? warmup.override_capacity * 2 : 64;
+        warmup.override_names =
+            realloc(warmup.override_names,
+                    warmup.override_capacity * sizeof(char_t *));
+    }
+    warmup.override_names[warmup.override_count++] = strdup(name);
+}
+
+static void append_tpa(char_t *path) {
+    size_t path_len = strlen(path);
+    size_t needed = warmup.tpa_len + path_len + 2;
+    if (needed > warmup.tpa_capacity) {
+        size_t capacity = warmup.tpa_capacity ? warmup.tpa_capacity : 4096;
+        while (capacity < needed)
+            capacity *= 2;
+        char_t *tpa = calloc(capacity, sizeof(char_t));
+        if (warmup.tpa) {
+            memcpy(tpa, warmup.tpa, warmup.tpa_len * sizeof(char_t));
+            free(warmup.tpa);
+        }
+        warmup.tpa = tpa;
+        warmup.tpa_capacity = capacity;
+    }
+
+    if (warmup.tpa_count++)
+        strcat(warmup.tpa + warmup.tpa_len++, PATH_SEP);
+    strcat(warmup.tpa + warmup.tpa_len, path);
+    warmup.tpa_len += path_len;
+}
+
+static void corlib_visitor(char_t *dir, char_t *name, void *user_data) {
+    (void)user_data;
+    char_t *path = calloc(strlen(dir) + strlen(name) + 2, sizeof(char_t));
+    strcat(path, dir);
+    // CoreCLR finds the simple name of TPA entries by the native separator
+    strcat(path, DIR_SEP);
+    strcat(path, name);
+    if (prefetch_file(path))
+        warmup.prefetched++;
+    append_tpa(path);
+    free(path);
+}
+
+static void warmup_run(void *arg) {
+    (void)arg;
+    char_t *override_value = config.mono_dll_search_path_override;
+    if (override_value && strlen(override_value)) {
+        warmup.override_dirs = resolve_override_dirs(override_value);
+
+        // The image open hook looks assemblies up in the raw override path,
+        // so index exactly that folder
+        list_files(override_value, TEXT(""), add_override_name, NULL);
+        warmup.override_indexed = TRUE;
+    }
+
+    preload_start(warmup.override_dirs);
+
+    if (config.clr_runtime_coreclr_path && config.clr_corlib_dir &&
+        folder_exists(config.clr_corlib_dir)) {
+        if (prefetch_file(config.clr_runtime_coreclr_path))
+            warmup.prefetched++;
+        list_files(config.clr_corlib_dir, TEXT(".dll"), corlib_visitor, NULL);
+    }
+}
+
+void warmup_start() {
+    if (warmup.started)
+        return;
+    warmup.started = TRUE;
+    warmup.thread = thread_start(warmup_run, NULL);
+    if (!warmup.thread)
+        warmup_run(NULL);
+}
+
+void warmup_wait() {
+    if (atomic_load_size(&warmup.finished))
+        return;
+
+    // Mono can open images from several threads, and only one of them may
+    // join the thread
+    spin_lock(&warmup.wait_lock);
+    if (atomic_load_size(&warmup.finished)) {
+        spin_unlock(&warmup.wait_lock);
+        return;
+    }
+
+    if (!warmup.started) {
+        warmup.started = TRUE;
+        warmup_run(NULL);
+    } else if (warmup.thread) {
+        thread_join(warmup.thread);
+    }
+
+    if (warmup.ignored_dirs)
+        LOG("Ignored %lu override paths because their absolute version is "
+            "too long",
+            (unsigned long)warmup.ignored_dirs);
+    if (warmup.override_indexed)
+        LOG("Indexed %lu assemblies in the override folder",
+            (unsigned long)warmup.override_count);
+    LOG("Prefetched %lu CoreCLR files", (unsigned long)warmup.prefetched);
+    if (warmup.tpa_count)
+        LOG("Found %lu trusted platform assemblies",
+            (unsigned long)warmup.tpa_count);
+
+    atomic_store_size(&warmup.finished, 1);
+    spin_unlock(&warmup.wait_lock);
+}
+
+char_t *warmup_override_dirs() {
+    warmup_wait();
+    return warmup.override_dirs;
+}
+
+char_t *warmup_trusted_assemblies() {
+    warmup_wait();
+    return warmup.tpa;
+}
+
+bool_t warmup_has_override(char_t *name) {
+    warmup_wait();
+    if (!warmup.override_indexed)
+        return TRUE;
+    for (size_t i = 0; i < warmup.override_count; i++) {
+        if (NAME_EQUAL(warmup.override_names[i], name))
+            return TRUE;
+    }
+    return FALSE;
+}
@@ -0,0 +1,55 @@
+#ifndef WARMUP_H
+#define WARMUP_H
+
+#include "../util/util.h"
+
+/**
+ * @brief Start the warm-up thread.
+ *
+ * Called as soon as Doorstop is loaded, long before the runtime is
+ * initialized. The thread resolves the DLL search path override, indexes the
+ * override folder, starts preloading the target assembly (see preload_start),
+ * asks the OS to prefetch the CoreCLR runtime and core libraries and builds
+ * the CoreCLR trusted platform assembly list.
+ */
+void warmup_start();
+
+/**
+ * @brief Wait for the warm-up thread to finish.
+ *
+ * If the thread was never started, the warm-up is done on the calling thread
+ * instead.
+ */
+void warmup_wait();
+
+/**
+ * @brief Get the resolved DLL search path override.
+ *
+ * @remark The returned value is owned by the warm-up and must not be freed.
+ *
+ * @return char_t* Absolute override folders separated by PATH_SEP, or NULL if
+ *                 no override is set.
+ */
+char_t *warmup_override_dirs();
+
+/**
+ * @brief Get the CoreCLR trusted platform assemblies.
+ *
+ * @remark The returned value is owned by the warm-up and must not be freed.
+ *
+ * @return char_t* Full paths of all assemblies in config.clr_corlib_dir
+ *                 separated by PATH_SEP, or NULL if the folder is not set or
+ *                 empty.
+ */
+char_t *warmup_trusted_assemblies();
+
+/**
+ * @brief Check whether the override folder contains the given assembly.
+ *
+ * @param name File name of the assembly (e.g. `mscorlib.dll`).
+ * @return bool_t FALSE if the assembly is known to be missing from the
+ *                override folder, otherwise TRUE.
+ */
+bool_t warmup_has_override(char_t *name);
+
+#endif
@@ -3,11 +3,43 @@ DEF_CALL(int, init, const char *domain_name)
 DEF_CALL(void *, runtime_invoke, void *method, void *obj, void **params,
          void **exec)
 DEF_CALL(const char *, method_get_name, void *method)
+DEF_CALL(void *, method_get_class, void *method)
+DEF_CALL(const char *, class_get_name, void *klass)
+DEF_CALL(const char *, class_get_namespace, void *klass)
+DEF_CALL(void, shutdown)
+DEF_CALL(void, set_memory_callbacks, Il2CppMemoryCallbacks *callbacks)
+
+DEF_CALL(void, gc_set_mode, Il2CppGCMode mode)
+DEF_CALL(int, gc_is_disabled)
+DEF_CALL(int, gc_is_incremental)
+DEF_CALL(long long, gc_get_max_time_slice_ns)
+DEF_CALL(void, gc_set_max_time_slice_ns, long long max_time_slice)
+DEF_CALL(void, gc_start_incremental_collection)
+DEF_CALL(long long, gc_get_heap_size)
+DEF_CALL(long long, gc_get_used_size)
 #else
 
 #ifndef IL2CPP_H
 #define IL2CPP_H
 
+#include <stddef.h>
+
+typedef struct {
+    void *(*malloc_func)(size_t size);
+    void *(*aligned_malloc_func)(size_t size, size_t alignment);
+    void (*free_func)(void *ptr);
+    void (*aligned_free_func)(void *ptr);
+    void *(*calloc_func)(size_t nmemb, size_t size);
+    void *(*realloc_func)(void *ptr, size_t size);
+    void *(*aligned_realloc_func)(void *ptr, size_t size, size_t alignment);
+} Il2CppMemoryCallbacks;
+
+typedef enum {
+    IL2CPP_GC_MODE_DISABLED = 0,
+    IL2CPP_GC_MODE_ENABLED = 1,
+    IL2CPP_GC_MODE_MANUAL = 2
+} Il2CppGCMode;
+
 #define IMPORT_PREFIX il2cpp
 #if _WIN32
 #define IMPORT_CONV __cdecl
@@ -14,6 +14,8 @@ DEF_CALL(void *, method_desc_search_in_image, void *desc, void *image)
 DEF_CALL(void, method_desc_free, void *desc)
 DEF_CALL(void *, method_signature, void *method)
 DEF_CALL(unsigned int, signature_get_param_count, void *sig)
+DEF_CALL(void *, get_method, void *image, unsigned int token, void *klass)
+DEF_CALL(unsigned int, method_get_token, void *method)
 
 DEF_CALL(void, domain_set_config, void *domain, char *base_dir,
          char *config_file_name)
@@ -38,6 +40,13 @@ DEF_CALL(void *, jit_parse_options, int argc, char **argv)
 DEF_CALL(void *, debug_init, MonoDebugFormat format)
 DEF_CALL(void *, debug_domain_create, void *domain)
 DEF_CALL(int, debug_enabled)
+DEF_CALL(void, enable_jit_map)
+DEF_CALL(void, jit_cleanup, void *domain)
+
+DEF_CALL(const char *, method_get_name, void *method)
+DEF_CALL(void *, method_get_class, void *method)
+DEF_CALL(const char *, class_get_name, void *klass)
+DEF_CALL(const char *, class_get_namespace, void *klass)
 #else
 
 #ifndef MONO_H
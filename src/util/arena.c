@@ -0,0 +1,119 @@
+#include "arena.h"
+#include "../crt.h"
+#include "logging.h"
+#include <stdarg.h>
+
+#define ARENA_ALIGN 16
+#define ALIGN_UP(size) (((size) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+struct ArenaBlock {
+    ArenaBlock *next;
+    size_t size;
+    size_t used;
+};
+
+// Allocations start after the header, at an aligned offset
+#define BLOCK_HEADER ALIGN_UP(sizeof(ArenaBlock))
+
+void *arena_alloc(Arena *arena, size_t size) {
+    size = ALIGN_UP(size ? size : 1);
+
+    ArenaBlock *block = arena->blocks;
+    if (!block || block->size - block->used < size) {
+        size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        block = malloc(BLOCK_HEADER + block_size);
+        if (!block)
+            return NULL;
+        block->size = block_size;
+        block->used = 0;
+        // Keep filling the current block after a large allocation
+        if (arena->blocks && size > ARENA_BLOCK_SIZE) {
+            block->next = arena->blocks->next;
+            arena->blocks->next = block;
+        } else {
+            block->next = arena->blocks;
+            arena->blocks = block;
+        }
+        arena->block_count++;
+    }
+
+    void *result = (char *)block + BLOCK_HEADER + block->used;
+    block->used += size;
+    arena->allocs++;
+    arena->bytes += size;
+    memset(result, 0, size);
+    return result;
+}
+
+char_t *arena_strdup(Arena *arena, const char_t *str) {
+    size_t len = strlen(str);
+    char_t *result = arena_alloc(arena, (len + 1) * sizeof(char_t));
+    if (result)
+        memcpy(result, str, len * sizeof(char_t));
+    return result;
+}
+
+char_t *arena_concat(Arena *arena, const char_t *first, ...) {
+    va_list args;
+    size_t len = 0;
+    va_start(args, first);
+    for (const char_t *str = first; str; str = va_arg(args, const char_t *))
+        len += strlen(str);
+    va_end(args);
+
+    char_t *result = arena_alloc(arena, (len + 1) * sizeof(char_t));
+    if (!result)
+        return NULL;
+    char_t *end = result;
+    va_start(args, first);
+    for (const char_t *str = first; str; str = va_arg(args, const char_t *)) {
+        size_t str_len = strlen(str);
+        memcpy(end, str, str_len * sizeof(char_t));
+        end += str_len;
+    }
+    va_end(args);
+    return result;
+}
+
+char *arena_narrow(Arena *arena, const char_t *str) {
+#ifdef UNICODE
+    int size = WideCharToMultiByte(CP_UTF8, 0, str, -1, NULL, 0, NULL, NULL);
+    char *result = arena_alloc(arena, size);
+    if (result)
+        WideCharToMultiByte(CP_UTF8, 0, str, -1, result, size, NULL, NULL);
+    return result;
+#else
+    (void)arena;
+    return (char *)str;
+#endif
+}
+
+char_t *arena_widen(Arena *arena, const char *str) {
+#ifdef UNICODE
+    int size = MultiByteToWideChar(CP_UTF8, 0, str, -1, NULL, 0);
+    char_t *result = arena_alloc(arena, size * sizeof(char_t));
+    if (result)
+        MultiByteToWideChar(CP_UTF8, 0, str, -1, result, size);
+    return result;
+#else
+    (void)arena;
+    return (char_t *)str;
+#endif
+}
+
+void arena_reset(Arena *arena, const char_t *name) {
+    LOG_DEBUG("Arena %s: %lu allocations, %lu bytes in %lu blocks freed at "
+              "once",
+              name, (unsigned long)arena->allocs,
+              (unsigned long)arena->bytes,
+              (unsigned long)arena->block_count);
+    (void)name;
+
+    ArenaBlock *block = arena->blocks;
+    while (block) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    memset(arena, 0, sizeof(*arena));
+}
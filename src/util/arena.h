@@ -0,0 +1,93 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "util.h"
+
+/**
+ * @brief Size of the blocks an arena carves allocations from. Larger
+ * allocations get a block of their own.
+ */
+#define ARENA_BLOCK_SIZE 8192
+
+typedef struct ArenaBlock ArenaBlock;
+
+/**
+ * @brief Bump-pointer allocator for short-lived allocations.
+ *
+ * Allocations are never freed one by one: arena_reset frees all of them at
+ * once. Not thread-safe, so each thread needs its own arena. Zero-initialize
+ * to create an empty arena.
+ */
+typedef struct {
+    ArenaBlock *blocks;
+    size_t allocs;
+    size_t bytes;
+    size_t block_count;
+} Arena;
+
+/**
+ * @brief Allocate zeroed memory from an arena.
+ *
+ * @param arena Arena to allocate from.
+ * @param size Size of the allocation in bytes.
+ * @return void* Memory aligned for any type, or NULL if out of memory.
+ */
+void *arena_alloc(Arena *arena, size_t size);
+
+/**
+ * @brief Copy a string into an arena.
+ */
+char_t *arena_strdup(Arena *arena, const char_t *str);
+
+/**
+ * @brief Concatenate strings into an arena.
+ *
+ * @param arena Arena to allocate from.
+ * @param first First string.
+ * @param ... More strings, followed by NULL.
+ * @return char_t* Concatenated string, or NULL if out of memory.
+ */
+char_t *arena_concat(Arena *arena, const char_t *first, ...);
+
+/**
+ * @brief Convert a universal string to UTF-8 in an arena.
+ *
+ * @remark Where no conversion is needed, str itself is returned. The result
+ * must not be modified or used after str is freed.
+ */
+char *arena_narrow(Arena *arena, const char_t *str);
+
+/**
+ * @brief Convert a UTF-8 string to a universal string in an arena.
+ *
+ * @remark Where no conversion is needed, str itself is returned. The result
+ * must not be modified or used after str is freed.
+ */
+char_t *arena_widen(Arena *arena, const char *str);
+
+/**
+ * @brief Get the path of the executable, like program_path, in an arena.
+ */
+char_t *arena_program_path(Arena *arena);
+
+/**
+ * @brief Get the folder of a path, like get_folder_name, in an arena.
+ */
+char_t *arena_folder_name(Arena *arena, const char_t *path);
+
+/**
+ * @brief Get the file name of a path, like get_file_name, in an arena.
+ */
+char_t *arena_file_name(Arena *arena, const char_t *path, bool_t with_ext);
+
+/**
+ * @brief Free every allocation of an arena at once.
+ *
+ * The counters are logged and cleared, and the arena can be used again.
+ *
+ * @param arena Arena to reset.
+ * @param name Name of the arena in the log.
+ */
+void arena_reset(Arena *arena, const char_t *name);
+
+#endif
@@ -0,0 +1,81 @@
+#include "args.h"
+#include "../crt.h"
+
+// crt string functions operate on char_t, which is wide on Windows
+static bool_t arg_equal(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static bool_t is_space(char_t c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void args_init(ArgList *args, int argc, char **argv) {
+    args->argc = argc;
+    args->borrowed = argc;
+    args->argv = calloc(argc + 1, sizeof(char *));
+    if (argc)
+        memcpy(args->argv, argv, argc * sizeof(char *));
+}
+
+bool_t args_add(ArgList *args, const char *arg) {
+    for (int i = 0; i < args->argc; i++) {
+        if (arg_equal(args->argv[i], arg))
+            return FALSE;
+    }
+
+    size_t len = 0;
+    while (arg[len])
+        len++;
+    char *copy = calloc(len + 1, sizeof(char));
+    memcpy(copy, arg, len);
+
+    // Keep the array NULL-terminated like a regular argv
+    args->argv = realloc(args->argv, (args->argc + 2) * sizeof(char *));
+    args->argv[args->argc++] = copy;
+    args->argv[args->argc] = NULL;
+    return TRUE;
+}
+
+int args_add_list(ArgList *args, const char_t *options) {
+    if (!options)
+        return 0;
+
+    int added = 0;
+    const char_t *start = options;
+    while (*start) {
+        while (is_space(*start))
+            start++;
+        if (!*start)
+            break;
+
+        size_t len = 0;
+        while (start[len] && !is_space(start[len]))
+            len++;
+
+        char_t *option = calloc(len + 1, sizeof(char_t));
+        strncpy(option, start, len);
+        option[len] = 0;
+        char *option_n = narrow(option);
+        if (args_add(args, option_n))
+            added++;
+        free(option_n);
+        free(option);
+
+        start += len;
+    }
+    return added;
+}
+
+void args_free(ArgList *args) {
+    for (int i = args->borrowed; i < args->argc; i++)
+        free(args->argv[i]);
+    free(args->argv);
+    args->argv = NULL;
+    args->argc = 0;
+    args->borrowed = 0;
+}
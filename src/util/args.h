@@ -0,0 +1,56 @@
+#ifndef ARGS_H
+#define ARGS_H
+
+#include "util.h"
+
+/**
+ * @brief Command line arguments passed to a runtime.
+ *
+ * The first `borrowed` arguments are owned by the caller of args_init; the
+ * rest were added with args_add and are freed by args_free.
+ */
+typedef struct {
+    int argc;
+    char **argv;
+    int borrowed;
+} ArgList;
+
+/**
+ * @brief Start an argument list from existing arguments.
+ *
+ * @param args Argument list to initialize.
+ * @param argc Number of existing arguments.
+ * @param argv Existing arguments. They are not copied and must outlive the
+ *             list. May be NULL if argc is 0.
+ */
+void args_init(ArgList *args, int argc, char **argv);
+
+/**
+ * @brief Append a copy of an argument to the list.
+ *
+ * @param args Argument list.
+ * @param arg UTF-8 argument to append.
+ * @return bool_t FALSE if the exact same argument is already in the list, in
+ *                which case it is not added again.
+ */
+bool_t args_add(ArgList *args, const char *arg);
+
+/**
+ * @brief Append whitespace separated options to the list.
+ *
+ * Options already in the list are skipped (see args_add).
+ *
+ * @param args Argument list.
+ * @param options Options to append (e.g. `--optimize=inline,simd --llvm`).
+ * @return int Number of options that were appended.
+ */
+int args_add_list(ArgList *args, const char_t *options);
+
+/**
+ * @brief Free the argument array and the arguments added to it.
+ *
+ * @param args Argument list.
+ */
+void args_free(ArgList *args);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stddef.h>
+
+// Minimal formatting into caller-provided buffers; there is no sprintf
+// without the CRT on Windows. Each function returns the end of the written
+// text and does not NUL-terminate it.
+
+static inline char *format_str(char *p, const char *str) {
+    while (*str)
+        *p++ = *str++;
+    return p;
+}
+
+static inline char *format_u64(char *p, unsigned long long value) {
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (count)
+        *p++ = digits[--count];
+    return p;
+}
+
+static inline char *format_hex(char *p, size_t value) {
+    p = format_str(p, "0x");
+    for (int shift = sizeof(size_t) * 8 - 4; shift >= 0; shift -= 4)
+        *p++ = "0123456789abcdef"[(value >> shift) & 0xF];
+    return p;
+}
+
+#endif
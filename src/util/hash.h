@@ -0,0 +1,29 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+
+#define FNV1A_OFFSET_BASIS 0x811C9DC5u
+#define FNV1A_PRIME 0x01000193u
+
+/**
+ * @brief Compute the 32-bit FNV-1a hash of a buffer.
+ *
+ * @param data Data to hash.
+ * @param size Size of the data in bytes.
+ * @param seed Previous hash value to chain multiple buffers, or
+ *             FNV1A_OFFSET_BASIS to start a new hash.
+ * @return unsigned int Hash of the data.
+ */
+static inline unsigned int hash_fnv1a(const void *data, size_t size,
+                                      unsigned int seed) {
+    const unsigned char *p = data;
+    unsigned int hash = seed;
+    while (size--) {
+        hash ^= *p++;
+        hash *= FNV1A_PRIME;
+    }
+    return hash;
+}
+
+#endif
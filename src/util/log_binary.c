@@ -0,0 +1,243 @@
+#include "log_binary.h"
+#include "../crt.h"
+#include "log_ring.h"
+#include "thread.h"
+#include "util.h"
+#include <stdarg.h>
+
+#if VERBOSE && BINARY_LOG
+
+#define LOG_SITE_REGISTERING ((size_t)-1)
+
+// How each argument is read from the va_list
+enum {
+    ARG_INT,
+    ARG_UINT,
+    ARG_LONG,
+    ARG_ULONG,
+    ARG_LLONG,
+    ARG_ULLONG,
+    ARG_SIZE,
+    ARG_POINTER,
+    ARG_DOUBLE,
+    ARG_STRING,
+    // %S, which is a narrow string in wsprintfW
+    ARG_NARROW_STRING,
+};
+
+static volatile size_t next_site_id = 0;
+
+static unsigned char integer_arg(const LogSpec *spec, bool_t is_signed) {
+    const char *length = spec->length;
+    if (!spec->length_size || length[0] == 'h')
+        return is_signed ? ARG_INT : ARG_UINT;
+    if (spec->length_size == 1 && length[0] == 'l')
+        return is_signed ? ARG_LONG : ARG_ULONG;
+    if (length[0] == 'z' || length[0] == 't' ||
+        (spec->length_size == 1 && length[0] == 'I'))
+        return ARG_SIZE;
+    return is_signed ? ARG_LLONG : ARG_ULLONG;
+}
+
+static void parse_args(LogSite *site, const char *format) {
+    site->arg_count = 0;
+    for (const char *p = format; *p && site->arg_count < LOG_BINARY_MAX_ARGS;) {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+
+        LogSpec spec;
+        log_spec_parse(p, &spec);
+        p = spec.end;
+        unsigned char arg;
+        switch (spec.conversion) {
+        case '%':
+            continue;
+        case 'd':
+        case 'i':
+        case 'c':
+            arg = integer_arg(&spec, TRUE);
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            arg = integer_arg(&spec, FALSE);
+            break;
+        case 'p':
+            arg = ARG_POINTER;
+            break;
+        case 's':
+            arg = ARG_STRING;
+            break;
+        case 'S':
+#if _WIN32
+            arg = ARG_NARROW_STRING;
+#else
+            // A wide string, which is recorded as its address
+            arg = ARG_POINTER;
+#endif
+            break;
+#if !_WIN32
+        // wsprintf has no floating point conversions
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+            arg = ARG_DOUBLE;
+            break;
+#endif
+        default:
+            // Arguments can't be read past an unknown conversion
+            return;
+        }
+        site->args[site->arg_count++] = arg;
+    }
+}
+
+static char *put_u32(char *p, unsigned int value) {
+    memcpy(p, &value, sizeof(value));
+    return p + sizeof(value);
+}
+
+static char *put_u64(char *p, char tag, unsigned long long value) {
+    *p++ = tag;
+    memcpy(p, &value, sizeof(value));
+    return p + sizeof(value);
+}
+
+static char *put_string(char *p, const char *str, size_t length) {
+    unsigned short size = (unsigned short)length;
+    *p++ = LOG_BINARY_STRING;
+    memcpy(p, &size, sizeof(size));
+    p += sizeof(size);
+    memcpy(p, str, length);
+    return p + length;
+}
+
+static char *put_narrow(char *p, const char *str) {
+    if (!str)
+        str = "(null)";
+    size_t length = 0;
+    while (str[length] && length < LOG_BINARY_MAX_STRING)
+        length++;
+    return put_string(p, str, length);
+}
+
+static char *put_char_t(char *p, const char_t *str) {
+#if _WIN32 && defined(UNICODE)
+    if (!str)
+        return put_narrow(p, NULL);
+    int length = 0;
+    while (str[length] && length < LOG_BINARY_MAX_STRING)
+        length++;
+    char text[LOG_BINARY_MAX_STRING];
+    int size = WideCharToMultiByte(CP_UTF8, 0, str, length, text,
+                                   sizeof(text), NULL, NULL);
+    // Truncate strings that don't fit to a length that always does
+    if (!size)
+        size = WideCharToMultiByte(CP_UTF8, 0, str, sizeof(text) / 3, text,
+                                   sizeof(text), NULL, NULL);
+    return put_string(p, text, size);
+#else
+    return put_narrow(p, (const char *)str);
+#endif
+}
+
+static bool_t register_site(LogSite *site, const char *format) {
+    for (;;) {
+        size_t id = atomic_load_size(&site->id);
+        if (id && id != LOG_SITE_REGISTERING)
+            return TRUE;
+        if (!id &&
+            atomic_compare_exchange_size(&site->id, 0, LOG_SITE_REGISTERING))
+            break;
+        // Another thread is registering the site
+        thread_sleep_ms(0);
+    }
+
+    parse_args(site, format);
+    size_t id = atomic_fetch_add_size(&next_site_id, 1) + 1;
+
+    char definition[LOG_RING_MESSAGE_SIZE];
+    char *p = put_u32(definition, (unsigned int)id | LOG_BINARY_DEFINITION);
+    while (*format && p < definition + sizeof(definition))
+        *p++ = *format++;
+
+    // Messages of a site can't be decoded without its definition
+    if (!log_ring_write(definition, p - definition)) {
+        atomic_store_size(&site->id, 0);
+        return FALSE;
+    }
+    atomic_store_size(&site->id, id);
+    return TRUE;
+}
+
+void log_binary_write(LogSite *site, const char *format, ...) {
+    size_t id = atomic_load_size(&site->id);
+    if ((!id || id == LOG_SITE_REGISTERING) && !register_site(site, format))
+        return;
+
+    // Largest argument: tag, length and string
+    const size_t max_arg = 3 + LOG_BINARY_MAX_STRING;
+    char record[LOG_RING_MESSAGE_SIZE];
+    char *p = put_u32(record, (unsigned int)atomic_load_size(&site->id));
+
+    va_list args;
+    va_start(args, format);
+    for (unsigned char i = 0; i < site->arg_count; i++) {
+        if (p + max_arg > record + sizeof(record))
+            break;
+
+        switch (site->args[i]) {
+        case ARG_INT:
+            p = put_u64(p, LOG_BINARY_INT, (long long)va_arg(args, int));
+            break;
+        case ARG_UINT:
+            p = put_u64(p, LOG_BINARY_UINT, va_arg(args, unsigned int));
+            break;
+        case ARG_LONG:
+            p = put_u64(p, LOG_BINARY_INT, (long long)va_arg(args, long));
+            break;
+        case ARG_ULONG:
+            p = put_u64(p, LOG_BINARY_UINT, va_arg(args, unsigned long));
+            break;
+        case ARG_LLONG:
+            p = put_u64(p, LOG_BINARY_INT, va_arg(args, long long));
+            break;
+        case ARG_ULLONG:
+            p = put_u64(p, LOG_BINARY_UINT, va_arg(args, unsigned long long));
+            break;
+        case ARG_SIZE:
+            p = put_u64(p, LOG_BINARY_UINT, va_arg(args, size_t));
+            break;
+        case ARG_POINTER:
+            p = put_u64(p, LOG_BINARY_POINTER,
+                        (size_t)va_arg(args, const void *));
+            break;
+#if !_WIN32
+        case ARG_DOUBLE: {
+            double value = va_arg(args, double);
+            unsigned long long bits;
+            memcpy(&bits, &value, sizeof(bits));
+            p = put_u64(p, LOG_BINARY_DOUBLE, bits);
+            break;
+        }
+#endif
+        case ARG_STRING:
+            p = put_char_t(p, va_arg(args, const char_t *));
+            break;
+        case ARG_NARROW_STRING:
+            p = put_narrow(p, va_arg(args, const char *));
+            break;
+        }
+    }
+    va_end(args);
+
+    log_ring_write(record, p - record);
+}
+
+#endif
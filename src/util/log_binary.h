@@ -0,0 +1,103 @@
+#ifndef LOG_BINARY_H
+#define LOG_BINARY_H
+
+#include <stddef.h>
+
+/*
+ * Binary log format, written by BINARY_LOG builds and rendered by
+ * tools/log_decoder.c. All integers are little-endian.
+ *
+ * The file starts with LOG_BINARY_MAGIC, followed by records:
+ *
+ *   u32 size       size of the payload
+ *   u64 time_us    time since the logger started
+ *   u64 thread_id
+ *   payload        starts with a u32 site ID
+ *
+ * A site ID with LOG_BINARY_DEFINITION set defines the format string of the
+ * site, which follows as text. Site 0 reports a u64 count of dropped
+ * messages. Any other site is a message whose arguments follow, each a tag
+ * byte and its value: LOG_BINARY_INT (i64), LOG_BINARY_UINT (u64),
+ * LOG_BINARY_DOUBLE (f64), LOG_BINARY_POINTER (u64) or LOG_BINARY_STRING (u16
+ * length and UTF-8 text).
+ */
+
+#define LOG_BINARY_MAGIC "DSBLOG1\n"
+#define LOG_BINARY_MAGIC_SIZE 8
+#define LOG_BINARY_HEADER_SIZE 20
+#define LOG_BINARY_DEFINITION 0x80000000u
+#define LOG_BINARY_DROPPED 0
+
+#define LOG_BINARY_INT 'i'
+#define LOG_BINARY_UINT 'u'
+#define LOG_BINARY_DOUBLE 'f'
+#define LOG_BINARY_POINTER 'p'
+#define LOG_BINARY_STRING 's'
+
+/**
+ * @brief Arguments recorded per message. Further arguments are left out.
+ */
+#define LOG_BINARY_MAX_ARGS 8
+
+/**
+ * @brief Longest string argument recorded, in bytes.
+ */
+#define LOG_BINARY_MAX_STRING 256
+
+/**
+ * @brief A conversion specification in a printf format string.
+ */
+typedef struct {
+    // Flags, width and precision, without the leading %
+    const char *flags;
+    size_t flags_length;
+    // Length modifier, such as l, ll or z
+    const char *length;
+    size_t length_size;
+    char conversion;
+    // Character after the specification
+    const char *end;
+} LogSpec;
+
+/**
+ * @brief Parse the conversion specification starting at `%`.
+ */
+static inline void log_spec_parse(const char *p, LogSpec *spec) {
+    p++;
+    spec->flags = p;
+    while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '.' ||
+           (*p >= '0' && *p <= '9'))
+        p++;
+    spec->flags_length = p - spec->flags;
+    spec->length = p;
+    while (*p == 'h' || *p == 'l' || *p == 'z' || *p == 'j' || *p == 't' ||
+           *p == 'L' || *p == 'I' || *p == '6' || *p == '4')
+        p++;
+    spec->length_size = p - spec->length;
+    spec->conversion = *p;
+    spec->end = *p ? p + 1 : p;
+}
+
+/**
+ * @brief A LOG call site. Zero-initialized; registered by its first message.
+ */
+typedef struct {
+    volatile size_t id;
+    unsigned char arg_count;
+    unsigned char args[LOG_BINARY_MAX_ARGS];
+} LogSite;
+
+/**
+ * @brief Queue a message without formatting it. Integers and pointers are
+ * copied as is and strings up to LOG_BINARY_MAX_STRING bytes.
+ *
+ * @param site Static site of the LOG call.
+ * @param format printf format string of the message. Must be a literal.
+ */
+void log_binary_write(LogSite *site, const char *format, ...)
+#if defined(__GNUC__) && !_WIN32
+    __attribute__((format(printf, 2, 3)))
+#endif
+    ;
+
+#endif
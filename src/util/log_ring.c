@@ -0,0 +1,252 @@
+#include "log_ring.h"
+#include "../crt.h"
+#include "format.h"
+#include "log_binary.h"
+#include "thread.h"
+
+#if VERBOSE
+
+#define LOG_RING_MASK ((size_t)LOG_RING_SLOTS - 1)
+#define LOG_BATCH_SIZE (64 * 1024)
+#define LOG_PREFIX_SIZE 32
+// Prefix, time, thread ID and newline, or the binary record header
+#define LOG_LINE_SIZE (LOG_RING_MESSAGE_SIZE + LOG_PREFIX_SIZE + 64)
+#define LOG_IDLE_SLEEP_MAX_MS 50
+
+/*
+ * Bounded queue with a sequence number per slot, so producers only contend on
+ * the tail index. The sequence is stored relative to the slot's first
+ * position, so that the zero-initialized ring is ready before log_ring_init:
+ * a slot is free for position `pos` when its sequence is `pos & ~MASK`,
+ * filled when it is one more, and free for the next lap after it is flushed.
+ */
+typedef struct {
+    volatile size_t sequence;
+    unsigned long long time_us;
+    unsigned long thread_id;
+    size_t length;
+    char message[LOG_RING_MESSAGE_SIZE];
+} LogSlot;
+
+static LogSlot slots[LOG_RING_SLOTS];
+static volatile size_t tail = 0;
+static volatile size_t dropped = 0;
+static volatile size_t stopped = 0;
+
+static log_sink_t log_sink = NULL;
+static char line_prefix[LOG_PREFIX_SIZE];
+static unsigned long long start_us = 0;
+static thread_t flusher = NULL;
+
+// Guards the consumer side: head, batch and calls to the sink
+static volatile long flush_lock = 0;
+static size_t head = 0;
+static char batch[LOG_BATCH_SIZE];
+
+#if BINARY_LOG
+static char *format_line(char *p, unsigned long long time_us,
+                         unsigned long thread_id, const char *message,
+                         size_t length) {
+    unsigned long long elapsed = time_us > start_us ? time_us - start_us : 0;
+    unsigned long long thread = thread_id;
+    unsigned int size = (unsigned int)length;
+    memcpy(p, &size, sizeof(size));
+    memcpy(p + 4, &elapsed, sizeof(elapsed));
+    memcpy(p + 12, &thread, sizeof(thread));
+    p += LOG_BINARY_HEADER_SIZE;
+    memcpy(p, message, length);
+    return p + length;
+}
+
+static char *format_dropped(char *p, size_t count) {
+    char note[12];
+    unsigned int site = LOG_BINARY_DROPPED;
+    unsigned long long lost = count;
+    memcpy(note, &site, sizeof(site));
+    memcpy(note + 4, &lost, sizeof(lost));
+    return format_line(p, monotonic_time_us(), thread_current_id(), note,
+                       sizeof(note));
+}
+#else
+static char *format_line(char *p, unsigned long long time_us,
+                         unsigned long thread_id, const char *message,
+                         size_t length) {
+    unsigned long long elapsed = time_us > start_us ? time_us - start_us : 0;
+    p = format_str(p, line_prefix);
+    *p++ = '[';
+    p = format_u64(p, elapsed / 1000);
+    *p++ = '.';
+    *p++ = (char)('0' + elapsed / 100 % 10);
+    *p++ = (char)('0' + elapsed / 10 % 10);
+    *p++ = (char)('0' + elapsed % 10);
+    p = format_str(p, " ms][");
+    p = format_u64(p, thread_id);
+    p = format_str(p, "] ");
+    memcpy(p, message, length);
+    p += length;
+    *p++ = '\n';
+    return p;
+}
+
+static char *format_dropped(char *p, size_t count) {
+    char note[64];
+    char *end = format_u64(note, count);
+    end = format_str(end, " messages dropped; the log ring was full");
+    return format_line(p, monotonic_time_us(), thread_current_id(), note,
+                       end - note);
+}
+#endif
+
+// Writes filled slots in order until an empty one; flush_lock must be held
+static bool_t flush_locked() {
+    char *p = batch;
+    bool_t flushed = FALSE;
+    for (;;) {
+        LogSlot *slot = &slots[head & LOG_RING_MASK];
+        size_t lap = head & ~LOG_RING_MASK;
+        if (atomic_load_size(&slot->sequence) != lap + 1)
+            break;
+
+        if (p - batch > LOG_BATCH_SIZE - LOG_LINE_SIZE) {
+            log_sink(batch, p - batch);
+            p = batch;
+        }
+        p = format_line(p, slot->time_us, slot->thread_id, slot->message,
+                        slot->length);
+        atomic_store_size(&slot->sequence, lap + LOG_RING_SLOTS);
+        head++;
+        flushed = TRUE;
+    }
+
+    size_t lost = atomic_load_size(&dropped);
+    if (lost) {
+        atomic_fetch_add_size(&dropped, (size_t)0 - lost);
+        if (p - batch > LOG_BATCH_SIZE - LOG_LINE_SIZE) {
+            log_sink(batch, p - batch);
+            p = batch;
+        }
+        p = format_dropped(p, lost);
+    }
+
+    if (p != batch)
+        log_sink(batch, p - batch);
+    return flushed;
+}
+
+static void flush_thread(void *arg) {
+    (void)arg;
+    unsigned long idle_ms = 1;
+    while (!atomic_load_size(&stopped)) {
+        spin_lock(&flush_lock);
+        bool_t flushed = flush_locked();
+        spin_unlock(&flush_lock);
+
+        // Back off while nothing is logged, which is most of the game's life
+        if (flushed) {
+            idle_ms = 1;
+        } else {
+            thread_sleep_ms(idle_ms);
+            if (idle_ms < LOG_IDLE_SLEEP_MAX_MS)
+                idle_ms *= 2;
+        }
+    }
+}
+
+bool_t log_ring_init(log_sink_t sink, const char *prefix) {
+    if (log_sink)
+        return TRUE;
+
+    size_t length = 0;
+    while (prefix[length] && length < LOG_PREFIX_SIZE - 1) {
+        line_prefix[length] = prefix[length];
+        length++;
+    }
+    line_prefix[length] = '\0';
+    start_us = monotonic_time_us();
+    log_sink = sink;
+#if BINARY_LOG
+    sink(LOG_BINARY_MAGIC, LOG_BINARY_MAGIC_SIZE);
+#endif
+
+    flusher = thread_start(flush_thread, NULL);
+    if (!flusher) {
+        atomic_store_size(&stopped, 1);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void write_sync(const char *message, size_t length) {
+    if (!log_sink)
+        return;
+
+    char line[LOG_LINE_SIZE];
+    char *end = format_line(line, monotonic_time_us(), thread_current_id(),
+                            message, length);
+    spin_lock(&flush_lock);
+    // Keep the order of messages queued just before the shutdown
+    flush_locked();
+    log_sink(line, end - line);
+    spin_unlock(&flush_lock);
+}
+
+bool_t log_ring_write(const char *message, size_t length) {
+    if (length > LOG_RING_MESSAGE_SIZE)
+        length = LOG_RING_MESSAGE_SIZE;
+    if (atomic_load_size(&stopped)) {
+        write_sync(message, length);
+        return TRUE;
+    }
+
+    LogSlot *slot;
+    size_t lap;
+    size_t pos = atomic_load_size(&tail);
+    for (;;) {
+        slot = &slots[pos & LOG_RING_MASK];
+        lap = pos & ~LOG_RING_MASK;
+        size_t sequence = atomic_load_size(&slot->sequence);
+        if (sequence == lap) {
+            if (atomic_compare_exchange_size(&tail, pos, pos + 1))
+                break;
+        } else if (sequence + LOG_RING_SLOTS == lap + 1) {
+            // The slot still holds a message from the previous lap
+            atomic_fetch_add_size(&dropped, 1);
+            return FALSE;
+        }
+        pos = atomic_load_size(&tail);
+    }
+
+    slot->time_us = monotonic_time_us();
+    slot->thread_id = thread_current_id();
+    slot->length = length;
+    memcpy(slot->message, message, length);
+    atomic_store_size(&slot->sequence, lap + 1);
+    return TRUE;
+}
+
+void log_ring_set_sink(log_sink_t sink) {
+    if (!log_sink)
+        return;
+
+    spin_lock(&flush_lock);
+    log_sink = sink;
+    spin_unlock(&flush_lock);
+}
+
+void log_ring_shutdown(bool_t terminating) {
+    if (!log_sink)
+        return;
+
+    atomic_store_size(&stopped, 1);
+    // The other threads were killed, possibly while the writer held the lock,
+    // and nothing else can take it anymore
+    if (terminating)
+        spin_unlock(&flush_lock);
+    spin_lock(&flush_lock);
+    flush_locked();
+    spin_unlock(&flush_lock);
+    // The thread exits on its own; joining it could deadlock on the loader
+    // lock on Windows
+}
+
+#endif
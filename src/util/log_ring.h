@@ -0,0 +1,72 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include "util.h"
+
+/**
+ * @brief Number of messages that can wait to be written. Messages logged
+ * while the ring is full are counted as dropped. Must be a power of two.
+ */
+#define LOG_RING_SLOTS 512
+
+/**
+ * @brief Longest message stored, in bytes. Longer messages are truncated.
+ */
+#define LOG_RING_MESSAGE_SIZE 1024
+
+/**
+ * @brief Write formatted log lines to the log output.
+ *
+ * @param data Lines to write, not NUL-terminated.
+ * @param size Size of the data in bytes.
+ */
+typedef void (*log_sink_t)(const char *data, size_t size);
+
+/**
+ * @brief Start the thread that writes logged messages.
+ *
+ * Messages logged before this are kept and written once it starts. In
+ * BINARY_LOG builds, the sink receives LOG_BINARY_MAGIC first and then
+ * binary records instead of lines.
+ *
+ * @param sink Writes batches of lines to the log output.
+ * @param prefix Text written at the start of every line. Unused in
+ *               BINARY_LOG builds.
+ * @return bool_t TRUE if messages are written in the background.
+ */
+bool_t log_ring_init(log_sink_t sink, const char *prefix);
+
+/**
+ * @brief Queue a message to be written with the time and thread it was logged
+ * from.
+ *
+ * Takes no locks and makes no system calls, so it can be called from hooks on
+ * any thread. After log_ring_shutdown, messages are written synchronously.
+ *
+ * @param message Message without a trailing newline, or a binary record
+ *                payload in BINARY_LOG builds.
+ * @param length Length of the message in bytes.
+ * @return bool_t FALSE if the message was dropped because the ring is full.
+ */
+bool_t log_ring_write(const char *message, size_t length);
+
+/**
+ * @brief Replace the sink once the writer is done with the previous one.
+ *
+ * @param sink Writes batches of lines to the log output.
+ */
+void log_ring_set_sink(log_sink_t sink);
+
+/**
+ * @brief Write every queued message and stop the writer thread.
+ *
+ * Doesn't wait for the thread, so it is safe to call while the loader lock
+ * is held.
+ *
+ * @param terminating TRUE if every other thread was already killed, as when
+ *                    the process exits on Windows; the writer may have died
+ *                    holding the lock.
+ */
+void log_ring_shutdown(bool_t terminating);
+
+#endif
@@ -0,0 +1,73 @@
+#include "logging.h"
+#include "../crt.h"
+
+#if VERBOSE
+unsigned char log_levels[LOG_CATEGORY_COUNT] = {
+    LOG_LEVEL_INFO, LOG_LEVEL_INFO, LOG_LEVEL_INFO,
+    LOG_LEVEL_INFO, LOG_LEVEL_INFO, LOG_LEVEL_INFO,
+};
+
+static const char *level_names[] = {"off",  "error", "warn",
+                                    "info", "debug", "trace"};
+
+static const char *category_names[LOG_CATEGORY_COUNT] = {
+    "general", "mapper", "hooks", "bootstrap", "config", "plthook"};
+
+// Compares a token of the filter to an ASCII name, ignoring case
+static bool_t token_equals(const char_t *token, size_t length,
+                           const char *name) {
+    for (size_t i = 0; i < length; i++) {
+        char_t c = token[i];
+        if (c >= 'A' && c <= 'Z')
+            c = c - 'A' + 'a';
+        if (!name[i] || c != (char_t)name[i])
+            return FALSE;
+    }
+    return name[length] == '\0';
+}
+
+static int find_name(const char_t *token, size_t length, const char **names,
+                     int count) {
+    for (int i = 0; i < count; i++) {
+        if (token_equals(token, length, names[i]))
+            return i;
+    }
+    return -1;
+}
+
+void log_configure(const char_t *filter) {
+    if (!filter)
+        return;
+
+    const char_t *entry = filter;
+    while (*entry) {
+        const char_t *end = entry;
+        const char_t *separator = NULL;
+        while (*end && *end != ',') {
+            if (*end == '=' && !separator)
+                separator = end;
+            end++;
+        }
+
+        const char_t *level_start = separator ? separator + 1 : entry;
+        int level = find_name(level_start, end - level_start, level_names,
+                              STR_LEN(level_names));
+        int category =
+            separator ? find_name(entry, separator - entry, category_names,
+                                  LOG_CATEGORY_COUNT)
+                      : -1;
+
+        if (level < 0 || (separator && category < 0)) {
+            LOG_AT(LOG_LEVEL_WARN, LOG_CAT_CONFIG,
+                   "Ignoring unknown log filter entry in %s", filter);
+        } else if (separator) {
+            log_levels[category] = (unsigned char)level;
+        } else {
+            for (int i = 0; i < LOG_CATEGORY_COUNT; i++)
+                log_levels[i] = (unsigned char)level;
+        }
+
+        entry = *end ? end + 1 : end;
+    }
+}
+#endif
@@ -1,6 +1,44 @@
 #ifndef LOGGING_H
 #define LOGGING_H
 
+#include "util.h"
+
+/*
+ * Log levels, from the most to the least severe. Messages are logged if their
+ * level is at most the level configured for their category.
+ */
+#define LOG_LEVEL_OFF 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+#define LOG_LEVEL_TRACE 5
+
+/*
+ * Log categories. A source file picks the category of its messages by
+ * defining LOG_CATEGORY before its first include; other files log to
+ * LOG_CAT_GENERAL.
+ */
+#define LOG_CAT_GENERAL 0
+#define LOG_CAT_MAPPER 1
+#define LOG_CAT_HOOKS 2
+#define LOG_CAT_BOOTSTRAP 3
+#define LOG_CAT_CONFIG 4
+#define LOG_CAT_PLTHOOK 5
+#define LOG_CATEGORY_COUNT 6
+
+#ifndef LOG_CATEGORY
+#define LOG_CATEGORY LOG_CAT_GENERAL
+#endif
+
+/**
+ * @brief Most verbose level compiled in. Calls to more verbose levels are
+ * removed at compile time.
+ */
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_TRACE
+#endif
+
 #if VERBOSE
 
 #if _WIN32
@@ -10,20 +48,93 @@
 #include "../nix/logger.h"
 #endif
 
+/**
+ * @brief Level of each category. Every category starts at LOG_LEVEL_INFO.
+ */
+extern unsigned char log_levels[LOG_CATEGORY_COUNT];
+
+/**
+ * @brief Check whether messages of a level and category are logged, without
+ * evaluating anything else.
+ */
+#define LOG_ENABLED(level, category)                                           \
+    ((level) <= LOG_MIN_LEVEL && (level) <= log_levels[category])
+
+/**
+ * @brief Log a message of a level and category. The arguments are only
+ * evaluated if the message is logged.
+ */
+#if !defined(_MSVC_TRADITIONAL) || _MSVC_TRADITIONAL
+#define LOG_AT(level, category, message, ...)                                  \
+    do {                                                                       \
+        if (LOG_ENABLED(level, category))                                      \
+            LOG_WRITE(message, ##__VA_ARGS__);                                 \
+    } while (0)
 #else
+#define LOG_AT(level, category, message, ...)                                  \
+    do {                                                                       \
+        if (LOG_ENABLED(level, category))                                      \
+            LOG_WRITE(message __VA_OPT__(, ) __VA_ARGS__);                     \
+    } while (0)
+#endif
 
 /**
- * @brief Log a message in verbose mode
+ * @brief Set the levels of the categories.
+ *
+ * The filter is a comma-separated list of entries. A level alone (`off`,
+ * `error`, `warn`, `info`, `debug` or `trace`) applies to every category;
+ * `category=level` applies to one category (`general`, `mapper`, `hooks`,
+ * `bootstrap`, `config` or `plthook`). Later entries override earlier ones,
+ * e.g. `off,mapper=debug` only logs the mapper.
+ *
+ * @param filter Filter to apply. NULL is ignored.
  */
-#define LOG(message, ...)
+void log_configure(const char_t *filter);
+
+#else
+
+#define LOG_ENABLED(level, category) 0
+#define LOG_AT(level, category, message, ...)                                  \
+    do {                                                                       \
+    } while (0)
 
 #define ASSERT_F(test, message, ...)
 #define ASSERT(test, message)
 #define ASSERT_SOFT(test, ...)
 
 static inline void init_logger() {}
-static inline void free_logger() {}
+static inline void free_logger(bool_t terminating) { (void)terminating; }
+static inline void log_configure(const char_t *filter) { (void)filter; }
 
 #endif
 
-#endif
\ No newline at end of file
+#if !defined(_MSVC_TRADITIONAL) || _MSVC_TRADITIONAL
+#define LOG_ERROR(message, ...)                                                \
+    LOG_AT(LOG_LEVEL_ERROR, LOG_CATEGORY, message, ##__VA_ARGS__)
+#define LOG_WARN(message, ...)                                                 \
+    LOG_AT(LOG_LEVEL_WARN, LOG_CATEGORY, message, ##__VA_ARGS__)
+#define LOG_INFO(message, ...)                                                 \
+    LOG_AT(LOG_LEVEL_INFO, LOG_CATEGORY, message, ##__VA_ARGS__)
+#define LOG_DEBUG(message, ...)                                                \
+    LOG_AT(LOG_LEVEL_DEBUG, LOG_CATEGORY, message, ##__VA_ARGS__)
+#define LOG_TRACE(message, ...)                                                \
+    LOG_AT(LOG_LEVEL_TRACE, LOG_CATEGORY, message, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(message, ...)                                                \
+    LOG_AT(LOG_LEVEL_ERROR, LOG_CATEGORY, message __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_WARN(message, ...)                                                 \
+    LOG_AT(LOG_LEVEL_WARN, LOG_CATEGORY, message __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_INFO(message, ...)                                                 \
+    LOG_AT(LOG_LEVEL_INFO, LOG_CATEGORY, message __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_DEBUG(message, ...)                                                \
+    LOG_AT(LOG_LEVEL_DEBUG, LOG_CATEGORY, message __VA_OPT__(, ) __VA_ARGS__)
+#define LOG_TRACE(message, ...)                                                \
+    LOG_AT(LOG_LEVEL_TRACE, LOG_CATEGORY, message __VA_OPT__(, ) __VA_ARGS__)
+#endif
+
+/**
+ * @brief Log an informational message in the category of the file.
+ */
+#define LOG LOG_INFO
+
+#endif
@@ -0,0 +1,281 @@
+#include "lz4.h"
+#include "../crt.h"
+
+#define LZ4_SKIPPABLE_MAGIC 0x184D2A50
+#define LZ4_SKIPPABLE_MASK 0xFFFFFFF0
+#define LZ4_MIN_MATCH 4
+
+#define FLG_VERSION_MASK 0xC0
+#define FLG_VERSION 0x40
+#define FLG_BLOCK_CHECKSUM 0x10
+#define FLG_CONTENT_SIZE 0x08
+#define FLG_CONTENT_CHECKSUM 0x04
+#define FLG_DICT_ID 0x01
+
+#define BLOCK_UNCOMPRESSED 0x80000000
+#define LZ4_BLOCK_ERROR ((size_t)-1)
+
+typedef struct {
+    const unsigned char *blocks;
+    size_t block_max;
+    size_t content_size;
+    bool_t has_content_size;
+    bool_t block_checksum;
+    bool_t content_checksum;
+} FrameHeader;
+
+static inline unsigned int read_le32(const unsigned char *p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+           ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+/**
+ * @brief Parse the frame descriptor at the start of the buffer.
+ *
+ * @return bool_t TRUE if the descriptor is valid and supported.
+ */
+static bool_t parse_frame_header(const unsigned char *ip,
+                                 const unsigned char *iend, FrameHeader *hdr) {
+    if (iend - ip < 7 || read_le32(ip) != LZ4_FRAME_MAGIC)
+        return FALSE;
+    ip += 4;
+
+    unsigned char flg = *ip++;
+    unsigned char bd = *ip++;
+    if ((flg & FLG_VERSION_MASK) != FLG_VERSION || (flg & FLG_DICT_ID))
+        return FALSE;
+
+    unsigned int block_max_id = (bd >> 4) & 0x7;
+    if (block_max_id < 4)
+        return FALSE;
+    hdr->block_max = (size_t)1 << (8 + 2 * block_max_id);
+    hdr->block_checksum = (flg & FLG_BLOCK_CHECKSUM) != 0;
+    hdr->content_checksum = (flg & FLG_CONTENT_CHECKSUM) != 0;
+    hdr->has_content_size = (flg & FLG_CONTENT_SIZE) != 0;
+    hdr->content_size = 0;
+
+    if (hdr->has_content_size) {
+        if (iend - ip < 9)
+            return FALSE;
+        unsigned int lo = read_le32(ip);
+        unsigned int hi = read_le32(ip + 4);
+#ifdef ENV64
+        hdr->content_size = (size_t)lo | ((size_t)hi << 32);
+#else
+        if (hi != 0)
+            return FALSE;
+        hdr->content_size = lo;
+#endif
+        ip += 8;
+    }
+
+    // Header checksum byte
+    ip++;
+    hdr->blocks = ip;
+    return TRUE;
+}
+
+/**
+ * @brief Skip a skippable frame if there is one at the start of the buffer.
+ *
+ * @return const unsigned char* Pointer past the skippable frame, the same
+ *                              pointer if there was none, or NULL if the frame
+ *                              is truncated.
+ */
+static const unsigned char *skip_skippable(const unsigned char *ip,
+                                           const unsigned char *iend) {
+    if (iend - ip < 8 ||
+        (read_le32(ip) & LZ4_SKIPPABLE_MASK) != LZ4_SKIPPABLE_MAGIC)
+        return ip;
+    size_t len = read_le32(ip + 4);
+    if ((size_t)(iend - ip) - 8 < len)
+        return NULL;
+    return ip + 8 + len;
+}
+
+static size_t decompress_block(const unsigned char *ip, size_t size,
+                               unsigned char *dst_start, unsigned char *op,
+                               unsigned char *oend) {
+    const unsigned char *iend = ip + size;
+    unsigned char *ostart = op;
+
+    while (ip < iend) {
+        unsigned int token = *ip++;
+
+        size_t lit_len = token >> 4;
+        if (lit_len == 15) {
+            unsigned char b;
+            do {
+                if (ip >= iend)
+                    return LZ4_BLOCK_ERROR;
+                b = *ip++;
+                lit_len += b;
+            } while (b == 255);
+        }
+
+        if ((size_t)(iend - ip) < lit_len || (size_t)(oend - op) < lit_len)
+            return LZ4_BLOCK_ERROR;
+        memcpy(op, ip, lit_len);
+        ip += lit_len;
+        op += lit_len;
+
+        // The last sequence of a block only contains literals
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return LZ4_BLOCK_ERROR;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst_start))
+            return LZ4_BLOCK_ERROR;
+
+        size_t match_len = token & 0xF;
+        if (match_len == 15) {
+            unsigned char b;
+            do {
+                if (ip >= iend)
+                    return LZ4_BLOCK_ERROR;
+                b = *ip++;
+                match_len += b;
+            } while (b == 255);
+        }
+        match_len += LZ4_MIN_MATCH;
+
+        if ((size_t)(oend - op) < match_len)
+            return LZ4_BLOCK_ERROR;
+
+        const unsigned char *match = op - offset;
+        if (offset >= match_len) {
+            memcpy(op, match, match_len);
+            op += match_len;
+        } else {
+            // Overlapping match repeats the last `offset` bytes
+            while (match_len--)
+                *op++ = *match++;
+        }
+    }
+
+    return op - ostart;
+}
+
+bool_t lz4_is_frame(const void *data, size_t size) {
+    return size >= 4 && read_le32(data) == LZ4_FRAME_MAGIC;
+}
+
+size_t lz4_frame_decoded_bound(const void *src, size_t src_size,
+                               bool_t *exact) {
+    const unsigned char *ip = src;
+    const unsigned char *iend = ip + src_size;
+    size_t bound = 0;
+    if (exact)
+        *exact = TRUE;
+
+    while (ip < iend) {
+        ip = skip_skippable(ip, iend);
+        if (!ip)
+            return 0;
+        if (ip == iend)
+            break;
+
+        FrameHeader hdr;
+        if (!parse_frame_header(ip, iend, &hdr))
+            return 0;
+        ip = hdr.blocks;
+
+        size_t frame_bound = 0;
+        for (;;) {
+            if (iend - ip < 4)
+                return 0;
+            unsigned int block_size = read_le32(ip);
+            ip += 4;
+            if (block_size == 0)
+                break;
+            block_size &= ~BLOCK_UNCOMPRESSED;
+            size_t skip = block_size + (hdr.block_checksum ? 4 : 0);
+            if ((size_t)(iend - ip) < skip)
+                return 0;
+            ip += skip;
+            frame_bound += hdr.block_max;
+        }
+        if (hdr.content_checksum) {
+            if (iend - ip < 4)
+                return 0;
+            ip += 4;
+        }
+
+        bound += hdr.has_content_size ? hdr.content_size : frame_bound;
+        if (exact && !hdr.has_content_size)
+            *exact = FALSE;
+    }
+
+    return bound;
+}
+
+size_t lz4_decompress_frame(const void *src, size_t src_size, void *dst,
+                            size_t dst_capacity) {
+    const unsigned char *ip = src;
+    const unsigned char *iend = ip + src_size;
+    unsigned char *op = dst;
+    unsigned char *oend = op + dst_capacity;
+
+    while (ip < iend) {
+        ip = skip_skippable(ip, iend);
+        if (!ip)
+            return 0;
+        if (ip == iend)
+            break;
+
+        FrameHeader hdr;
+        if (!parse_frame_header(ip, iend, &hdr))
+            return 0;
+        ip = hdr.blocks;
+
+        // Linked blocks may reference any previous data of the frame
+        unsigned char *frame_start = op;
+        for (;;) {
+            if (iend - ip < 4)
+                return 0;
+            unsigned int block_size = read_le32(ip);
+            ip += 4;
+            if (block_size == 0)
+                break;
+
+            bool_t uncompressed = (block_size & BLOCK_UNCOMPRESSED) != 0;
+            block_size &= ~BLOCK_UNCOMPRESSED;
+            if ((size_t)(iend - ip) < block_size)
+                return 0;
+
+            if (uncompressed) {
+                if ((size_t)(oend - op) < block_size)
+                    return 0;
+                memcpy(op, ip, block_size);
+                op += block_size;
+            } else {
+                size_t written =
+                    decompress_block(ip, block_size, frame_start, op, oend);
+                if (written == LZ4_BLOCK_ERROR)
+                    return 0;
+                op += written;
+            }
+            ip += block_size;
+
+            if (hdr.block_checksum) {
+                if (iend - ip < 4)
+                    return 0;
+                ip += 4;
+            }
+        }
+        if (hdr.content_checksum) {
+            if (iend - ip < 4)
+                return 0;
+            ip += 4;
+        }
+
+        if (hdr.has_content_size &&
+            (size_t)(op - frame_start) != hdr.content_size)
+            return 0;
+    }
+
+    return op - (unsigned char *)dst;
+}
@@ -0,0 +1,52 @@
+#ifndef LZ4_H
+#define LZ4_H
+
+#include "util.h"
+
+/**
+ * @brief Magic number that starts every LZ4 frame.
+ */
+#define LZ4_FRAME_MAGIC 0x184D2204
+
+/**
+ * @brief Check whether the buffer starts with an LZ4 frame.
+ *
+ * @param data Buffer to check.
+ * @param size Size of the buffer in bytes.
+ * @return bool_t TRUE if the buffer starts with an LZ4 frame header.
+ */
+bool_t lz4_is_frame(const void *data, size_t size);
+
+/**
+ * @brief Get the upper bound of the decompressed size of LZ4 frames.
+ *
+ * If the frames carry their content size, the exact size is returned.
+ * Otherwise the bound is computed from the number of blocks and the maximum
+ * block size declared in the frame header, without decompressing anything.
+ *
+ * @param src Buffer containing one or more LZ4 frames.
+ * @param src_size Size of the buffer in bytes.
+ * @param exact Optional variable which will receive whether every frame
+ *              carries its content size, i.e. whether the bound is exact.
+ * @return size_t Upper bound of the decompressed size, or 0 if the frames are
+ *                malformed.
+ */
+size_t lz4_frame_decoded_bound(const void *src, size_t src_size,
+                               bool_t *exact);
+
+/**
+ * @brief Decompress LZ4 frames into the given buffer.
+ *
+ * Both independent and linked blocks are supported. Block and content
+ * checksums are skipped, dictionary frames are rejected.
+ *
+ * @param src Buffer containing one or more LZ4 frames.
+ * @param src_size Size of the buffer in bytes.
+ * @param dst Buffer to decompress into.
+ * @param dst_capacity Size of the destination buffer in bytes.
+ * @return size_t Number of decompressed bytes, or 0 on error.
+ */
+size_t lz4_decompress_frame(const void *src, size_t src_size, void *dst,
+                            size_t dst_capacity);
+
+#endif
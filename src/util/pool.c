@@ -0,0 +1,434 @@
+#include "pool.h"
+#include "../crt.h"
+#include "logging.h"
+#include "thread.h"
+
+#ifdef ENV64
+#define POOL_RESERVE ((size_t)1 << 30)
+#else
+#define POOL_RESERVE ((size_t)256 << 20)
+#endif
+#define POOL_CHUNK_SHIFT 16
+#define POOL_CHUNK_SIZE ((size_t)1 << POOL_CHUNK_SHIFT)
+#define POOL_CHUNK_COUNT (POOL_RESERVE >> POOL_CHUNK_SHIFT)
+#define POOL_CLASS_COUNT 24
+#define POOL_CACHE_BYTES (32 * 1024)
+#define POOL_STATS_FLUSH 4096
+#define POOL_CACHE_LINE 64
+
+// Every class size is a multiple of 16, so all blocks are 16-byte aligned
+static const unsigned short class_sizes[POOL_CLASS_COUNT] = {
+    16,  32,  48,  64,  80,  96,   112,  128,  160,  192,  224,  256,
+    320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+};
+
+typedef struct FreeBlock {
+    struct FreeBlock *next;
+} FreeBlock;
+
+typedef struct {
+    volatile long lock;
+    FreeBlock *head;
+} CentralList;
+
+typedef struct {
+    FreeBlock *head[POOL_CLASS_COUNT];
+    unsigned int count[POOL_CLASS_COUNT];
+    PoolStats stats;
+    unsigned int ops;
+} ThreadCache;
+
+typedef struct {
+    char *base;
+    volatile size_t next_chunk;
+    // Thread-local slot holding the ThreadCache of each thread
+    tls_key_t cache_key;
+
+    // Size class of every chunk handed out so far
+    unsigned char chunk_class[POOL_CHUNK_COUNT];
+    // Size class of every 16-byte size step up to POOL_MAX_SIZE
+    unsigned char class_of[POOL_MAX_SIZE / 16 + 1];
+
+    // Keep the central lists on separate cache lines so that refilling one
+    // class doesn't contend with another
+    union {
+        CentralList list;
+        char padding[POOL_CACHE_LINE];
+    } central[POOL_CLASS_COUNT];
+
+    volatile PoolStats stats;
+} Pool;
+
+static Pool pool;
+
+static bool_t owns(void *ptr) {
+    return pool.base && (char *)ptr >= pool.base &&
+           (char *)ptr < pool.base + POOL_RESERVE;
+}
+
+static unsigned int class_of_block(void *ptr) {
+    return pool.chunk_class[((char *)ptr - pool.base) >> POOL_CHUNK_SHIFT];
+}
+
+static unsigned int cache_limit(unsigned int cls) {
+    unsigned int limit = POOL_CACHE_BYTES / class_sizes[cls];
+    return limit < 8 ? 8 : limit;
+}
+
+static unsigned int histogram_bucket(size_t size) {
+    unsigned int bucket = 0;
+    while (size && bucket < POOL_HISTOGRAM_BUCKETS - 1) {
+        size >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static void merge_stats(PoolStats *stats) {
+    atomic_fetch_add_size(&pool.stats.allocs, stats->allocs);
+    atomic_fetch_add_size(&pool.stats.frees, stats->frees);
+    atomic_fetch_add_size(&pool.stats.bytes, stats->bytes);
+    atomic_fetch_add_size(&pool.stats.system_allocs, stats->system_allocs);
+    for (size_t i = 0; i < POOL_HISTOGRAM_BUCKETS; i++) {
+        if (stats->histogram[i])
+            atomic_fetch_add_size(&pool.stats.histogram[i],
+                                  stats->histogram[i]);
+    }
+    memset(stats, 0, sizeof(PoolStats));
+}
+
+static void count_op(ThreadCache *cache, size_t size, bool_t alloc,
+                     bool_t system) {
+    PoolStats local = {0};
+    PoolStats *stats = cache ? &cache->stats : &local;
+    if (alloc) {
+        stats->allocs++;
+        stats->bytes += size;
+        stats->histogram[histogram_bucket(size)]++;
+        if (system)
+            stats->system_allocs++;
+    } else {
+        stats->frees++;
+    }
+
+    if (!cache) {
+        merge_stats(&local);
+    } else if (++cache->ops >= POOL_STATS_FLUSH) {
+        merge_stats(&cache->stats);
+        cache->ops = 0;
+    }
+}
+
+static void push_central(unsigned int cls, FreeBlock *head, FreeBlock *tail) {
+    CentralList *list = &pool.central[cls].list;
+    spin_lock(&list->lock);
+    tail->next = list->head;
+    list->head = head;
+    spin_unlock(&list->lock);
+}
+
+static bool_t new_chunk(unsigned int cls) {
+    size_t index = atomic_fetch_add_size(&pool.next_chunk, 1);
+    if (index >= POOL_CHUNK_COUNT)
+        return FALSE;
+
+    char *chunk = pool.base + index * POOL_CHUNK_SIZE;
+    if (!pool_sys_commit(chunk, POOL_CHUNK_SIZE))
+        return FALSE;
+    // Published to other threads by the release of the central list lock
+    pool.chunk_class[index] = (unsigned char)cls;
+
+    size_t size = class_sizes[cls];
+    size_t count = POOL_CHUNK_SIZE / size;
+    for (size_t i = 0; i + 1 < count; i++)
+        ((FreeBlock *)(chunk + i * size))->next =
+            (FreeBlock *)(chunk + (i + 1) * size);
+    push_central(cls, (FreeBlock *)chunk,
+                 (FreeBlock *)(chunk + (count - 1) * size));
+    return TRUE;
+}
+
+static bool_t refill(ThreadCache *cache, unsigned int cls) {
+    CentralList *list = &pool.central[cls].list;
+    unsigned int want = cache_limit(cls) / 2;
+
+    spin_lock(&list->lock);
+    while (!list->head) {
+        spin_unlock(&list->lock);
+        if (!new_chunk(cls))
+            return FALSE;
+        spin_lock(&list->lock);
+    }
+
+    FreeBlock *head = list->head;
+    FreeBlock *tail = head;
+    unsigned int taken = 1;
+    while (taken < want && tail->next) {
+        tail = tail->next;
+        taken++;
+    }
+    list->head = tail->next;
+    spin_unlock(&list->lock);
+
+    tail->next = cache->head[cls];
+    cache->head[cls] = head;
+    cache->count[cls] += taken;
+    return TRUE;
+}
+
+/**
+ * @brief Return all but `keep` blocks of a class to the central list.
+ */
+static void flush(ThreadCache *cache, unsigned int cls, unsigned int keep) {
+    if (cache->count[cls] <= keep)
+        return;
+
+    FreeBlock **link = &cache->head[cls];
+    for (unsigned int i = 0; i < keep; i++)
+        link = &(*link)->next;
+
+    FreeBlock *head = *link;
+    FreeBlock *tail = head;
+    while (tail->next)
+        tail = tail->next;
+    *link = NULL;
+    cache->count[cls] = keep;
+
+    push_central(cls, head, tail);
+}
+
+static void TLS_CALLBACK release_cache(void *value) {
+    ThreadCache *cache = value;
+    if (!cache)
+        return;
+    for (unsigned int cls = 0; cls < POOL_CLASS_COUNT; cls++)
+        flush(cache, cls, 0);
+    merge_stats(&cache->stats);
+    pool_sys_free(cache);
+}
+
+static ThreadCache *get_cache() {
+    ThreadCache *cache = tls_get(pool.cache_key);
+    if (cache)
+        return cache;
+
+    // The cache itself can't come from the pool
+    cache = pool_sys_malloc(sizeof(ThreadCache));
+    if (!cache)
+        return NULL;
+    memset(cache, 0, sizeof(ThreadCache));
+    tls_set(pool.cache_key, cache);
+    return cache;
+}
+
+/**
+ * @brief Allocate a block from the pool.
+ *
+ * @return void* The block, or NULL if the pool can't serve the size.
+ */
+static void *alloc_block(ThreadCache *cache, size_t size) {
+    if (!cache || size > POOL_MAX_SIZE)
+        return NULL;
+
+    unsigned int cls = pool.class_of[(size + 15) >> 4];
+    if (!cache->head[cls] && !refill(cache, cls))
+        return NULL;
+
+    FreeBlock *block = cache->head[cls];
+    cache->head[cls] = block->next;
+    cache->count[cls]--;
+    return block;
+}
+
+static void free_block(ThreadCache *cache, void *ptr) {
+    unsigned int cls = class_of_block(ptr);
+    FreeBlock *block = ptr;
+    if (!cache) {
+        push_central(cls, block, block);
+        return;
+    }
+
+    block->next = cache->head[cls];
+    cache->head[cls] = block;
+    if (++cache->count[cls] > cache_limit(cls))
+        flush(cache, cls, cache_limit(cls) / 2);
+}
+
+bool_t pool_init() {
+    if (pool.base)
+        return TRUE;
+
+    if (!tls_alloc(&pool.cache_key, release_cache))
+        return FALSE;
+    char *base = pool_sys_reserve(POOL_RESERVE);
+    if (!base)
+        return FALSE;
+
+    unsigned int cls = 0;
+    for (size_t step = 0; step < STR_LEN(pool.class_of); step++) {
+        while (class_sizes[cls] < step * 16)
+            cls++;
+        pool.class_of[step] = (unsigned char)cls;
+    }
+    pool.base = base;
+    return TRUE;
+}
+
+void *pool_malloc(size_t size) {
+    if (!size)
+        size = 1;
+    ThreadCache *cache = get_cache();
+    void *result = alloc_block(cache, size);
+    bool_t system = result == NULL;
+    if (system)
+        result = pool_sys_malloc(size);
+    if (result)
+        count_op(cache, size, TRUE, system);
+    return result;
+}
+
+void *pool_calloc(size_t count, size_t size) {
+    if (size && count > (size_t)-1 / size)
+        return NULL;
+    void *result = pool_malloc(count * size);
+    if (result)
+        memset(result, 0, count * size);
+    return result;
+}
+
+void *pool_realloc(void *ptr, size_t size) {
+    if (!ptr)
+        return pool_malloc(size);
+    if (!size) {
+        pool_free(ptr);
+        return NULL;
+    }
+
+    if (!owns(ptr)) {
+        void *result = pool_sys_realloc(ptr, size);
+        if (result) {
+            ThreadCache *cache = get_cache();
+            count_op(cache, 0, FALSE, FALSE);
+            count_op(cache, size, TRUE, TRUE);
+        }
+        return result;
+    }
+
+    size_t old_size = class_sizes[class_of_block(ptr)];
+    if (size <= old_size)
+        return ptr;
+
+    void *result = pool_malloc(size);
+    if (!result)
+        return NULL;
+    memcpy(result, ptr, old_size);
+    pool_free(ptr);
+    return result;
+}
+
+void pool_free(void *ptr) {
+    if (!ptr)
+        return;
+    ThreadCache *cache = get_cache();
+    count_op(cache, 0, FALSE, FALSE);
+    if (owns(ptr))
+        free_block(cache, ptr);
+    else
+        pool_sys_free(ptr);
+}
+
+void *pool_aligned_malloc(size_t size, size_t alignment) {
+    if (!size)
+        size = 1;
+    ThreadCache *cache = get_cache();
+    void *result = alignment <= 16 ? alloc_block(cache, size) : NULL;
+    bool_t system = result == NULL;
+    if (system)
+        result = pool_sys_aligned_malloc(size, alignment);
+    if (result)
+        count_op(cache, size, TRUE, system);
+    return result;
+}
+
+void *pool_aligned_realloc(void *ptr, size_t size, size_t alignment) {
+    if (!ptr)
+        return pool_aligned_malloc(size, alignment);
+    if (!size) {
+        pool_aligned_free(ptr);
+        return NULL;
+    }
+
+    if (!owns(ptr)) {
+        void *result = pool_sys_aligned_realloc(ptr, size, alignment);
+        if (result) {
+            ThreadCache *cache = get_cache();
+            count_op(cache, 0, FALSE, FALSE);
+            count_op(cache, size, TRUE, TRUE);
+        }
+        return result;
+    }
+
+    size_t old_size = class_sizes[class_of_block(ptr)];
+    if (size <= old_size && alignment <= 16)
+        return ptr;
+
+    void *result = pool_aligned_malloc(size, alignment);
+    if (!result)
+        return NULL;
+    memcpy(result, ptr, old_size < size ? old_size : size);
+    pool_free(ptr);
+    return result;
+}
+
+void pool_aligned_free(void *ptr) {
+    if (!ptr)
+        return;
+    ThreadCache *cache = get_cache();
+    count_op(cache, 0, FALSE, FALSE);
+    if (owns(ptr))
+        free_block(cache, ptr);
+    else
+        pool_sys_aligned_free(ptr);
+}
+
+bool_t pool_get_stats(PoolStats *stats) {
+    if (!pool.base)
+        return FALSE;
+    ThreadCache *cache = tls_get(pool.cache_key);
+    if (cache) {
+        merge_stats(&cache->stats);
+        cache->ops = 0;
+    }
+    memcpy(stats, (PoolStats *)&pool.stats, sizeof(PoolStats));
+    return TRUE;
+}
+
+void pool_log_stats() {
+#if VERBOSE
+    PoolStats stats;
+    if (!pool_get_stats(&stats))
+        return;
+
+    size_t chunks = pool.next_chunk < POOL_CHUNK_COUNT ? pool.next_chunk
+                                                       : POOL_CHUNK_COUNT;
+    // Blocks allocated before the pool was installed are only counted when
+    // they are freed, so the live count may be slightly negative
+    LOG("Pool: %lu allocations (%lu from the system allocator), %lu frees, "
+        "%ld live",
+        (unsigned long)stats.allocs, (unsigned long)stats.system_allocs,
+        (unsigned long)stats.frees, (long)(stats.allocs - stats.frees));
+    LOG("Pool: %lu KiB requested in total, %lu KiB committed to the pool",
+        (unsigned long)(stats.bytes / 1024),
+        (unsigned long)(chunks * POOL_CHUNK_SIZE / 1024));
+    for (unsigned int i = 0; i < POOL_HISTOGRAM_BUCKETS; i++) {
+        if (!stats.histogram[i])
+            continue;
+        if (i == POOL_HISTOGRAM_BUCKETS - 1)
+            LOG("Pool:   >= %lu bytes: %lu", 1UL << (i - 1),
+                (unsigned long)stats.histogram[i]);
+        else
+            LOG("Pool:   %lu-%lu bytes: %lu", i ? 1UL << (i - 1) : 0UL,
+                (1UL << i) - 1, (unsigned long)stats.histogram[i]);
+    }
+#endif
+}
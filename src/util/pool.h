@@ -0,0 +1,101 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include "util.h"
+
+/**
+ * @brief Largest allocation served from the pool. Larger allocations are
+ * passed to the system allocator.
+ */
+#define POOL_MAX_SIZE 2048
+
+/**
+ * @brief Number of buckets in the allocation size histogram. Bucket `i`
+ * counts allocations of `2^(i-1)` up to `2^i - 1` bytes; the last bucket
+ * counts everything larger.
+ */
+#define POOL_HISTOGRAM_BUCKETS 24
+
+/**
+ * @brief Allocation counters of the pool.
+ */
+typedef struct {
+    size_t allocs;
+    size_t frees;
+    size_t bytes;
+    size_t system_allocs;
+    size_t histogram[POOL_HISTOGRAM_BUCKETS];
+} PoolStats;
+
+/**
+ * @brief Initialize the pool allocator.
+ *
+ * Reserves the address space small allocations are carved from. Must be
+ * called once before any other pool function.
+ *
+ * @return bool_t TRUE if the pool is ready.
+ */
+bool_t pool_init();
+
+/**
+ * @brief Allocate memory.
+ *
+ * Allocations up to POOL_MAX_SIZE bytes are served from per-thread caches of
+ * fixed size classes; larger ones go to the system allocator.
+ */
+void *pool_malloc(size_t size);
+
+void *pool_calloc(size_t count, size_t size);
+
+void *pool_realloc(void *ptr, size_t size);
+
+/**
+ * @brief Free memory.
+ *
+ * Memory that doesn't belong to the pool is passed to the system allocator,
+ * so it is safe to free blocks allocated before the pool was installed.
+ */
+void pool_free(void *ptr);
+
+void *pool_aligned_malloc(size_t size, size_t alignment);
+
+void *pool_aligned_realloc(void *ptr, size_t size, size_t alignment);
+
+void pool_aligned_free(void *ptr);
+
+/**
+ * @brief Get the allocation counters.
+ *
+ * Counters are gathered per thread and merged periodically, so allocations
+ * made by other threads since their last merge may be missing.
+ *
+ * @param stats Variable which will receive the counters.
+ * @return bool_t FALSE if the pool was never initialized.
+ */
+bool_t pool_get_stats(PoolStats *stats);
+
+/**
+ * @brief Log the allocation counters.
+ */
+void pool_log_stats();
+
+// Implemented per platform
+
+/**
+ * @brief Reserve address space without committing memory.
+ */
+void *pool_sys_reserve(size_t size);
+
+/**
+ * @brief Commit memory in a range returned by pool_sys_reserve.
+ */
+bool_t pool_sys_commit(void *addr, size_t size);
+
+void *pool_sys_malloc(size_t size);
+void *pool_sys_realloc(void *ptr, size_t size);
+void pool_sys_free(void *ptr);
+void *pool_sys_aligned_malloc(size_t size, size_t alignment);
+void *pool_sys_aligned_realloc(void *ptr, size_t size, size_t alignment);
+void pool_sys_aligned_free(void *ptr);
+
+#endif
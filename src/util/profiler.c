@@ -0,0 +1,228 @@
+#include "profiler.h"
+#include "../crt.h"
+#include "format.h"
+#include "logging.h"
+#include "thread.h"
+
+#define PROFILER_TABLE_SIZE (1 << PROFILER_TABLE_BITS)
+#define PROFILER_MAX_PROBES 32
+#define PROFILER_NAME_SIZE 512
+
+typedef struct {
+    void *method;
+    unsigned long long calls;
+    unsigned long long ticks;
+} ProfileEntry;
+
+typedef struct ProfileTable {
+    struct ProfileTable *next;
+    unsigned long long dropped;
+    ProfileEntry entries[PROFILER_TABLE_SIZE];
+} ProfileTable;
+
+static bool_t profiling = FALSE;
+static bool_t dumped = FALSE;
+static char_t *report_path = NULL;
+static tls_key_t table_key;
+static unsigned long long start_ticks;
+static unsigned long long start_us;
+
+// Guards the list of tables and the dumped flag, never the tables themselves
+static volatile long tables_lock = 0;
+static ProfileTable *tables = NULL;
+
+bool_t profiler_init(const char_t *path) {
+    if (profiling)
+        return TRUE;
+    if (!tls_alloc(&table_key, NULL))
+        return FALSE;
+
+    report_path = strdup(path);
+    start_us = monotonic_time_us();
+    start_ticks = profiler_ticks();
+    profiling = TRUE;
+    return TRUE;
+}
+
+static ProfileTable *table_create() {
+    ProfileTable *table = calloc(1, sizeof(ProfileTable));
+    if (!table)
+        return NULL;
+    tls_set(table_key, table);
+
+    spin_lock(&tables_lock);
+    table->next = tables;
+    tables = table;
+    spin_unlock(&tables_lock);
+    return table;
+}
+
+static inline size_t table_index(void *method) {
+    // Fibonacci hashing; the low bits of method pointers are mostly zero
+    unsigned int key = (unsigned int)((size_t)method >> 3);
+    return (key * 2654435769u) >> (32 - PROFILER_TABLE_BITS);
+}
+
+void profiler_record(void *method, unsigned long long ticks) {
+    if (!profiling)
+        return;
+
+    ProfileTable *table = tls_get(table_key);
+    if (!table && !(table = table_create()))
+        return;
+
+    size_t index = table_index(method);
+    for (size_t probe = 0; probe < PROFILER_MAX_PROBES; probe++) {
+        ProfileEntry *entry =
+            &table->entries[(index + probe) & (PROFILER_TABLE_SIZE - 1)];
+        if (entry->method == method) {
+            entry->calls++;
+            entry->ticks += ticks;
+            return;
+        }
+        if (!entry->method) {
+            entry->calls = 1;
+            entry->ticks = ticks;
+            entry->method = method;
+            return;
+        }
+    }
+    table->dropped++;
+}
+
+static bool_t method_before(const ProfileEntry *a, const ProfileEntry *b) {
+    return (size_t)a->method < (size_t)b->method;
+}
+
+static bool_t ticks_before(const ProfileEntry *a, const ProfileEntry *b) {
+    return a->ticks > b->ticks;
+}
+
+// Shell sort; there is no qsort without the CRT on Windows
+static void sort_entries(ProfileEntry *entries, size_t count,
+                         bool_t (*before)(const ProfileEntry *,
+                                          const ProfileEntry *)) {
+    size_t gap = 1;
+    while (gap < count / 3)
+        gap = gap * 3 + 1;
+    for (; gap > 0; gap /= 3) {
+        for (size_t i = gap; i < count; i++) {
+            ProfileEntry entry = entries[i];
+            size_t j = i;
+            for (; j >= gap && before(&entry, &entries[j - gap]); j -= gap)
+                entries[j] = entries[j - gap];
+            entries[j] = entry;
+        }
+    }
+}
+
+static size_t snapshot(ProfileEntry **result, unsigned long long *dropped) {
+    size_t count = 0;
+    for (ProfileTable *table = tables; table; table = table->next) {
+        for (size_t i = 0; i < PROFILER_TABLE_SIZE; i++) {
+            if (table->entries[i].method)
+                count++;
+        }
+    }
+
+    *result = NULL;
+    *dropped = 0;
+    ProfileEntry *entries = calloc(count ? count : 1, sizeof(ProfileEntry));
+    if (!entries)
+        return 0;
+
+    size_t copied = 0;
+    for (ProfileTable *table = tables; table; table = table->next) {
+        for (size_t i = 0; i < PROFILER_TABLE_SIZE && copied < count; i++) {
+            if (table->entries[i].method)
+                entries[copied++] = table->entries[i];
+        }
+        *dropped += table->dropped;
+    }
+
+    // Merge the entries of methods called from several threads
+    sort_entries(entries, copied, method_before);
+    size_t merged = 0;
+    for (size_t i = 0; i < copied; i++) {
+        if (merged && entries[merged - 1].method == entries[i].method) {
+            entries[merged - 1].calls += entries[i].calls;
+            entries[merged - 1].ticks += entries[i].ticks;
+        } else {
+            entries[merged++] = entries[i];
+        }
+    }
+    sort_entries(entries, merged, ticks_before);
+
+    *result = entries;
+    return merged;
+}
+
+static unsigned long long ticks_to_ns(unsigned long long ticks,
+                                      unsigned long long ticks_per_ms) {
+    return ticks / ticks_per_ms * 1000000 +
+           ticks % ticks_per_ms * 1000000 / ticks_per_ms;
+}
+
+void profiler_dump(profiler_name_func_t name_func) {
+    if (!profiling)
+        return;
+
+    unsigned long long end_ticks = profiler_ticks();
+    unsigned long long end_us = monotonic_time_us();
+
+    spin_lock(&tables_lock);
+    if (dumped) {
+        spin_unlock(&tables_lock);
+        return;
+    }
+    dumped = TRUE;
+    ProfileEntry *entries;
+    unsigned long long dropped;
+    size_t count = snapshot(&entries, &dropped);
+    spin_unlock(&tables_lock);
+
+    unsigned long long ticks_per_ms = 1;
+    if (end_us > start_us)
+        ticks_per_ms = (end_ticks - start_ticks) * 1000 / (end_us - start_us);
+    if (!ticks_per_ms)
+        ticks_per_ms = 1;
+
+    void *file = fopen(report_path, "wb");
+    // fopen returns INVALID_HANDLE_VALUE on failure on Windows
+    if (!file || file == (void *)-1) {
+        LOG("Failed to write runtime_invoke profile to %s", report_path);
+        free(entries);
+        return;
+    }
+
+    char line[PROFILER_NAME_SIZE + 128];
+    char *p = format_str(line, "# runtime_invoke profile: ");
+    p = format_u64(p, count);
+    p = format_str(p, " methods, ");
+    p = format_u64(p, dropped);
+    p = format_str(p, " calls dropped\n# calls\ttotal_us\tavg_ns\tmethod\n");
+    fwrite(line, 1, p - line, file);
+
+    char name[PROFILER_NAME_SIZE];
+    for (size_t i = 0; i < count; i++) {
+        unsigned long long ns = ticks_to_ns(entries[i].ticks, ticks_per_ms);
+        p = format_u64(line, entries[i].calls);
+        *p++ = '\t';
+        p = format_u64(p, ns / 1000);
+        *p++ = '\t';
+        p = format_u64(p, ns / entries[i].calls);
+        *p++ = '\t';
+        name[0] = '\0';
+        if (name_func && name_func(entries[i].method, name, sizeof(name)))
+            p = format_str(p, name);
+        else
+            p = format_hex(p, (size_t)entries[i].method);
+        *p++ = '\n';
+        fwrite(line, 1, p - line, file);
+    }
+    fclose(file);
+
+    LOG("Wrote runtime_invoke profile of %lu methods to %s",
+        (unsigned long)count, report_path);
+    free(entries);
+}
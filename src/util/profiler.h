@@ -0,0 +1,78 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "util.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * @brief Number of methods each thread can record is `2^PROFILER_TABLE_BITS`.
+ * Calls to methods that don't fit are counted as dropped.
+ */
+#define PROFILER_TABLE_BITS 12
+
+/**
+ * @brief Write the name of a profiled method.
+ *
+ * @param method Method that was profiled.
+ * @param buffer Buffer which will receive the NUL-terminated UTF-8 name.
+ * @param size Size of the buffer.
+ * @return size_t Length of the name, or 0 if it is unknown.
+ */
+typedef size_t (*profiler_name_func_t)(void *method, char *buffer,
+                                       size_t size);
+
+/**
+ * @brief Start profiling.
+ *
+ * @param report_path Path of the report written by profiler_dump.
+ * @return bool_t TRUE if calls can be recorded.
+ */
+bool_t profiler_init(const char_t *report_path);
+
+/**
+ * @brief Read the cheapest monotonic tick counter of the CPU.
+ *
+ * Ticks are only converted to time when the report is written.
+ */
+static inline unsigned long long profiler_ticks() {
+#if (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))) ||          \
+    defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    unsigned long long ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return monotonic_time_us();
+#endif
+}
+
+/**
+ * @brief Record a call in the table of the calling thread.
+ *
+ * Each thread only writes its own table, so recording takes no locks.
+ *
+ * @param method Method that was called.
+ * @param ticks Ticks spent in the call, including nested calls.
+ */
+void profiler_record(void *method, unsigned long long ticks);
+
+/**
+ * @brief Write the report, sorted by total time. Only the first call writes
+ * it.
+ *
+ * Tables of other threads are read while they may still record calls, so
+ * their latest calls may be missing.
+ *
+ * @param name_func Resolves method names. Must only be passed while the
+ *                  runtime is alive; if NULL, methods are written as
+ *                  addresses.
+ */
+void profiler_dump(profiler_name_func_t name_func);
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef THREAD_H
+#define THREAD_H
+
+#include "util.h"
+
+/**
+ * @brief Opaque handle to a native thread.
+ */
+typedef void *thread_t;
+
+/**
+ * @brief Function executed by a thread started with thread_start.
+ */
+typedef void (*thread_func_t)(void *arg);
+
+/**
+ * @brief Start a new native thread.
+ *
+ * @param func Function to run on the new thread.
+ * @param arg Argument passed to the function.
+ * @return thread_t Handle to the thread, or NULL if it could not be started.
+ */
+thread_t thread_start(thread_func_t func, void *arg);
+
+/**
+ * @brief Wait for the thread to finish and release its handle.
+ *
+ * @param thread Thread to join. NULL is ignored.
+ */
+void thread_join(thread_t thread);
+
+/**
+ * @brief Get an identifier of the calling thread.
+ */
+unsigned long thread_current_id();
+
+/**
+ * @brief Suspend the calling thread.
+ *
+ * @param ms Time to sleep for, in milliseconds.
+ */
+void thread_sleep_ms(unsigned long ms);
+
+/**
+ * @brief Key of a thread-local slot.
+ */
+typedef unsigned long tls_key_t;
+
+#if _WIN32
+#define TLS_CALLBACK __stdcall
+#else
+#define TLS_CALLBACK
+#endif
+
+/**
+ * @brief Function called with the value of a thread-local slot when a thread
+ * exits, if the value isn't NULL. Must be declared with TLS_CALLBACK.
+ */
+typedef void(TLS_CALLBACK *tls_destructor_t)(void *value);
+
+/**
+ * @brief Allocate a thread-local slot. The slot is NULL on every thread until
+ * it is set.
+ *
+ * @param key Variable which will receive the key of the slot.
+ * @param destructor Function to release the value of the slot when a thread
+ *                   exits, or NULL.
+ * @return bool_t FALSE if no slot could be allocated.
+ */
+bool_t tls_alloc(tls_key_t *key, tls_destructor_t destructor);
+
+void *tls_get(tls_key_t key);
+
+void tls_set(tls_key_t key, void *value);
+
+#if _WIN32
+#include <windows.h>
+
+static inline size_t atomic_fetch_add_size(volatile size_t *target,
+                                           size_t value) {
+#ifdef _WIN64
+    return (size_t)InterlockedExchangeAdd64((volatile LONG64 *)target,
+                                            (LONG64)value);
+#else
+    return (size_t)InterlockedExchangeAdd((volatile LONG *)target,
+                                          (LONG)value);
+#endif
+}
+
+static inline size_t atomic_load_size(volatile size_t *target) {
+    return atomic_fetch_add_size(target, 0);
+}
+
+static inline void atomic_store_size(volatile size_t *target, size_t value) {
+#ifdef _WIN64
+    InterlockedExchange64((volatile LONG64 *)target, (LONG64)value);
+#else
+    InterlockedExchange((volatile LONG *)target, (LONG)value);
+#endif
+}
+
+static inline bool_t atomic_compare_exchange_size(volatile size_t *target,
+                                                  size_t expected,
+                                                  size_t desired) {
+#ifdef _WIN64
+    return InterlockedCompareExchange64((volatile LONG64 *)target,
+                                        (LONG64)desired,
+                                        (LONG64)expected) == (LONG64)expected;
+#else
+    return InterlockedCompareExchange((volatile LONG *)target, (LONG)desired,
+                                      (LONG)expected) == (LONG)expected;
+#endif
+}
+
+static inline void *atomic_load_ptr(void *volatile *target) {
+    return InterlockedCompareExchangePointer(target, NULL, NULL);
+}
+
+static inline void atomic_store_ptr(void *volatile *target, void *value) {
+    InterlockedExchangePointer(target, value);
+}
+
+// Spin locks guard short critical sections that must not allocate (e.g.
+// inside an allocator). The lock is a zero-initialized long.
+static inline void spin_lock(volatile long *lock) {
+    while (InterlockedCompareExchange(lock, 1, 0) != 0)
+        SwitchToThread();
+}
+
+static inline void spin_unlock(volatile long *lock) {
+    InterlockedExchange(lock, 0);
+}
+
+#else
+#include <sched.h>
+
+static inline size_t atomic_fetch_add_size(volatile size_t *target,
+                                           size_t value) {
+    return __atomic_fetch_add(target, value, __ATOMIC_ACQ_REL);
+}
+
+static inline size_t atomic_load_size(volatile size_t *target) {
+    return __atomic_load_n(target, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomic_store_size(volatile size_t *target, size_t value) {
+    __atomic_store_n(target, value, __ATOMIC_RELEASE);
+}
+
+static inline bool_t atomic_compare_exchange_size(volatile size_t *target,
+                                                  size_t expected,
+                                                  size_t desired) {
+    return __atomic_compare_exchange_n(target, &expected, desired, FALSE,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline void *atomic_load_ptr(void *volatile *target) {
+    return __atomic_load_n(target, __ATOMIC_ACQUIRE);
+}
+
+static inline void atomic_store_ptr(void *volatile *target, void *value) {
+    __atomic_store_n(target, value, __ATOMIC_RELEASE);
+}
+
+// Spin locks guard short critical sections that must not allocate (e.g.
+// inside an allocator). The lock is a zero-initialized long.
+static inline void spin_lock(volatile long *lock) {
+    while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE) != 0)
+        sched_yield();
+}
+
+static inline void spin_unlock(volatile long *lock) {
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+#endif
+
+#endif
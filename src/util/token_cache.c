@@ -0,0 +1,61 @@
+#include "token_cache.h"
+#include "../crt.h"
+
+#define TOKEN_CACHE_MAGIC 0x434B5444 // "DTKC"
+#define TOKEN_CACHE_VERSION 2
+
+typedef struct {
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long size;
+    unsigned long long mtime;
+    unsigned int token;
+    unsigned int reserved;
+} TokenCacheRecord;
+
+char_t *token_cache_path(char_t *path) {
+    char_t *result =
+        calloc(strlen(path) + STR_LEN(TOKEN_CACHE_EXT), sizeof(char_t));
+    strcpy(result, path);
+    strcat(result, TOKEN_CACHE_EXT);
+    return result;
+}
+
+bool_t token_cache_load(char_t *cache_path, const FileStamp *stamp,
+                        unsigned int *token) {
+    void *file = fopen(cache_path, "rb");
+    // fopen returns INVALID_HANDLE_VALUE on failure on Windows
+    if (!file || file == (void *)-1)
+        return FALSE;
+
+    TokenCacheRecord record;
+    size_t read = fread(&record, 1, sizeof(record), file);
+    fclose(file);
+
+    if (read != sizeof(record) || record.magic != TOKEN_CACHE_MAGIC ||
+        record.version != TOKEN_CACHE_VERSION || record.size != stamp->size ||
+        record.mtime != stamp->mtime)
+        return FALSE;
+
+    *token = record.token;
+    return TRUE;
+}
+
+bool_t token_cache_store(char_t *cache_path, const FileStamp *stamp,
+                         unsigned int token) {
+    void *file = fopen(cache_path, "wb");
+    if (!file || file == (void *)-1)
+        return FALSE;
+
+    TokenCacheRecord record;
+    memset(&record, 0, sizeof(record));
+    record.magic = TOKEN_CACHE_MAGIC;
+    record.version = TOKEN_CACHE_VERSION;
+    record.size = stamp->size;
+    record.mtime = stamp->mtime;
+    record.token = token;
+
+    size_t written = fwrite(&record, 1, sizeof(record), file);
+    fclose(file);
+    return written == sizeof(record);
+}
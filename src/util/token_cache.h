@@ -0,0 +1,46 @@
+#ifndef TOKEN_CACHE_H
+#define TOKEN_CACHE_H
+
+#include "util.h"
+
+/**
+ * @brief Extension appended to an assembly path to get its token cache path.
+ */
+#define TOKEN_CACHE_EXT TEXT(".token_cache")
+
+/**
+ * @brief Get the path of the token cache belonging to the given file.
+ *
+ * @remark Return value must be freed by caller.
+ *
+ * @param path Path to the file the token belongs to.
+ * @return char_t* Path to the cache file.
+ */
+char_t *token_cache_path(char_t *path);
+
+/**
+ * @brief Load a metadata token cached for a file.
+ *
+ * The token is only reused if the size and modification time of the file are
+ * unchanged, so that a hit costs no more than a stat of the file.
+ *
+ * @param cache_path Path to the cache file.
+ * @param stamp Current stamp of the file the token belongs to.
+ * @param token Variable which will receive the cached token.
+ * @return bool_t TRUE if a token was cached for the same file stamp.
+ */
+bool_t token_cache_load(char_t *cache_path, const FileStamp *stamp,
+                        unsigned int *token);
+
+/**
+ * @brief Store a metadata token for a file, replacing any previous entry.
+ *
+ * @param cache_path Path to the cache file.
+ * @param stamp Stamp of the file the token belongs to.
+ * @param token Token to cache.
+ * @return bool_t TRUE if the cache file was written.
+ */
+bool_t token_cache_store(char_t *cache_path, const FileStamp *stamp,
+                         unsigned int token);
+
+#endif
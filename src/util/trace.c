@@ -0,0 +1,115 @@
+#include "trace.h"
+#include "../crt.h"
+#include "format.h"
+#include "logging.h"
+#include "thread.h"
+
+typedef struct {
+    // Set last, so that a slot with a name is completely filled in
+    void *volatile name;
+    char phase;
+    unsigned long thread_id;
+    unsigned long long time_us;
+} TraceEvent;
+
+static bool_t tracing = FALSE;
+static char_t *trace_path = NULL;
+// Preallocated so that recording never allocates
+static TraceEvent events[TRACE_MAX_EVENTS];
+static volatile size_t event_count = 0;
+static volatile long write_lock = 0;
+
+bool_t trace_init(const char_t *path) {
+    if (tracing)
+        return TRUE;
+    trace_path = strdup(path);
+    tracing = trace_path != NULL;
+    return tracing;
+}
+
+void trace_event(const char *name, char phase, unsigned long long time_us) {
+    if (!tracing)
+        return;
+
+    size_t index = atomic_fetch_add_size(&event_count, 1);
+    if (index >= TRACE_MAX_EVENTS)
+        return;
+    TraceEvent *event = &events[index];
+    event->phase = phase;
+    event->thread_id = thread_current_id();
+    event->time_us = time_us;
+    // trace_write may read the slot from another thread
+    atomic_store_ptr(&event->name, (void *)name);
+}
+
+void trace_begin(const char *name) {
+    if (tracing)
+        trace_event(name, 'B', monotonic_time_us());
+}
+
+void trace_end(const char *name) {
+    if (tracing)
+        trace_event(name, 'E', monotonic_time_us());
+}
+
+void trace_write() {
+    if (!tracing)
+        return;
+
+    spin_lock(&write_lock);
+    if (!trace_path) {
+        spin_unlock(&write_lock);
+        return;
+    }
+    char_t *path = trace_path;
+    trace_path = NULL;
+    spin_unlock(&write_lock);
+
+    size_t count = atomic_load_size(&event_count);
+    if (count > TRACE_MAX_EVENTS) {
+        LOG("Dropped %lu trace events",
+            (unsigned long)(count - TRACE_MAX_EVENTS));
+        count = TRACE_MAX_EVENTS;
+    }
+
+    void *file = fopen(path, "wb");
+    // fopen returns INVALID_HANDLE_VALUE on failure on Windows
+    if (!file || file == (void *)-1) {
+        LOG("Failed to write startup trace to %s", path);
+        free(path);
+        return;
+    }
+
+    static const char header[] = "{\"traceEvents\":[";
+    fwrite(header, 1, sizeof(header) - 1, file);
+
+    char line[256];
+    bool_t first = TRUE;
+    for (size_t i = 0; i < count; i++) {
+        TraceEvent *event = &events[i];
+        const char *name = atomic_load_ptr(&event->name);
+        // Slot taken by a thread that hasn't filled it in yet
+        if (!name)
+            continue;
+
+        char *p = format_str(line, first ? "\n" : ",\n");
+        p = format_str(p, "{\"name\":\"");
+        p = format_str(p, name);
+        p = format_str(p, "\",\"ph\":\"");
+        *p++ = event->phase;
+        p = format_str(p, "\",\"ts\":");
+        p = format_u64(p, event->time_us);
+        p = format_str(p, ",\"pid\":1,\"tid\":");
+        p = format_u64(p, event->thread_id);
+        *p++ = '}';
+        fwrite(line, 1, p - line, file);
+        first = FALSE;
+    }
+
+    static const char footer[] = "\n],\"displayTimeUnit\":\"ms\"}\n";
+    fwrite(footer, 1, sizeof(footer) - 1, file);
+    fclose(file);
+
+    LOG("Wrote %lu trace events to %s", (unsigned long)count, path);
+    free(path);
+}
@@ -0,0 +1,48 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "util.h"
+
+/**
+ * @brief Maximum number of events recorded. Later events are dropped.
+ */
+#define TRACE_MAX_EVENTS 256
+
+/**
+ * @brief Start recording startup phases.
+ *
+ * Until this is called, recording an event only checks a flag.
+ *
+ * @param path Path of the Chrome trace-event JSON written by trace_write.
+ * @return bool_t TRUE if events are recorded.
+ */
+bool_t trace_init(const char_t *path);
+
+/**
+ * @brief Record an event at the given time.
+ *
+ * Used for phases that started before trace_init could be called.
+ *
+ * @param name Name of the phase. Must outlive the trace.
+ * @param phase `B` for the beginning of a phase or `E` for its end.
+ * @param time_us Time returned by monotonic_time_us.
+ */
+void trace_event(const char *name, char phase, unsigned long long time_us);
+
+/**
+ * @brief Mark the beginning of a phase on the calling thread.
+ */
+void trace_begin(const char *name);
+
+/**
+ * @brief Mark the end of the innermost phase with the same name on the
+ * calling thread.
+ */
+void trace_end(const char *name);
+
+/**
+ * @brief Write the recorded events. Only the first call writes them.
+ */
+void trace_write();
+
+#endif
@@ -16,6 +16,7 @@ typedef TCHAR char_t;
 typedef BOOL bool_t;
 
 #define PATH_SEP TEXT(";")
+#define DIR_SEP TEXT("\\")
 
 #elif defined(__APPLE__) || defined(__linux__)
 #include <stddef.h>
@@ -31,6 +32,7 @@ typedef int bool_t;
 #define TEXT(text) text
 
 #define PATH_SEP TEXT(":")
+#define DIR_SEP TEXT("/")
 #endif
 
 #define STR_LEN(str) (sizeof(str) / sizeof((str)[0]))
@@ -143,4 +145,60 @@ char_t *program_path();
 
 size_t get_file_size(void *file);
 
+/**
+ * @brief Size and last modification time of a file.
+ */
+typedef struct {
+    unsigned long long size;
+    unsigned long long mtime;
+} FileStamp;
+
+/**
+ * @brief Get the size and last modification time of a file without opening
+ * it.
+ *
+ * @param file File path to check.
+ * @param stamp Variable which will receive the file information.
+ * @return bool_t TRUE if the file exists and the information was read.
+ */
+bool_t get_file_stamp(char_t *file, FileStamp *stamp);
+
+/**
+ * @brief Callback invoked for every file found by list_files.
+ *
+ * @param dir Folder the file was found in.
+ * @param name Name of the file (without the folder part).
+ * @param user_data User data passed to list_files.
+ */
+typedef void (*file_visitor_t)(char_t *dir, char_t *name, void *user_data);
+
+/**
+ * @brief Enumerate files in the given folder that end with the given
+ * extension. Subfolders are not visited.
+ *
+ * @param dir Folder to enumerate.
+ * @param ext Extension to match, including the dot (e.g. ".dll").
+ * @param visitor Callback invoked for every matching file.
+ * @param user_data User data passed to the callback.
+ * @return size_t Number of files visited.
+ */
+size_t list_files(char_t *dir, const char_t *ext, file_visitor_t visitor,
+                  void *user_data);
+
+/**
+ * @brief Ask the OS to bring the contents of a file into the page cache
+ * without reading it into memory.
+ *
+ * @param file File path to prefetch.
+ * @return bool_t TRUE if the file was opened and the prefetch was issued.
+ */
+bool_t prefetch_file(char_t *file);
+
+/**
+ * @brief Get the value of a monotonic clock.
+ *
+ * @return unsigned long long Time in microseconds since an arbitrary point.
+ */
+unsigned long long monotonic_time_us();
+
 #endif
\ No newline at end of file
@@ -1,94 +1,18 @@
+#define LOG_CATEGORY LOG_CAT_CONFIG
 #include "../config/config.h"
 #include "../crt.h"
 #include "../util/logging.h"
 #include "../util/util.h"
 
-#define CONFIG_NAME TEXT("doorstop_config.ini")
-#define DEFAULT_TARGET_ASSEMBLY TEXT("Doorstop.dll")
 #define EXE_EXTENSION_LENGTH 4
 #define STR_EQUAL(str1, str2) (lstrcmpi(str1, str2) == 0)
 
-void load_bool_file(const char_t *path, const char_t *section,
-                    const char_t *key, const char_t *def, bool_t *value) {
-    char_t enabled_string[256] = TEXT("true");
-    GetPrivateProfileString(section, key, def, enabled_string, 256, path);
-    LOG("CONFIG: %s.%s = %s", section, key, enabled_string);
-
-    if (STR_EQUAL(enabled_string, TEXT("true")))
-        *value = TRUE;
-    else if (STR_EQUAL(enabled_string, TEXT("false")))
-        *value = FALSE;
-}
-
-char_t *get_ini_entry(const char_t *config_file, const char_t *section,
-                      const char_t *key, const char_t *default_val) {
-    DWORD i = 0;
-    DWORD size, read;
-    char_t *result = NULL;
-    do {
-        if (result != NULL)
-            free(result);
-        i++;
-        size = i * MAX_PATH + 1;
-        result = malloc(sizeof(char_t) * size);
-        read = GetPrivateProfileString(section, key, default_val, result, size,
-                                       config_file);
-    } while (read == size - 1);
-    return result;
-}
-
-bool_t load_str_file(const char_t *path, const char_t *section,
-                     const char_t *key, const char_t *def, char_t **value) {
-    char_t *tmp = get_ini_entry(path, section, key, def);
-    LOG("CONFIG: %s.%s = %s", section, key, tmp);
-    if (!tmp || strlen(tmp) == 0)
-        return FALSE;
-    *value = tmp;
-    return TRUE;
-}
-
-void load_path_file(const char_t *path, const char_t *section,
-                    const char_t *key, const char_t *def, char_t **value) {
-    if (!load_str_file(path, section, key, def, value))
-        return;
-    char_t *tmp = *value;
-    *value = get_full_path(tmp);
-    LOG("(%s.%s) %s => %s", section, key, tmp, *value);
-    free(tmp);
-}
-
 static inline void init_config_file() {
     if (!file_exists(CONFIG_NAME))
         return;
 
     char_t *config_path = get_full_path(CONFIG_NAME);
-
-    load_bool_file(config_path, TEXT("General"), TEXT("enabled"), TEXT("true"),
-                   &config.enabled);
-    load_bool_file(config_path, TEXT("General"), TEXT("ignore_disable_switch"),
-                   TEXT("false"), &config.ignore_disabled_env);
-    load_bool_file(config_path, TEXT("General"), TEXT("redirect_output_log"),
-                   TEXT("false"), &config.redirect_output_log);
-    load_path_file(config_path, TEXT("General"), TEXT("target_assembly"),
-                   DEFAULT_TARGET_ASSEMBLY, &config.target_assembly);
-    load_path_file(config_path, TEXT("General"), TEXT("boot_config_override"),
-                   NULL, &config.boot_config_override);
-
-    load_str_file(config_path, TEXT("UnityMono"),
-                  TEXT("dll_search_path_override"), TEXT(""),
-                  &config.mono_dll_search_path_override);
-    load_bool_file(config_path, TEXT("UnityMono"), TEXT("debug_enabled"),
-                   TEXT("false"), &config.mono_debug_enabled);
-    load_bool_file(config_path, TEXT("UnityMono"), TEXT("debug_suspend"),
-                   TEXT("false"), &config.mono_debug_suspend);
-    load_str_file(config_path, TEXT("UnityMono"), TEXT("debug_address"),
-                  TEXT("127.0.0.1:10000"), &config.mono_debug_address);
-
-    load_path_file(config_path, TEXT("Il2Cpp"), TEXT("coreclr_path"), NULL,
-                   &config.clr_runtime_coreclr_path);
-    load_path_file(config_path, TEXT("Il2Cpp"), TEXT("corlib_dir"), NULL,
-                   &config.clr_corlib_dir);
-
+    load_config_file(config_path);
     free(config_path);
 }
 
@@ -100,7 +24,7 @@ bool_t load_bool_argv(char_t **argv, int *i, int argc, const char_t *arg_name,
             *value = TRUE;
         else if (STR_EQUAL(par, TEXT("false")))
             *value = FALSE;
-        LOG("ARGV: %s = %s", arg_name, par);
+        LOG_DEBUG("ARGV: %s = %s", arg_name, par);
         return TRUE;
     }
     return FALSE;
@@ -114,7 +38,21 @@ bool_t load_str_argv(char_t **argv, int *i, int argc, const char_t *arg_name,
         const size_t len = strlen(argv[*i + 1]) + 1;
         *value = malloc(sizeof(char_t) * len);
         strncpy(*value, argv[++*i], len);
-        LOG("ARGV: %s = %s", arg_name, *value);
+        LOG_DEBUG("ARGV: %s = %s", arg_name, *value);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+bool_t load_uint_argv(char_t **argv, int *i, int argc, const char_t *arg_name,
+                      unsigned int *value) {
+    if (STR_EQUAL(argv[*i], arg_name) && *i < argc) {
+        char_t *par = argv[++*i];
+        char_t *end = NULL;
+        unsigned long parsed = strtoul(par, &end, 10);
+        if (end != par && *end == 0)
+            *value = (unsigned int)parsed;
+        LOG_DEBUG("ARGV: %s = %s", arg_name, par);
         return TRUE;
     }
     return FALSE;
@@ -126,7 +64,7 @@ bool_t load_path_argv(char_t **argv, int *i, int argc, const char_t *arg_name,
         return FALSE;
     char_t *tmp = *value;
     *value = get_full_path(tmp);
-    LOG("(%s) %s => %s", arg_name, tmp, *value);
+    LOG_DEBUG("(%s) %s => %s", arg_name, tmp, *value);
     free(tmp);
     return TRUE;
 }
@@ -141,6 +79,8 @@ static inline void init_cmd_args() {
         continue;
 
     for (int i = 0; i < argc; i++) {
+        PARSE_ARG(TEXT("--doorstop-log-level"), config.log_level,
+                  load_str_argv);
         PARSE_ARG(TEXT("--doorstop-enabled"), config.enabled, load_bool_argv);
         PARSE_ARG(TEXT("--doorstop-redirect-output-log"),
                   config.redirect_output_log, load_bool_argv);
@@ -148,6 +88,10 @@ static inline void init_cmd_args() {
                   load_path_argv);
         PARSE_ARG(TEXT("--doorstop-boot-config-override"),
                   config.boot_config_override, load_path_argv);
+        PARSE_ARG(TEXT("--doorstop-runtime-invoke-profile"),
+                  config.runtime_invoke_profile, load_path_argv);
+        PARSE_ARG(TEXT("--doorstop-boot-trace"), config.boot_trace,
+                  load_path_argv);
 
         PARSE_ARG(TEXT("--doorstop-mono-dll-search-path-override"),
                   config.mono_dll_search_path_override, load_path_argv);
@@ -157,14 +101,41 @@ static inline void init_cmd_args() {
                   config.mono_debug_suspend, load_bool_argv);
         PARSE_ARG(TEXT("--doorstop-mono-debug-address"),
                   config.mono_debug_address, load_str_argv);
+        PARSE_ARG(TEXT("--doorstop-mono-jit-options"), config.mono_jit_options,
+                  load_str_argv);
+        PARSE_ARG(TEXT("--doorstop-mono-gc-nursery-size"),
+                  config.mono_gc_nursery_size, load_str_argv);
+        PARSE_ARG(TEXT("--doorstop-mono-gc-major"), config.mono_gc_major,
+                  load_str_argv);
+        PARSE_ARG(TEXT("--doorstop-mono-gc-soft-heap-limit"),
+                  config.mono_gc_soft_heap_limit, load_str_argv);
+        PARSE_ARG(TEXT("--doorstop-mono-gc-params"), config.mono_gc_params,
+                  load_str_argv);
+        PARSE_ARG(TEXT("--doorstop-mono-gc-debug"), config.mono_gc_debug,
+                  load_str_argv);
 
         PARSE_ARG(TEXT("--doorstop-clr-corlib-dir"), config.clr_corlib_dir,
                   load_path_argv);
         PARSE_ARG(TEXT("--doorstop-clr-runtime-coreclr-path"),
                   config.clr_runtime_coreclr_path, load_path_argv);
+        PARSE_ARG(TEXT("--doorstop-clr-concurrent-init"),
+                  config.clr_concurrent_init, load_bool_argv);
+        PARSE_ARG(TEXT("--doorstop-il2cpp-pool-allocator"),
+                  config.il2cpp_pool_allocator, load_bool_argv);
+        PARSE_ARG(TEXT("--doorstop-il2cpp-gc-mode"), config.il2cpp_gc_mode,
+                  load_str_argv);
+        PARSE_ARG(TEXT("--doorstop-il2cpp-gc-max-time-slice-ns"),
+                  config.il2cpp_gc_max_time_slice_ns, load_uint_argv);
+        if (STR_EQUAL(argv[i], TEXT("--doorstop-clr-runtime-property")) &&
+            i + 1 < argc) {
+            LOG_DEBUG("ARGV: %s = %s", argv[i], argv[i + 1]);
+            add_clr_runtime_property(argv[++i]);
+            continue;
+        }
     }
 
     LocalFree(argv);
+    log_configure(config.log_level);
 
 #undef PARSE_ARG
 }
@@ -182,5 +153,6 @@ void load_config() {
     init_config_defaults();
     init_config_file();
     init_cmd_args();
+    resolve_config();
     init_env_vars();
 }
@@ -1,9 +1,14 @@
+#define LOG_CATEGORY LOG_CAT_HOOKS
 #include "entrypoint.h"
 #include "../bootstrap.h"
 #include "../config/config.h"
 #include "../crt.h"
+#include "../preload/warmup.h"
 #include "../util/logging.h"
 #include "../util/paths.h"
+#include "../util/pool.h"
+#include "../util/profiler.h"
+#include "../util/trace.h"
 #include "hook.h"
 #include "proxy/proxy.h"
 
@@ -144,11 +149,11 @@ void *WINAPI get_proc_address_detour(void *module, char *name) {
         lstrcmpA(name, get_mapped_player_name(init_name)) == 0) {              \
         if (!initialized) {                                                    \
             initialized = TRUE;                                                \
-            LOG("Got %S (%S) at %p", get_mapped_player_name(init_name),        \
-                init_name, module);                                            \
+            LOG_DEBUG("Got %S (%S) at %p",                                     \
+                      get_mapped_player_name(init_name), init_name, module);   \
             extra_init;                                                        \
             init_func(module);                                                 \
-            LOG("Loaded all runtime functions\n")                              \
+            LOG("Loaded all runtime functions\n");                             \
         }                                                                      \
         return (void *)(target);                                               \
     }
@@ -164,6 +169,17 @@ void *WINAPI get_proc_address_detour(void *module, char *name) {
     REDIRECT_INIT("mono_debug_init", load_mono_funcs, hook_mono_debug_init,
                   capture_mono_path(module));
 
+    if (config.runtime_invoke_profile) {
+        REDIRECT_INIT("il2cpp_runtime_invoke", load_il2cpp_funcs,
+                      hook_il2cpp_runtime_invoke, {});
+        REDIRECT_INIT("il2cpp_shutdown", load_il2cpp_funcs,
+                      hook_il2cpp_shutdown, {});
+        REDIRECT_INIT("mono_runtime_invoke", load_mono_funcs,
+                      hook_mono_runtime_invoke, capture_mono_path(module));
+        REDIRECT_INIT("mono_jit_cleanup", load_mono_funcs,
+                      hook_mono_jit_cleanup, capture_mono_path(module));
+    }
+
     return (void *)GetProcAddress(module, name);
 #undef REDIRECT_INIT
 }
@@ -195,21 +211,30 @@ void inject(DoorstopPaths const *paths) {
 
     if (!config.enabled) {
         LOG("Doorstop disabled!");
-        free_logger();
+        free_logger(FALSE);
         return;
     }
 
     LOG("Doorstop enabled!");
+
+    if (config.runtime_invoke_profile &&
+        !profiler_init(config.runtime_invoke_profile)) {
+        LOG_ERROR("Failed to start the runtime_invoke profiler");
+        free(config.runtime_invoke_profile);
+        config.runtime_invoke_profile = NULL;
+    }
+
     HMODULE target_module = GetModuleHandle(TEXT("UnityPlayer"));
     HMODULE app_module = GetModuleHandle(NULL);
 
     if (!target_module) {
-        LOG("No UnityPlayer module found! Using executable as the hook "
-            "target.\n");
+        LOG_WARN("No UnityPlayer module found! Using executable as the hook "
+                 "target.\n");
         target_module = app_module;
     }
 
     LOG("Installing IAT hooks");
+    trace_begin("iat_hooks");
     bool_t ok = TRUE;
 
 #define HOOK_SYS(mod, from, to) ok &= iat_hook(mod, "kernel32.dll", &from, &to)
@@ -218,20 +243,14 @@ void inject(DoorstopPaths const *paths) {
     HOOK_SYS(target_module, CloseHandle, close_handle_hook);
     if (config.boot_config_override) {
         if (file_exists(config.boot_config_override)) {
-            default_boot_config_path = calloc(MAX_PATH, sizeof(char_t));
-            memset(default_boot_config_path, 0, MAX_PATH * sizeof(char_t));
-            strcat(default_boot_config_path, get_working_dir());
-            strcat(default_boot_config_path, TEXT("\\"));
-            strcat(default_boot_config_path,
-                   get_file_name(program_path(), FALSE));
-            strcat(default_boot_config_path, TEXT("_Data\\boot.config"));
+            default_boot_config_path = config.default_boot_config_path;
 
             HOOK_SYS(target_module, CreateFileW, create_file_hook);
             HOOK_SYS(target_module, CreateFileA, create_file_hook_narrow);
         } else {
-            LOG("The boot.config file won't be overriden because the provided "
-                "one does not exist: %s",
-                config.boot_config_override);
+            LOG_WARN("The boot.config file won't be overriden because the "
+                     "provided one does not exist: %s",
+                     config.boot_config_override);
         }
     }
 
@@ -245,24 +264,40 @@ void inject(DoorstopPaths const *paths) {
     }
 
 #undef HOOK_SYS
+    trace_end("iat_hooks");
 
     if (!ok) {
-        LOG("Failed to install IAT hook!");
-        free_logger();
+        LOG_ERROR("Failed to install IAT hook!");
+        free_logger(FALSE);
     } else {
         LOG("Hooks installed, marking DOORSTOP_DISALBE = TRUE");
         setenv(TEXT("DOORSTOP_DISABLE"), TEXT("TRUE"), TRUE);
+
+        // Threads created here only start running once the loader lock is
+        // released, which is still long before Unity initializes the runtime
+        warmup_start();
     }
 }
 
 BOOL WINAPI DllEntry(HINSTANCE hInstDll, DWORD reasonForDllLoad,
                      LPVOID reserved) {
-    if (reasonForDllLoad == DLL_PROCESS_DETACH)
+    if (reasonForDllLoad == DLL_PROCESS_DETACH) {
         SetEnvironmentVariableW(L"DOORSTOP_DISABLE", NULL);
+        pool_log_stats();
+        // The runtime may already be gone, so methods are written as
+        // addresses
+        profiler_dump(NULL);
+        // Only written here if the runtime never finished bootstrapping
+        trace_write();
+        // Writes the messages still queued; reserved is set if the process
+        // is exiting, in which case the other threads are already gone
+        free_logger(reserved != NULL);
+    }
     if (reasonForDllLoad != DLL_PROCESS_ATTACH)
         return TRUE;
 
     init_crt();
+    unsigned long long entry_start = monotonic_time_us();
     bool_t fixed_cwd = fix_cwd();
     init_logger();
     DoorstopPaths *paths = paths_init(hInstDll, fixed_cwd);
@@ -281,20 +316,33 @@ BOOL WINAPI DllEntry(HINSTANCE hInstDll, DWORD reasonForDllLoad,
     load_proxy(paths->doorstop_filename);
     LOG("Proxy loaded");
 
+    unsigned long long config_start = monotonic_time_us();
     load_config();
+    unsigned long long config_end = monotonic_time_us();
     LOG("Config loaded");
 
+    // Phases before the config was loaded are recorded retroactively
+    if (config.enabled && config.boot_trace &&
+        trace_init(config.boot_trace)) {
+        trace_event("DllEntry", 'B', entry_start);
+        trace_event("load_config", 'B', config_start);
+        trace_event("load_config", 'E', config_end);
+    }
+
+    trace_begin("load_mapper");
     load_mapper();
+    trace_end("load_mapper");
     LOG("Mapper loaded");
 
     redirect_output_log(paths);
 
     if (!file_exists(config.target_assembly)) {
-        LOG("Could not find target assembly!");
+        LOG_ERROR("Could not find target assembly!");
         config.enabled = FALSE;
     }
 
     inject(paths);
+    trace_end("DllEntry");
 
     paths_free(paths);
 
@@ -4,5 +4,34 @@
 
 #if VERBOSE
 HANDLE log_handle;
-char_t buffer[4096];
-#endif
\ No newline at end of file
+
+void log_format(const char_t *format, ...) {
+    // wvsprintf writes at most 1024 characters
+    char_t buffer[1024];
+    va_list args;
+    va_start(args, format);
+    int length = wvsprintf(buffer, format, args);
+    va_end(args);
+    if (length <= 0)
+        return;
+
+#ifdef UNICODE
+    char message[LOG_RING_MESSAGE_SIZE];
+    int size = WideCharToMultiByte(CP_UTF8, 0, buffer, length, message,
+                                   sizeof(message), NULL, NULL);
+    // Truncate messages that don't fit to a length that always does
+    if (!size)
+        size = WideCharToMultiByte(CP_UTF8, 0, buffer,
+                                   sizeof(message) / 3, message,
+                                   sizeof(message), NULL, NULL);
+    log_ring_write(message, size);
+#else
+    log_ring_write(buffer, length);
+#endif
+}
+
+void log_sink_file(const char *data, size_t size) {
+    DWORD written;
+    WriteFile(log_handle, data, (DWORD)size, &written, NULL);
+}
+#endif
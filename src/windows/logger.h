@@ -2,12 +2,13 @@
 #define LOGGER_WIN_H
 #if VERBOSE
 
+#include "../util/log_binary.h"
+#include "../util/log_ring.h"
 #include "../util/logging.h"
 #include "../util/util.h"
 #include <windows.h>
 
 extern HANDLE log_handle;
-extern char_t buffer[4096];
 
 #ifdef UNICODE
 #define printf wsprintfW
@@ -15,35 +16,54 @@ extern char_t buffer[4096];
 #define printf wsprintfA
 #endif
 
+/**
+ * @brief Format a message and queue it to be written to the log file.
+ */
+void log_format(const char_t *format, ...);
+
+void log_sink_file(const char *data, size_t size);
+
 static inline void init_logger() {
+    char_t name[64];
 #ifdef DETERMINISTIC_LOG
-    printf(buffer, TEXT("doorstop.log"));
+    printf(name, TEXT("doorstop.log"));
 #else
-    printf(buffer, TEXT("doorstop_%lx.log"), GetTickCount());
+    printf(name, TEXT("doorstop_%lx.log"), GetTickCount());
 #endif
-    log_handle = CreateFile(buffer, GENERIC_WRITE, FILE_SHARE_READ, NULL,
+    log_handle = CreateFile(name, GENERIC_WRITE, FILE_SHARE_READ, NULL,
                             CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (log_handle != INVALID_HANDLE_VALUE)
+        log_ring_init(log_sink_file, "");
 }
 
-static inline void free_logger() { CloseHandle(log_handle); }
+// LOG may still be called after this; such messages are written directly.
+// The handle is left open for them and closed by the system on exit.
+static inline void free_logger(bool_t terminating) {
+    if (!log_handle || log_handle == INVALID_HANDLE_VALUE)
+        return;
+    log_ring_shutdown(terminating);
+}
 
+#if BINARY_LOG
+// The format is kept narrow; %s arguments are still char_t strings
 #if !defined(_MSVC_TRADITIONAL) || _MSVC_TRADITIONAL
-#define LOG(message, ...)                                                      \
-    {                                                                          \
-        size_t len = printf(buffer, TEXT(message) TEXT("\n"), ##__VA_ARGS__);  \
-        char *log_data = narrow(buffer);                                       \
-        WriteFile(log_handle, log_data, len, NULL, NULL);                      \
-        free(log_data);                                                        \
-    }
+#define LOG_WRITE(message, ...)                                                \
+    do {                                                                       \
+        static LogSite log_site;                                               \
+        log_binary_write(&log_site, message, ##__VA_ARGS__);                   \
+    } while (0)
 #else
-#define LOG(message, ...)                                                      \
-    {                                                                          \
-        size_t len = printf(buffer, TEXT(message) TEXT("\n") __VA_OPT__(, )    \
-                                        __VA_ARGS__);                          \
-        char *log_data = narrow(buffer);                                       \
-        WriteFile(log_handle, log_data, len, NULL, NULL);                      \
-        free(log_data);                                                        \
-    }
+#define LOG_WRITE(message, ...)                                                \
+    do {                                                                       \
+        static LogSite log_site;                                               \
+        log_binary_write(&log_site, message __VA_OPT__(, ) __VA_ARGS__);       \
+    } while (0)
+#endif
+#elif !defined(_MSVC_TRADITIONAL) || _MSVC_TRADITIONAL
+#define LOG_WRITE(message, ...) log_format(TEXT(message), ##__VA_ARGS__)
+#else
+#define LOG_WRITE(message, ...)                                                \
+    log_format(TEXT(message) __VA_OPT__(, ) __VA_ARGS__)
 #endif
 
 #define ASSERT_F(test, message, ...)                                           \
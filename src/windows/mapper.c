@@ -1,3 +1,4 @@
+#define LOG_CATEGORY LOG_CAT_MAPPER
 #include "../mapper/mapper.h"
 #include "../crt.h"
 #include "../util/logging.h"
@@ -40,13 +41,13 @@ static char_t *trim_whitespace(char_t *str) {
 
 static const char *read_mapped_symbol(void *file, unsigned long offset) {
     if (!file) {
-        LOG("Error: File pointer is NULL.\n");
+        LOG_ERROR("Error: File pointer is NULL.\n");
         return NULL;
     }
 
     // Attempt to seek to the offset
     if (fseek(file, (long)offset, SEEK_SET) != 0) {
-        LOG("Error: Failed to seek to offset 0x%x.", offset);
+        LOG_ERROR("Error: Failed to seek to offset 0x%x.", offset);
         return NULL;
     }
 
@@ -54,7 +55,8 @@ static const char *read_mapped_symbol(void *file, unsigned long offset) {
     size_t length = 0;
     char *buffer = (char *)malloc(capacity * sizeof(char));
     if (!buffer) {
-        LOG("Error: Failed to allocate initial buffer for symbol string.\n");
+        LOG_ERROR(
+            "Error: Failed to allocate initial buffer for symbol string.\n");
         return NULL;
     }
 
@@ -66,8 +68,8 @@ static const char *read_mapped_symbol(void *file, unsigned long offset) {
             capacity *= 2;
             char *new_buffer = (char *)realloc(buffer, capacity * sizeof(char));
             if (!new_buffer) {
-                LOG("Error: Failed to reallocate buffer while "
-                    "reading symbol.\n");
+                LOG_ERROR("Error: Failed to reallocate buffer while "
+                          "reading symbol.\n");
                 free(buffer);
                 return NULL;
             }
@@ -106,7 +108,8 @@ static inline void load_mapper_to_global_store(const char *mapper_config_name,
     map_file = fopen((char *)mapper_config_name, "r");
     if (map_file == (void *)INVALID_HANDLE_VALUE) { // Use explicit handle check
                                                     // since fopen is wrapper
-        LOG("Error: Could not open mapper file '%S'.", mapper_config_name);
+        LOG_ERROR("Error: Could not open mapper file '%S'.",
+                  mapper_config_name);
         mapper = NULL;
         return;
     }
@@ -114,9 +117,9 @@ static inline void load_mapper_to_global_store(const char *mapper_config_name,
     // Open the binary file for reading the mapped symbol strings
     binary_file = fopen((char *)read_binary_name, "rb"); // "rb" for binary read
     if (binary_file == (void *)INVALID_HANDLE_VALUE) {
-        LOG("Warning: Could not open binary file '%S'. Symbol "
-            "strings will not be read.",
-            read_binary_name);
+        LOG_WARN("Warning: Could not open binary file '%S'. Symbol "
+                 "strings will not be read.",
+                 read_binary_name);
         binary_file = NULL; // Ensure it's NULL if handle is invalid
         return;
     }
@@ -124,8 +127,8 @@ static inline void load_mapper_to_global_store(const char *mapper_config_name,
     // 1. Allocate the global mapper store container
     mapper = (Mapper *)calloc(1, sizeof(Mapper));
     if (mapper == NULL) {
-        LOG("Fatal Error: Failed to allocate memory for global mapper "
-            "container.");
+        LOG_ERROR("Fatal Error: Failed to allocate memory for global mapper "
+                  "container.");
         return;
     }
 
@@ -135,8 +138,8 @@ static inline void load_mapper_to_global_store(const char *mapper_config_name,
         (MapperEntry *)malloc(initial_capacity * sizeof(MapperEntry));
 
     if (mapper->entries == NULL) {
-        LOG("Fatal Error: Failed to allocate initial memory for mapper "
-            "array.");
+        LOG_ERROR("Fatal Error: Failed to allocate initial memory for mapper "
+                  "array.");
         free(mapper);
         mapper = NULL;
         return;
@@ -152,9 +155,9 @@ static inline void load_mapper_to_global_store(const char *mapper_config_name,
                 mapper->entries, mapper->capacity * sizeof(MapperEntry));
 
             if (new_ptr == NULL) {
-                LOG("Error: Failed to reallocate memory for entries. "
-                    "Stopping at %d entries.",
-                    mapper->count);
+                LOG_ERROR("Error: Failed to reallocate memory for entries. "
+                          "Stopping at %d entries.",
+                          mapper->count);
                 break;
             }
             mapper->entries = new_ptr;
@@ -179,7 +182,7 @@ static inline void load_mapper_to_global_store(const char *mapper_config_name,
             char_t *name_token = trim_whitespace(tokens[1]);
             current_mapper->original_name = narrow(strdup(name_token));
             if (current_mapper->original_name == NULL) {
-                LOG("Error: Memory allocation failed for name string.");
+                LOG_ERROR("Error: Memory allocation failed for name string.");
             }
 
             // --- Field 5: read_offset (The file offset, tokens[4]) ---
@@ -213,33 +216,32 @@ static inline void load_mapper_to_global_store(const char *mapper_config_name,
             mapper->entries = new_ptr;
             mapper->capacity = mapper->count;
         } else {
-            LOG("Warning: Failed to shrink array, memory may be "
-                "slightly over-allocated.");
+            LOG_WARN("Warning: Failed to shrink array, memory may be "
+                     "slightly over-allocated.");
         }
     }
+
+    // Every GetProcAddress call the player makes is looked up in the mapper
+    mapper_index(mapper);
 }
 
 // --- Public Function Implementations ---
 const char *get_mapped_player_name(const char *name) {
     if (!mapper) {
-        LOG("Error: No entries loaded, cannot read from mapper.");
+        LOG_ERROR("Error: No entries loaded, cannot read from mapper.");
         return name;
     }
 
-    for (size_t i = 0; i < mapper->count; ++i) {
-        if (lstrcmpiA(mapper->entries[i].original_name, name) == 0) {
-            return mapper->entries[i].mapped_name;
-        }
-    }
+    const char *mapped_name = mapper_find(mapper, name);
 
     // Name not found, return the original name
-    return name;
+    return mapped_name ? mapped_name : name;
 }
 
 void load_mapper() {
     if (mapper != NULL) {
-        LOG("Warning: Mappers already initialized. Skipping "
-            "re-initialization.");
+        LOG_WARN("Warning: Mappers already initialized. Skipping "
+                 "re-initialization.");
         return;
     }
 
@@ -247,12 +249,12 @@ void load_mapper() {
     char_t *binary_path = get_full_path(MAPPING_BINARY_NAME);
 
     if (!file_exists(config_path)) {
-        LOG("Error: Could not find config file '%S'.", config_path);
+        LOG_ERROR("Error: Could not find config file '%S'.", config_path);
         return;
     }
 
     if (!file_exists(binary_path)) {
-        LOG("Error: Could not find binary file '%S'.", binary_path);
+        LOG_ERROR("Error: Could not find binary file '%S'.", binary_path);
         return;
     }
 
@@ -263,13 +265,17 @@ void load_mapper() {
         LOG("Mapper initialization successful. Loaded %d entries.",
             mapper->count);
     } else {
-        LOG("Mapper initialization failed: No entries loaded or memory "
-            "allocation failed.");
+        LOG_ERROR("Mapper initialization failed: No entries loaded or memory "
+                  "allocation failed.");
     }
 
-    for (size_t i = 0; i < mapper->count; ++i) {
-        LOG("Entry %d: %S -> %S", i, mapper->entries[i].original_name,
-            mapper->entries[i].mapped_name);
+    // Skip the walk entirely unless the entries are logged
+    if (mapper && LOG_ENABLED(LOG_LEVEL_TRACE, LOG_CATEGORY)) {
+        for (size_t i = 0; i < mapper->count; ++i) {
+            LOG_TRACE("Entry %d: %S -> %S", i,
+                      mapper->entries[i].original_name,
+                      mapper->entries[i].mapped_name);
+        }
     }
 
     free(config_path);
@@ -0,0 +1,62 @@
+#include "../util/pool.h"
+#include "../crt.h"
+#include <windows.h>
+
+// il2cpp's default allocator is the CRT one, which allocates from the process
+// heap, so blocks allocated before the pool was installed can be freed here
+
+void *pool_sys_reserve(size_t size) {
+    return VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool_t pool_sys_commit(void *addr, size_t size) {
+    return VirtualAlloc(addr, size, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+void *pool_sys_malloc(size_t size) {
+    return HeapAlloc(GetProcessHeap(), 0, size);
+}
+
+void *pool_sys_realloc(void *ptr, size_t size) {
+    if (!ptr)
+        return pool_sys_malloc(size);
+    return HeapReAlloc(GetProcessHeap(), 0, ptr, size);
+}
+
+void pool_sys_free(void *ptr) {
+    if (ptr)
+        HeapFree(GetProcessHeap(), 0, ptr);
+}
+
+// Same layout as _aligned_malloc: the pointer returned by the heap is stored
+// right before the aligned block
+void *pool_sys_aligned_malloc(size_t size, size_t alignment) {
+    if (alignment < sizeof(void *))
+        alignment = sizeof(void *);
+    char *block = pool_sys_malloc(size + alignment + sizeof(void *) - 1);
+    if (!block)
+        return NULL;
+    UINT_PTR aligned = ((UINT_PTR)block + sizeof(void *) + alignment - 1) &
+                       ~(UINT_PTR)(alignment - 1);
+    ((void **)aligned)[-1] = block;
+    return (void *)aligned;
+}
+
+void *pool_sys_aligned_realloc(void *ptr, size_t size, size_t alignment) {
+    if (!ptr)
+        return pool_sys_aligned_malloc(size, alignment);
+    void *result = pool_sys_aligned_malloc(size, alignment);
+    if (!result)
+        return NULL;
+    char *block = ((void **)ptr)[-1];
+    size_t old_size =
+        HeapSize(GetProcessHeap(), 0, block) - ((char *)ptr - block);
+    memcpy(result, ptr, old_size < size ? old_size : size);
+    pool_sys_aligned_free(ptr);
+    return result;
+}
+
+void pool_sys_aligned_free(void *ptr) {
+    if (ptr)
+        pool_sys_free(((void **)ptr)[-1]);
+}
@@ -0,0 +1,17 @@
+#include "../preload/shared_cache.h"
+#include "../crt.h"
+
+// Sharing preloaded assemblies between processes is only implemented on
+// Linux and macOS, where multi-instance dedicated servers are run.
+
+SharedCache *shared_cache_open(unsigned int key) { return NULL; }
+
+void *shared_cache_find(SharedCache *cache, char_t *path,
+                        const FileStamp *stamp, size_t *size) {
+    return NULL;
+}
+
+bool_t shared_cache_publish(unsigned int key, SharedCacheEntry *entries,
+                            size_t count) {
+    return FALSE;
+}
@@ -0,0 +1,53 @@
+#include "../util/thread.h"
+#include "../crt.h"
+#include <windows.h>
+
+typedef struct {
+    thread_func_t func;
+    void *arg;
+} ThreadStart;
+
+static DWORD WINAPI thread_trampoline(LPVOID param) {
+    ThreadStart start = *(ThreadStart *)param;
+    free(param);
+    start.func(start.arg);
+    return 0;
+}
+
+thread_t thread_start(thread_func_t func, void *arg) {
+    ThreadStart *start = malloc(sizeof(ThreadStart));
+    start->func = func;
+    start->arg = arg;
+
+    HANDLE thread = CreateThread(NULL, 0, thread_trampoline, start, 0, NULL);
+    if (!thread) {
+        free(start);
+        return NULL;
+    }
+    return thread;
+}
+
+void thread_join(thread_t thread) {
+    if (!thread)
+        return;
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+unsigned long thread_current_id() { return GetCurrentThreadId(); }
+
+void thread_sleep_ms(unsigned long ms) { Sleep(ms); }
+
+// Fiber-local slots behave like thread-local ones for threads that don't use
+// fibers, and unlike TlsAlloc they can release their value on thread exit
+bool_t tls_alloc(tls_key_t *key, tls_destructor_t destructor) {
+    DWORD index = FlsAlloc(destructor);
+    if (index == FLS_OUT_OF_INDEXES)
+        return FALSE;
+    *key = index;
+    return TRUE;
+}
+
+void *tls_get(tls_key_t key) { return FlsGetValue(key); }
+
+void tls_set(tls_key_t key, void *value) { FlsSetValue(key, value); }
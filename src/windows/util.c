@@ -1,4 +1,5 @@
 #include "../util/util.h"
+#include "../util/arena.h"
 #include "wincrt.h"
 #include <windows.h>
 
@@ -80,7 +81,7 @@ typedef struct {
     size_t len;
 } PathParts;
 
-PathParts split_path(char_t *path) {
+PathParts split_path(const char_t *path) {
     size_t len = strlen(path);
     size_t ext = len;
     size_t i;
@@ -111,6 +112,39 @@ char_t *get_file_name(char_t *path, bool_t with_ext) {
     return result;
 }
 
+char_t *arena_program_path(Arena *arena) {
+    char_t path[MAX_PATH + 1];
+    DWORD len = GetModuleFileName(NULL, path, MAX_PATH + 1);
+    if (len == 0)
+        return NULL;
+    if (len <= MAX_PATH)
+        return arena_strdup(arena, path);
+
+    // Long paths don't fit the buffer
+    char_t *long_path = program_path();
+    char_t *result = arena_strdup(arena, long_path);
+    free(long_path);
+    return result;
+}
+
+char_t *arena_folder_name(Arena *arena, const char_t *path) {
+    PathParts parts = split_path(path);
+    char_t *result = arena_alloc(arena, (parts.parent + 1) * sizeof(char_t));
+    if (result)
+        memcpy(result, path, parts.parent * sizeof(char_t));
+    return result;
+}
+
+char_t *arena_file_name(Arena *arena, const char_t *path, bool_t with_ext) {
+    PathParts parts = split_path(path);
+    size_t result_len = (with_ext ? parts.len : parts.ext) - parts.parent;
+    char_t *result = arena_alloc(arena, result_len * sizeof(char_t));
+    if (result)
+        memcpy(result, path + parts.parent + 1,
+               (result_len - 1) * sizeof(char_t));
+    return result;
+}
+
 char_t *get_working_dir() {
     DWORD len = GetCurrentDirectory(0, NULL);
     char_t *result = malloc(sizeof(char_t) * len);
@@ -119,3 +153,73 @@ char_t *get_working_dir() {
 }
 
 size_t get_file_size(void *file) { return (size_t)GetFileSize(file, NULL); }
+
+bool_t get_file_stamp(char_t *file, FileStamp *stamp) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesEx(file, GetFileExInfoStandard, &data))
+        return FALSE;
+    stamp->size = ((unsigned long long)data.nFileSizeHigh << 32) |
+                  data.nFileSizeLow;
+    stamp->mtime =
+        ((unsigned long long)data.ftLastWriteTime.dwHighDateTime << 32) |
+        data.ftLastWriteTime.dwLowDateTime;
+    return TRUE;
+}
+
+size_t list_files(char_t *dir, const char_t *ext, file_visitor_t visitor,
+                  void *user_data) {
+    char_t *pattern = calloc(strlen(dir) + strlen(ext) + 3, sizeof(char_t));
+    strcat(pattern, dir);
+    strcat(pattern, TEXT("\\*"));
+    strcat(pattern, ext);
+
+    WIN32_FIND_DATA data;
+    HANDLE find = FindFirstFile(pattern, &data);
+    free(pattern);
+    if (find == INVALID_HANDLE_VALUE)
+        return 0;
+
+    size_t count = 0;
+    do {
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+            continue;
+        visitor(dir, data.cFileName, user_data);
+        count++;
+    } while (FindNextFile(find, &data));
+
+    FindClose(find);
+    return count;
+}
+
+unsigned long long monotonic_time_us() {
+    static LARGE_INTEGER frequency;
+    if (!frequency.QuadPart)
+        QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (unsigned long long)counter.QuadPart / frequency.QuadPart *
+               1000000 +
+           (unsigned long long)counter.QuadPart % frequency.QuadPart *
+               1000000 / frequency.QuadPart;
+}
+
+#define PREFETCH_CHUNK_SIZE (256 * 1024)
+
+bool_t prefetch_file(char_t *file) {
+    // There is no readahead hint for plain file handles, so stream the file
+    // through a scratch buffer to populate the standby list
+    HANDLE handle =
+        CreateFile(file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                   FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    void *buffer = malloc(PREFETCH_CHUNK_SIZE);
+    DWORD read = 0;
+    while (ReadFile(handle, buffer, PREFETCH_CHUNK_SIZE, &read, NULL) &&
+           read > 0)
+        ;
+    free(buffer);
+    CloseHandle(handle);
+    return TRUE;
+}
@@ -33,6 +33,10 @@ int setenv(const char_t *name, const char_t *value, int overwrite) {
     return !SetEnvironmentVariable(name, value);
 }
 
+int unsetenv(const char_t *name) {
+    return !SetEnvironmentVariable(name, NULL);
+}
+
 size_t strlen_wide(char_t const *str) {
     size_t result = 0;
     while (*str++)
@@ -215,6 +219,11 @@ void shutenv(char_t *buf) {
 }
 
 void *fopen(char_t *filename, const char_t *mode) {
+    // Only the first character matters; callers pass either narrow or wide
+    // literals, which start with the same byte
+    if (*(const char *)mode == 'w')
+        return CreateFile(filename, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                          FILE_ATTRIBUTE_NORMAL, NULL);
     return CreateFile(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
 }
@@ -225,6 +234,12 @@ size_t fread(void *ptr, size_t size, size_t count, void *stream) {
     return read_size;
 }
 
+size_t fwrite(const void *ptr, size_t size, size_t count, void *stream) {
+    DWORD written = 0;
+    WriteFile(stream, ptr, size * count, &written, NULL);
+    return written;
+}
+
 int fclose(void *stream) { CloseHandle(stream); }
 
 // --- Implementation for fseek (New) ---
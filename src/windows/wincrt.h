@@ -70,6 +70,7 @@ extern void *dlopen(const char_t *filename, int flag);
 extern void free(void *mem);
 
 extern int setenv(const char_t *name, const char_t *value, int overwrite);
+extern int unsetenv(const char_t *name);
 extern char_t *getenv_wide(const char_t *name);
 #define getenv getenv_wide
 
@@ -77,6 +78,7 @@ extern void shutenv(char_t *val);
 
 extern void *fopen(char_t *filename, const char_t *mode);
 extern size_t fread(void *ptr, size_t size, size_t count, void *stream);
+extern size_t fwrite(const void *ptr, size_t size, size_t count, void *stream);
 extern int fclose(void *stream);
 // <-- ADDED: Fixes 'unresolved external symbol fseek'
 extern int fseek(void *stream, long offset, int origin);
@@ -0,0 +1,227 @@
+/*
+ * Renders a log written by a BINARY_LOG build of Doorstop as text.
+ *
+ * Usage: log_decoder <doorstop.log> [output.txt]
+ *
+ * Lines are written like the ones of a text log:
+ *
+ *   [12.345 ms][thread] message
+ */
+#include "util/log_binary.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char **formats;
+    size_t count;
+    size_t defined;
+} Sites;
+
+static uint32_t read_u32(const unsigned char *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint64_t read_u64(const unsigned char *p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static void define_site(Sites *sites, uint32_t id, const unsigned char *text,
+                        size_t size) {
+    if (id >= sites->count) {
+        size_t count = id + 64;
+        sites->formats = realloc(sites->formats, count * sizeof(char *));
+        memset(sites->formats + sites->count, 0,
+               (count - sites->count) * sizeof(char *));
+        sites->count = count;
+    }
+    if (!sites->formats[id])
+        sites->defined++;
+    free(sites->formats[id]);
+    sites->formats[id] = malloc(size + 1);
+    memcpy(sites->formats[id], text, size);
+    sites->formats[id][size] = '\0';
+}
+
+/*
+ * Prints one argument with the flags and width of its specification, but the
+ * length modifier of the recorded value.
+ */
+static const unsigned char *print_arg(FILE *out, const LogSpec *spec,
+                                      const unsigned char *p,
+                                      const unsigned char *end) {
+    if (p >= end)
+        return NULL;
+
+    char format[64];
+    size_t flags = spec->flags_length < 32 ? spec->flags_length : 32;
+    format[0] = '%';
+    memcpy(format + 1, spec->flags, flags);
+    char *suffix = format + 1 + flags;
+
+    char tag = (char)*p++;
+    if (tag == LOG_BINARY_STRING) {
+        if (end - p < 2)
+            return NULL;
+        uint16_t size;
+        memcpy(&size, p, sizeof(size));
+        p += sizeof(size);
+        if (end - p < size)
+            return NULL;
+        char text[LOG_BINARY_MAX_STRING + 1];
+        size_t length = size < LOG_BINARY_MAX_STRING ? size
+                                                     : LOG_BINARY_MAX_STRING;
+        memcpy(text, p, length);
+        text[length] = '\0';
+        strcpy(suffix, "s");
+        fprintf(out, format, text);
+        return p + size;
+    }
+
+    if (end - p < 8)
+        return NULL;
+    uint64_t value = read_u64(p);
+    p += 8;
+    switch (tag) {
+    case LOG_BINARY_INT:
+        if (spec->conversion == 'c') {
+            fputc((int)value, out);
+            break;
+        }
+        sprintf(suffix, "ll%c", spec->conversion);
+        fprintf(out, format, (long long)value);
+        break;
+    case LOG_BINARY_UINT:
+        sprintf(suffix, "ll%c", spec->conversion);
+        fprintf(out, format, (unsigned long long)value);
+        break;
+    case LOG_BINARY_POINTER:
+        fprintf(out, "0x%llx", (unsigned long long)value);
+        break;
+    case LOG_BINARY_DOUBLE: {
+        double number;
+        memcpy(&number, &value, sizeof(number));
+        sprintf(suffix, "%c", spec->conversion);
+        fprintf(out, format, number);
+        break;
+    }
+    default:
+        return NULL;
+    }
+    return p;
+}
+
+static void print_message(FILE *out, const char *format,
+                          const unsigned char *p, const unsigned char *end) {
+    while (*format) {
+        if (*format != '%') {
+            fputc(*format++, out);
+            continue;
+        }
+
+        LogSpec spec;
+        log_spec_parse(format, &spec);
+        if (spec.conversion == '%') {
+            fputc('%', out);
+        } else if (p) {
+            p = print_arg(out, &spec, p, end);
+        }
+        // Arguments that weren't recorded are shown as their specification
+        if (!p && spec.conversion != '%')
+            fwrite(format, 1, spec.end - format, out);
+        format = spec.end;
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <doorstop.log> [output.txt]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+    fseek(in, 0, SEEK_END);
+    long file_size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    unsigned char *data = malloc(file_size > 0 ? file_size : 1);
+    size_t size = fread(data, 1, file_size > 0 ? file_size : 0, in);
+    fclose(in);
+
+    if (size < LOG_BINARY_MAGIC_SIZE ||
+        memcmp(data, LOG_BINARY_MAGIC, LOG_BINARY_MAGIC_SIZE) != 0) {
+        fprintf(stderr, "%s is not a binary Doorstop log\n", argv[1]);
+        return 1;
+    }
+
+    FILE *out = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (!out) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    Sites sites = {NULL, 0, 0};
+    size_t messages = 0;
+    const unsigned char *p = data + LOG_BINARY_MAGIC_SIZE;
+    const unsigned char *end = data + size;
+    while (end - p >= LOG_BINARY_HEADER_SIZE) {
+        uint32_t payload_size = read_u32(p);
+        uint64_t time_us = read_u64(p + 4);
+        uint64_t thread_id = read_u64(p + 12);
+        const unsigned char *payload = p + LOG_BINARY_HEADER_SIZE;
+        // A log cut short by a crash ends with a partial record
+        if ((size_t)(end - payload) < payload_size || payload_size < 4)
+            break;
+        const unsigned char *payload_end = payload + payload_size;
+        p = payload_end;
+
+        uint32_t id = read_u32(payload);
+        if (id & LOG_BINARY_DEFINITION) {
+            define_site(&sites, id & ~LOG_BINARY_DEFINITION, payload + 4,
+                        payload_size - 4);
+            continue;
+        }
+
+        fprintf(out, "[%llu.%03llu ms][%llu] ",
+                (unsigned long long)(time_us / 1000),
+                (unsigned long long)(time_us % 1000),
+                (unsigned long long)thread_id);
+        if (id == LOG_BINARY_DROPPED && payload_size >= 12) {
+            fprintf(out, "%llu messages dropped; the log ring was full\n",
+                    (unsigned long long)read_u64(payload + 4));
+        } else if (id < sites.count && sites.formats[id]) {
+            print_message(out, sites.formats[id], payload + 4, payload_end);
+            fputc('\n', out);
+        } else {
+            fprintf(out, "(message of unknown site %u)\n", id);
+        }
+        messages++;
+    }
+
+    // Logs of a process that crashed end with the zeroed space preallocated
+    // for later records
+    const unsigned char *tail = p;
+    while (tail < end && *tail == 0)
+        tail++;
+    if (tail != end)
+        fprintf(stderr, "Ignored %zu bytes at the end of a partial record\n",
+                (size_t)(end - p));
+    fprintf(stderr, "Decoded %zu messages from %zu sites\n", messages,
+            sites.defined);
+
+    if (out != stdout)
+        fclose(out);
+    for (size_t i = 0; i < sites.count; i++)
+        free(sites.formats[i]);
+    free(sites.formats);
+    free(data);
+    return 0;
+}
@@ -8,16 +8,34 @@ option("include_logging")
     set_description("Include verbose logging on run")
     add_defines("VERBOSE")
 
+option("binary_log")
+    set_showmenu(true)
+    set_description("Include verbose logging in a compact binary format, read with log_decoder")
+    add_defines("VERBOSE", "BINARY_LOG")
+
+option("log_min_level")
+    set_showmenu(true)
+    set_description("Remove log messages more verbose than this level at compile time")
+    set_values("error", "warn", "info", "debug", "trace")
+
 option("deterministic_log")
     set_showmenu(true)
     set_description("Use a deterministic log file name")
     add_defines("DETERMINISTIC_LOG")
 
+option("bench")
+    set_showmenu(true)
+    set_description("Build the benchmark tools (Linux only)")
+
 target("doorstop")
     set_kind("shared")
     set_optimize("smallest")
     add_options("include_logging")
+    add_options("binary_log")
     add_options("deterministic_log")
+    if has_config("log_min_level") then
+        add_defines("LOG_MIN_LEVEL=LOG_LEVEL_" .. get_config("log_min_level"):upper())
+    end
     local load_events = {}
 
     if is_os("windows") then
@@ -40,7 +58,7 @@ target("doorstop")
         elseif is_os("macosx") then
             add_files("src/nix/plthook/plthook_osx.c")
         end
-        add_links("dl")
+        add_links("dl", "pthread")
         if is_mode("debug") then
             set_symbols("debug")
             set_optimize("none")
@@ -70,6 +88,7 @@ target("doorstop")
     add_files("src/mapper/*.c")
     add_files("src/util/*.c")
     add_files("src/runtimes/*.c")
+    add_files("src/preload/*.c")
 
     on_load(function(target)
         for i, event in ipairs(load_events) do
@@ -86,6 +105,10 @@ target("doorstop")
         -- Build x86_64 binary
         target("doorstop_x86_64")
             add_options("include_logging")
+            add_options("binary_log")
+            if has_config("log_min_level") then
+                add_defines("LOG_MIN_LEVEL=LOG_LEVEL_" .. get_config("log_min_level"):upper())
+            end
             set_kind("shared")
             set_arch("x86_64")
             set_optimize("smallest")
@@ -94,9 +117,10 @@ target("doorstop")
             add_files("src/mapper/*.c")
             add_files("src/util/*.c")
             add_files("src/runtimes/*.c")
+            add_files("src/preload/*.c")
             add_files("src/nix/*.c")
             add_files("src/nix/plthook/plthook_osx.c")  -- macOS-specific
-            add_links("dl")
+            add_links("dl", "pthread")
             if is_mode("debug") then
                 set_symbols("debug")
                 set_optimize("none")
@@ -110,6 +134,10 @@ target("doorstop")
         -- Build arm64 binary
         target("doorstop_arm64")
             add_options("include_logging")
+            add_options("binary_log")
+            if has_config("log_min_level") then
+                add_defines("LOG_MIN_LEVEL=LOG_LEVEL_" .. get_config("log_min_level"):upper())
+            end
             set_kind("shared")
             set_arch("arm64")
             set_optimize("smallest")
@@ -118,9 +146,10 @@ target("doorstop")
             add_files("src/mapper/*.c")
             add_files("src/util/*.c")
             add_files("src/runtimes/*.c")
+            add_files("src/preload/*.c")
             add_files("src/nix/*.c")
             add_files("src/nix/plthook/plthook_osx.c")  -- macOS-specific
-            add_links("dl")
+            add_links("dl", "pthread")
             if is_mode("debug") then
                 set_symbols("debug")
                 set_optimize("none")
@@ -153,3 +182,96 @@ target("doorstop")
                       path.join(universal_dir, ".doorstop_version"))
             end)
     end
+
+target("log_decoder")
+    set_kind("binary")
+    set_default(false)
+    add_includedirs("src")
+    add_files("tools/log_decoder.c")
+
+if has_config("bench") and is_os("linux") then
+    target("bench_lz4")
+        set_kind("binary")
+        set_optimize("fastest")
+        add_includedirs("src")
+        add_files("bench/lz4_decode.c")
+        add_files("src/util/lz4.c")
+
+    target("bench_mono_jit_options")
+        set_kind("binary")
+        set_optimize("fastest")
+        add_files("bench/mono_jit_options.c")
+        -- Only built alongside; the libraries are loaded at run time
+        add_deps("doorstop", "bench_stub_mono", {inherit = false})
+        add_links("dl")
+
+    target("bench_pool")
+        set_kind("binary")
+        set_optimize("fastest")
+        add_includedirs("src")
+        add_files("bench/pool.c")
+        add_files("src/util/pool.c")
+        add_files("src/nix/pool.c")
+        add_files("src/nix/thread.c")
+        add_links("pthread")
+
+    target("bench_profiler")
+        set_kind("binary")
+        set_optimize("fastest")
+        add_includedirs("src")
+        add_files("bench/profiler.c")
+        add_files("src/util/profiler.c")
+        add_files("src/nix/thread.c")
+        add_files("src/nix/util.c")
+        add_files("src/util/arena.c")
+        add_links("dl", "pthread")
+
+    target("bench_config_ini")
+        set_kind("binary")
+        set_optimize("fastest")
+        add_includedirs("src")
+        add_files("bench/config_ini.c")
+        add_files("src/config/ini.c")
+        add_files("src/nix/util.c")
+        add_files("src/util/arena.c")
+
+    target("bench_readahead")
+        set_kind("binary")
+        set_optimize("fastest")
+        add_includedirs("src")
+        add_files("bench/readahead.c")
+        add_files("src/nix/readahead.c")
+        add_files("src/nix/util.c")
+        add_files("src/util/arena.c")
+        add_links("dl", "pthread")
+
+    target("bench_stub_mono")
+        set_kind("shared")
+        set_basename("mono-stub")
+        add_includedirs("src")
+        add_files("bench/stub_mono.c")
+        add_files("bench/stub_mono_exports.c")
+
+    target("bench_stub_il2cpp")
+        set_kind("shared")
+        set_filename("GameAssembly.so")
+        add_includedirs("src")
+        add_files("bench/stub_il2cpp.c")
+        add_files("bench/stub_il2cpp_exports.c")
+
+    target("bench_stub_coreclr")
+        set_kind("shared")
+        set_basename("coreclr")
+        add_files("bench/stub_coreclr.c")
+
+    target("bench_injection")
+        set_kind("binary")
+        set_optimize("fastest")
+        add_includedirs("src")
+        add_files("bench/injection.c")
+        add_files("src/mapper/common.c")
+        -- Only built alongside; the libraries are loaded at run time
+        add_deps("doorstop", "bench_stub_mono", "bench_stub_il2cpp",
+                 "bench_stub_coreclr", {inherit = false})
+        add_links("dl")
+end